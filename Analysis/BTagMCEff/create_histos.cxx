@@ -0,0 +1,264 @@
+#include <TFile.h>
+#include <TH2D.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <glob.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+Compiled replacement of create_histos.py without the Varial dependency. Merges the BTagMCEffFlav{B,C,UDSG}{Passing,Total}
+histograms of all hadded MC outputs of the main selection, merges adjacent pt bins until each bin has enough
+statistics, and writes the efficiency files read by MCBTagScaleFactor / ltt::BTagFixedWPScaleFactors.
+
+The input files are read by a pool of threads. The histograms are filled with the full event weight, i.e. they
+already include the lumi weight of MCLumiWeight, so summing them gives the lumi-weighted MC mixture.
+
+The pt binning is coarsened separately for each flavor: starting at the highest pt bin, bins are merged until the
+"Total" histogram has at least <min_entries> effective entries ((sum w)^2 / sum w^2) in every eta bin. The eta
+binning is left as is.
+
+Build and run:
+  g++ -O2 -pthread -o create_histos create_histos.cxx $(root-config --cflags --glibs)
+  ./create_histos -y UL17 UL18 -f BTagMCEff_Main BTagMCEff_QCD -j 8 --min-entries 100
+*/
+
+const vector<string> kYearChoices = { "UL16preVFP", "UL16postVFP", "UL17", "UL18" };
+const vector<string> kChannelChoices = { "muo" };
+const vector<string> kFlavors = { "B", "C", "UDSG" };
+
+typedef struct {
+  string year;
+  string channel;
+  string folder;
+} Target;
+
+string target_name(const Target & target) {
+  return target.folder+"_"+target.year+"_"+target.channel;
+}
+
+class Accumulator {
+public:
+  void add(const string & name, const TH2 *hist) {
+    lock_guard<mutex> lock(fMutex);
+    unique_ptr<TH2> & sum = fHists[name];
+    if(sum) sum->Add(hist);
+    else {
+      sum.reset((TH2*)hist->Clone());
+      sum->SetDirectory(0);
+    }
+  }
+  map<string, unique_ptr<TH2>> & hists() { return fHists; }
+private:
+  mutex fMutex;
+  map<string, unique_ptr<TH2>> fHists;
+};
+
+vector<string> resolve_file_pattern(const string & pattern) {
+  vector<string> result;
+  glob_t glob_result;
+  if(glob(pattern.c_str(), 0, nullptr, &glob_result) == 0) {
+    for(size_t i = 0; i < glob_result.gl_pathc; i++) result.push_back(glob_result.gl_pathv[i]);
+  }
+  globfree(&glob_result);
+  return result;
+}
+
+// Lower pt edges (bin numbers, starting at 1) of the merged pt bins
+vector<int> statistical_pt_binning(const TH2 *total, const double min_entries) {
+  const int n_pt = total->GetNbinsX();
+  const int n_eta = total->GetNbinsY();
+  vector<int> lower_bins;
+  vector<double> sumw(n_eta, 0.), sumw2(n_eta, 0.);
+  for(int i_pt = n_pt; i_pt >= 1; i_pt--) {
+    bool enough = true;
+    for(int i_eta = 1; i_eta <= n_eta; i_eta++) {
+      sumw.at(i_eta - 1) += total->GetBinContent(i_pt, i_eta);
+      sumw2.at(i_eta - 1) += pow(total->GetBinError(i_pt, i_eta), 2);
+      const double n_eff = sumw2.at(i_eta - 1) > 0 ? pow(sumw.at(i_eta - 1), 2) / sumw2.at(i_eta - 1) : 0.;
+      if(n_eff < min_entries) enough = false;
+    }
+    if(enough) {
+      lower_bins.push_back(i_pt);
+      fill(sumw.begin(), sumw.end(), 0.);
+      fill(sumw2.begin(), sumw2.end(), 0.);
+    }
+  }
+  // Low-statistics leftovers at the lowest pt are merged into the lowest complete bin
+  if(lower_bins.empty()) lower_bins.push_back(1);
+  else lower_bins.back() = 1;
+  reverse(lower_bins.begin(), lower_bins.end());
+  return lower_bins;
+}
+
+TH2D * rebin_pt(const TH2 *hist, const vector<int> & lower_bins, const string & name) {
+  vector<double> pt_edges;
+  for(const int bin : lower_bins) pt_edges.push_back(hist->GetXaxis()->GetBinLowEdge(bin));
+  pt_edges.push_back(hist->GetXaxis()->GetXmax());
+  vector<double> eta_edges;
+  for(int i = 1; i <= hist->GetNbinsY() + 1; i++) eta_edges.push_back(hist->GetYaxis()->GetBinLowEdge(i));
+  TH2D *result = new TH2D(name.c_str(), hist->GetTitle(), pt_edges.size() - 1, pt_edges.data(), eta_edges.size() - 1, eta_edges.data());
+  result->SetDirectory(0);
+  result->Sumw2();
+  for(unsigned int i = 0; i < lower_bins.size(); i++) {
+    const int first = lower_bins.at(i);
+    const int last = i + 1 < lower_bins.size() ? lower_bins.at(i + 1) - 1 : hist->GetNbinsX();
+    for(int i_eta = 1; i_eta <= hist->GetNbinsY(); i_eta++) {
+      double content = 0., error2 = 0.;
+      for(int i_pt = first; i_pt <= last; i_pt++) {
+        content += hist->GetBinContent(i_pt, i_eta);
+        error2 += pow(hist->GetBinError(i_pt, i_eta), 2);
+      }
+      result->SetBinContent(i + 1, i_eta, content);
+      result->SetBinError(i + 1, i_eta, sqrt(error2));
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+
+  vector<string> years = kYearChoices;
+  vector<string> channels = kChannelChoices;
+  vector<string> folders = { "BTagMCEff_Main", "BTagMCEff_QCD" };
+  unsigned int n_threads = max(1u, thread::hardware_concurrency());
+  double min_entries = 100.;
+
+  vector<string> *current_list = nullptr;
+  for(int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if(arg == "-y" || arg == "--years") { years.clear(); current_list = &years; }
+    else if(arg == "-c" || arg == "--channels") { channels.clear(); current_list = &channels; }
+    else if(arg == "-f" || arg == "--folders") { folders.clear(); current_list = &folders; }
+    else if((arg == "-j" || arg == "--threads") && i + 1 < argc) { n_threads = max(1, stoi(argv[++i])); current_list = nullptr; }
+    else if(arg == "--min-entries" && i + 1 < argc) { min_entries = stod(argv[++i]); current_list = nullptr; }
+    else if(current_list != nullptr && arg.front() != '-') current_list->push_back(arg);
+    else {
+      cerr << "Usage: " << argv[0] << " [-y <years>] [-c <channels>] [-f <folders>] [-j <threads>] [--min-entries <n>]" << endl;
+      return 1;
+    }
+  }
+  for(const string & year : years) {
+    if(find(kYearChoices.begin(), kYearChoices.end(), year) == kYearChoices.end()) { cerr << "Invalid year: " << year << endl; return 1; }
+  }
+  for(const string & channel : channels) {
+    if(find(kChannelChoices.begin(), kChannelChoices.end(), channel) == kChannelChoices.end()) { cerr << "Invalid channel: " << channel << endl; return 1; }
+  }
+
+  const char *cmssw_base = getenv("CMSSW_BASE");
+  if(cmssw_base == nullptr) {
+    cerr << "CMSSW_BASE not set. Did you do 'cmsenv'?" << endl;
+    return 1;
+  }
+  const string uhh2Dir = (string)cmssw_base+"/src/UHH2/";
+  const string outputDir = uhh2Dir+"LegacyTopTagging/output/TagAndProbe/mainsel/";
+  const string histDir = uhh2Dir+"LegacyTopTagging/Analysis/BTagMCEff/files/";
+  gSystem->mkdir(histDir.c_str(), true);
+
+  // One job per input file; each job fills the histograms of all requested folders
+  vector<Target> targets;
+  vector<pair<string, vector<unsigned int>>> jobs; // file path, indices into targets
+  for(const string & year : years) {
+    for(const string & channel : channels) {
+      const string input_pattern = outputDir+year+"/"+channel+"/nominal/uhh2.AnalysisModuleRunner.MC.*AllMergeScenarios*.root";
+      const vector<string> files = resolve_file_pattern(input_pattern);
+      cout << "Using " << files.size() << " MC files as input: " << input_pattern << endl;
+      vector<unsigned int> target_indices;
+      for(const string & folder : folders) {
+        target_indices.push_back(targets.size());
+        targets.push_back(Target{year, channel, folder});
+      }
+      for(const string & file : files) jobs.push_back({file, target_indices});
+    }
+  }
+
+  ROOT::EnableThreadSafety();
+  vector<Accumulator> accumulators(targets.size());
+  atomic<unsigned int> next_job(0);
+  atomic<bool> failed(false);
+  mutex cerr_mutex;
+  const auto worker = [&]() {
+    for(unsigned int i_job = next_job++; i_job < jobs.size(); i_job = next_job++) {
+      const string & file_path = jobs.at(i_job).first;
+      unique_ptr<TFile> file(TFile::Open(file_path.c_str(), "READ"));
+      if(!file || file->IsZombie()) {
+        lock_guard<mutex> lock(cerr_mutex);
+        cerr << "Cannot open " << file_path << endl;
+        failed = true;
+        continue;
+      }
+      for(const unsigned int i_target : jobs.at(i_job).second) {
+        for(const string & flavor : kFlavors) {
+          for(const string & kind : { "Passing", "Total" }) {
+            const string name = "BTagMCEffFlav"+flavor+kind;
+            TH2 *hist = (TH2*)file->Get((targets.at(i_target).folder+"/"+name).c_str());
+            if(hist == nullptr) continue; // reported below if missing in all files
+            accumulators.at(i_target).add(name, hist);
+          }
+        }
+      }
+    }
+  };
+  vector<thread> pool;
+  for(unsigned int i = 0; i < min((size_t)n_threads, jobs.size()); i++) pool.emplace_back(worker);
+  for(thread & t : pool) t.join();
+  if(failed) return 1;
+
+  for(unsigned int i_target = 0; i_target < targets.size(); i_target++) {
+    const Target & target = targets.at(i_target);
+    map<string, unique_ptr<TH2>> & hists = accumulators.at(i_target).hists();
+    cout << "Working on: " << target_name(target) << endl;
+
+    // do some checks
+    for(const string & flavor : kFlavors) {
+      for(const string & kind : { "Passing", "Total" }) {
+        const string name = "BTagMCEffFlav"+flavor+kind;
+        if(hists.find(name) == hists.end()) {
+          cerr << "Error. Histogram " << target.folder << "/" << name << " not found in any input file" << endl;
+          return 1;
+        }
+        if(hists.at(name)->Integral() == 0.) {
+          cerr << "Error: integral of histogram " << name << " is 0.0! Exit." << endl;
+          return 1;
+        }
+      }
+    }
+
+    // write out
+    const string outfile_path = histDir+"BTagMCEfficiencyHists"+target_name(target)+".root";
+    cout << "Saving histograms to file: " << outfile_path << endl;
+    unique_ptr<TFile> outfile(TFile::Open(outfile_path.c_str(), "RECREATE"));
+    if(!outfile || outfile->IsZombie()) {
+      cerr << "Cannot create " << outfile_path << endl;
+      return 1;
+    }
+    for(const string & flavor : kFlavors) {
+      const string prefix = "BTagMCEffFlav"+flavor;
+      const TH2 *total_fine = hists.at(prefix+"Total").get();
+      const vector<int> lower_bins = statistical_pt_binning(total_fine, min_entries);
+      cout << "  " << prefix << ": " << total_fine->GetNbinsX() << " -> " << lower_bins.size() << " pt bins" << endl;
+      unique_ptr<TH2D> passing(rebin_pt(hists.at(prefix+"Passing").get(), lower_bins, prefix+"Passing"));
+      unique_ptr<TH2D> total(rebin_pt(total_fine, lower_bins, prefix+"Total"));
+      unique_ptr<TH2D> eff((TH2D*)passing->Clone((prefix+"Eff").c_str()));
+      eff->SetDirectory(0);
+      eff->Divide(passing.get(), total.get(), 1., 1., "B");
+      outfile->cd();
+      passing->Write();
+      total->Write();
+      eff->Write();
+    }
+    outfile->Close();
+  }
+  return 0;
+}
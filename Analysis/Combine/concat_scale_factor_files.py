@@ -12,6 +12,8 @@ from constants import _YEARS, _TAGGERS, _NULL_WP
 sys.path.append(os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/NicePlots/python'))
 from plotter import CoordinateConverter
 
+from scale_factor_store import read_store
+
 years = [
 'UL16preVFP',
 'UL16postVFP',
@@ -52,6 +54,16 @@ golden_ratio = .61803398875
 #     'NotMerged': ,
 # }
 
+_store_records = None
+
+def store_records():
+
+    # the store holds the scale factors of all combine tasks; read it once for all taggers and working points
+    global _store_records
+    if _store_records is None:
+        _store_records = read_store()
+    return _store_records
+
 class ValueAndAsymmErrors():
 
     def __init__(self, value, up=None, down=None):
@@ -133,6 +145,30 @@ class ScaleFactorCollector():
                 for year in self.years:
                     self.scale_factors.setdefault(msc, OrderedDict()).setdefault(pt_bin.name, OrderedDict())[year] = ScaleFactor()
 
+    def read_point(self, msc, pt_bin, year, graph_type):
+
+        combine_task_name_suffix = '-'.join([('PtTotal' if pt_bin.total_range else pt_bin.name), year]) # HACK
+        combine_task_name = '-'.join(['combineTask', self.tagger.name, self.wp.name]) + ('-'+combine_task_name_suffix if len(combine_task_name_suffix) else '')
+
+        # from the scale factor store if it has this scale factor, else from the output file of the combine task
+        record = store_records().get((combine_task_name, self.tagger.name, self.wp.name, year, msc, pt_bin.name, 'obs'))
+        if record is not None:
+            pt_max = min(record['pt_max'], 1000.)
+            half_x_width = (pt_max - record['pt_min'])/2.
+            return record['pt_min'] + half_x_width, record['central'], half_x_width, half_x_width, record[graph_type+'_down'], record[graph_type+'_up']
+
+        combine_task_path = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel/combine', self.tagger.name, 'workdirs', combine_task_name)
+        infile_name = 'scale_factors_obs.root'
+        inFilePath = os.path.join(combine_task_path, infile_name)
+
+        inFile = root.TFile.Open(inFilePath, 'READ')
+        input_graph = inFile.Get('_'.join([msc, year, graph_type]))
+        if input_graph.GetN() != 1:
+            sys.exit('input graph should only have one entry')
+        point = (input_graph.GetX()[0], input_graph.GetY()[0], input_graph.GetErrorXlow(0), input_graph.GetErrorXhigh(0), input_graph.GetErrorYlow(0), input_graph.GetErrorYhigh(0))
+        inFile.Close()
+        return point
+
     def write_root_files(self):
 
         outfile_name_combined = self.sf_task_name+'.root'
@@ -164,61 +200,28 @@ class ScaleFactorCollector():
 
                     for pt_bin in self.sorted_pt_bins:
 
-                        combine_task_name_suffix = '-'.join([('PtTotal' if pt_bin.total_range else pt_bin.name), year]) # HACK
-                        combine_task_name = '-'.join(['combineTask', self.tagger.name, self.wp.name]) + ('-'+combine_task_name_suffix if len(combine_task_name_suffix) else '')
-                        combine_task_path = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel/combine', self.tagger.name, 'workdirs', combine_task_name)
-                        infile_name = 'scale_factors_obs.root'
-                        inFilePath = os.path.join(combine_task_path, infile_name)
-
-                        inFile = root.TFile.Open(inFilePath, 'READ')
-                        # inFile.SetDirectory(0)
-
-                        input_graph = inFile.Get(graph_name)
-                        input_graphs.append(input_graph)
-
-                        # Get the number of points in the input graph
-                        num_points = input_graph.GetN()
-                        if num_points != 1:
-                            sys.exit('input graph should only have one entry')
-
-                        # Loop through each point in the input graph and add it to the concatenated graph
-                        for i in range(num_points):
-                            x = root.Double()
-                            y = root.Double()
-                            x_err_low = root.Double()
-                            x_err_high = root.Double()
-                            y_err_low = root.Double()
-                            y_err_high = root.Double()
-
-                            # Get the values and errors of the point
-                            input_graph.GetPoint(i, x, y)
-                            x_err_low = input_graph.GetErrorXlow(i)
-                            x_err_high = input_graph.GetErrorXhigh(i)
-                            y_err_low = input_graph.GetErrorYlow(i)
-                            y_err_high = input_graph.GetErrorYhigh(i)
-
-                            #HACK for ak8_w__partnet:
-                            if self.tagger.name == 'ak8_w__partnet' and msc == 'FullyMerged' and (pt_bin.name == 'pt_200to250' or pt_bin.name == 'pt_250to300'):
-                                is_exception_for_w_tagger = True
-                            else:
-                                is_exception_for_w_tagger = False
-                            if is_exception_for_w_tagger:
-                                y = 1.
-                                y_err_low = 0.
-                                y_err_high = 0.
-                            #HACK end
-
-                            # setattr(x, 'y', v) is equivalent to x.y = v
-                            setattr(self.scale_factors[msc][pt_bin.name][year], graph_type, ValueAndAsymmErrors(value=y, up=y_err_high, down=y_err_low))
-                            # self.scale_factors[msc][pt_bin.name][year].tot.value = y
-                            # self.scale_factors[msc][pt_bin.name][year].tot.up = y_err_high
-                            # self.scale_factors[msc][pt_bin.name][year].tot.down = y_err_low
-
-                            # Add the point with errors to the concatenated graph
-                            concatenated_graph.SetPoint(concatenated_graph.GetN(), x, y)
-                            concatenated_graph.SetPointError(concatenated_graph.GetN() - 1, x_err_low, x_err_high, y_err_low, y_err_high)
-
-                        inFile.Close()
+                        x, y, x_err_low, x_err_high, y_err_low, y_err_high = self.read_point(msc, pt_bin, year, graph_type)
+
+                        #HACK for ak8_w__partnet:
+                        if self.tagger.name == 'ak8_w__partnet' and msc == 'FullyMerged' and (pt_bin.name == 'pt_200to250' or pt_bin.name == 'pt_250to300'):
+                            is_exception_for_w_tagger = True
+                        else:
+                            is_exception_for_w_tagger = False
+                        if is_exception_for_w_tagger:
+                            y = 1.
+                            y_err_low = 0.
+                            y_err_high = 0.
+                        #HACK end
+
+                        # setattr(x, 'y', v) is equivalent to x.y = v
+                        setattr(self.scale_factors[msc][pt_bin.name][year], graph_type, ValueAndAsymmErrors(value=y, up=y_err_high, down=y_err_low))
+                        # self.scale_factors[msc][pt_bin.name][year].tot.value = y
+                        # self.scale_factors[msc][pt_bin.name][year].tot.up = y_err_high
+                        # self.scale_factors[msc][pt_bin.name][year].tot.down = y_err_low
+
+                        # Add the point with errors to the concatenated graph
+                        concatenated_graph.SetPoint(concatenated_graph.GetN(), x, y)
+                        concatenated_graph.SetPointError(concatenated_graph.GetN() - 1, x_err_low, x_err_high, y_err_low, y_err_high)
 
                     # # Create an empty TGraphAsymmErrors object to store the concatenated data
                     # concatenated_graph = root.TGraphAsymmErrors()
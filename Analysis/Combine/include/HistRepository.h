@@ -0,0 +1,142 @@
+#pragma once
+
+#include <TClass.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+// Key of an object, e.g. a signal efficiency graph or a scale factor, in a set of files. Which fields are used and how
+// they map to files and object paths is up to the resolver of the HistRepository
+struct HistKey {
+  std::string year;
+  std::string tagger;
+  std::string wp;
+  std::string pt_bin;
+  std::string process;
+  bool operator<(const HistKey & other) const {
+    return std::tie(year, tagger, wp, pt_bin, process) < std::tie(other.year, other.tagger, other.wp, other.pt_bin, other.process);
+  }
+};
+
+// Read-only cache of histograms, graphs, and other objects in ROOT files, shared by the Combine plotting tools.
+//
+// Each file is opened once, on first use, and the paths of all its objects (including subdirectories) are indexed,
+// so asking for a missing object fails without reading from the file. Loaded objects are detached copies owned by
+// std::shared_ptr: the repository keeps one reference while an object is cached, callers may keep theirs as long as
+// they like. release() drops the references of the repository, so objects nobody else uses are deleted; closing the
+// files does not invalidate any object handed out.
+class HistRepository {
+public:
+  typedef std::function<std::pair<std::string, std::string>(const HistKey &)> Resolver; // key -> (file path, object path)
+
+  HistRepository(const Resolver & resolver = nullptr): fResolver(resolver) {}
+  ~HistRepository() { close_files(); }
+  HistRepository(const HistRepository &) = delete;
+  HistRepository & operator=(const HistRepository &) = delete;
+
+  void set_resolver(const Resolver & resolver) { fResolver = resolver; }
+
+  template<typename T>
+  std::shared_ptr<T> get(const std::string & file_path, const std::string & object_path) {
+    const auto id = std::make_pair(file_path, object_path);
+    auto it = fObjects.find(id);
+    if(it == fObjects.end()) {
+      it = fObjects.emplace(id, load(file_path, object_path)).first;
+      ++fNLoaded;
+    }
+    else ++fNHits;
+    std::shared_ptr<T> result = std::dynamic_pointer_cast<T>(it->second);
+    if(!result) throw std::runtime_error("HistRepository: "+file_path+":"+object_path+" is a "+it->second->ClassName()+", not a "+T::Class()->GetName());
+    return result;
+  }
+
+  template<typename T>
+  std::shared_ptr<T> get(const HistKey & key) {
+    if(!fResolver) throw std::logic_error("HistRepository: no resolver set");
+    const auto paths = fResolver(key);
+    return get<T>(paths.first, paths.second);
+  }
+
+  bool has(const std::string & file_path, const std::string & object_path) { return index(file_path).count(object_path) > 0; }
+
+  // Paths of all objects in the file, relative to the top directory
+  const std::set<std::string> & index(const std::string & file_path) {
+    open(file_path);
+    return fIndex.at(file_path);
+  }
+
+  // Drops the cached objects of one file (all files if empty) and closes it; objects still in use elsewhere survive
+  void release(const std::string & file_path = "") {
+    for(auto it = fObjects.begin(); it != fObjects.end();) {
+      if(file_path.empty() || it->first.first == file_path) it = fObjects.erase(it);
+      else ++it;
+    }
+    if(file_path.empty()) close_files();
+    else if(fFiles.count(file_path)) {
+      fFiles.at(file_path)->Close();
+      fFiles.erase(file_path);
+    }
+  }
+
+  void close_files() {
+    for(auto & file : fFiles) file.second->Close();
+    fFiles.clear();
+  }
+
+  std::string stats() const {
+    return "HistRepository: "+std::to_string(fNOpened)+" files opened, "+std::to_string(fNLoaded)+" objects loaded, "+std::to_string(fNHits)+" cache hits";
+  }
+
+private:
+  TFile * open(const std::string & file_path) {
+    const auto it = fFiles.find(file_path);
+    if(it != fFiles.end()) return it->second.get();
+    std::unique_ptr<TFile> file(TFile::Open(file_path.c_str(), "READ"));
+    if(!file || file->IsZombie()) throw std::runtime_error("HistRepository: cannot open "+file_path);
+    ++fNOpened;
+    if(!fIndex.count(file_path)) {
+      std::set<std::string> & paths = fIndex[file_path];
+      build_index(file.get(), "", paths);
+    }
+    return (fFiles[file_path] = std::move(file)).get();
+  }
+
+  static void build_index(TDirectory * dir, const std::string & prefix, std::set<std::string> & paths) {
+    for(TObject * obj : *dir->GetListOfKeys()) {
+      TKey * key = (TKey*)obj;
+      const std::string path = prefix+key->GetName();
+      if(!paths.insert(path).second) continue; // only the highest cycle
+      const TClass * cls = TClass::GetClass(key->GetClassName());
+      if(cls && cls->InheritsFrom(TDirectory::Class())) build_index((TDirectory*)key->ReadObj(), path+"/", paths);
+    }
+  }
+
+  std::shared_ptr<TObject> load(const std::string & file_path, const std::string & object_path) {
+    TFile * file = open(file_path);
+    if(!fIndex.at(file_path).count(object_path)) throw std::runtime_error("HistRepository: "+object_path+" not found in "+file_path);
+    TObject * original = file->Get(object_path.c_str());
+    TObject * copy = original->Clone();
+    if(copy->InheritsFrom(TH1::Class())) ((TH1*)copy)->SetDirectory(nullptr);
+    // histograms read from a file belong to it, anything else to the caller
+    if(!original->InheritsFrom(TH1::Class())) delete original;
+    return std::shared_ptr<TObject>(copy);
+  }
+
+  Resolver fResolver;
+  std::map<std::string, std::unique_ptr<TFile>> fFiles;
+  std::map<std::string, std::set<std::string>> fIndex;
+  std::map<std::pair<std::string, std::string>, std::shared_ptr<TObject>> fObjects;
+  unsigned long fNOpened = 0;
+  unsigned long fNLoaded = 0;
+  unsigned long fNHits = 0;
+};
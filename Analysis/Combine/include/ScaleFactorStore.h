@@ -0,0 +1,134 @@
+#pragma once
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One scale factor of the store written by scale_factor_store.py: key (the combine task name stands for the fit
+// configuration), pt bin edges, central value, and the up/down
+// errors of the total, stat, syst, era-uncorrelated, and era-correlated components
+struct ScaleFactorRecord {
+  std::string task;
+  std::string tagger;
+  std::string wp;
+  std::string year;
+  std::string msc;
+  std::string pt_bin;
+  std::string expobs;
+  double pt_min;
+  double pt_max;
+  double central;
+  double tot_up;
+  double tot_down;
+  double stat_up;
+  double stat_down;
+  double syst_up;
+  double syst_down;
+  double uncorr_up;
+  double uncorr_down;
+  double corr_up;
+  double corr_down;
+};
+
+// Read-only view of the consolidated scale factor file (one TTree entry per scale factor). The whole tree is read once
+// in the constructor and indexed in hash maps, so each lookup is O(1): by full key, or by the key without pt bin plus
+// a pt value (the handful of pt bins of one fit are scanned).
+class ScaleFactorStore {
+public:
+  explicit ScaleFactorStore(const std::string & file_path) {
+    std::unique_ptr<TFile> file(TFile::Open(file_path.c_str(), "READ"));
+    if(!file || file->IsZombie()) throw std::runtime_error("ScaleFactorStore: cannot open "+file_path);
+    TTree * tree = (TTree*)file->Get("scale_factors");
+    if(!tree) throw std::runtime_error("ScaleFactorStore: no tree 'scale_factors' in "+file_path);
+    ScaleFactorRecord r;
+    std::string * task = nullptr;
+    std::string * tagger = nullptr;
+    std::string * wp = nullptr;
+    std::string * year = nullptr;
+    std::string * msc = nullptr;
+    std::string * pt_bin = nullptr;
+    std::string * expobs = nullptr;
+    tree->SetBranchAddress("task", &task);
+    tree->SetBranchAddress("tagger", &tagger);
+    tree->SetBranchAddress("wp", &wp);
+    tree->SetBranchAddress("year", &year);
+    tree->SetBranchAddress("msc", &msc);
+    tree->SetBranchAddress("pt_bin", &pt_bin);
+    tree->SetBranchAddress("expobs", &expobs);
+    tree->SetBranchAddress("pt_min", &r.pt_min);
+    tree->SetBranchAddress("pt_max", &r.pt_max);
+    tree->SetBranchAddress("central", &r.central);
+    tree->SetBranchAddress("tot_up", &r.tot_up);
+    tree->SetBranchAddress("tot_down", &r.tot_down);
+    tree->SetBranchAddress("stat_up", &r.stat_up);
+    tree->SetBranchAddress("stat_down", &r.stat_down);
+    tree->SetBranchAddress("syst_up", &r.syst_up);
+    tree->SetBranchAddress("syst_down", &r.syst_down);
+    tree->SetBranchAddress("uncorr_up", &r.uncorr_up);
+    tree->SetBranchAddress("uncorr_down", &r.uncorr_down);
+    tree->SetBranchAddress("corr_up", &r.corr_up);
+    tree->SetBranchAddress("corr_down", &r.corr_down);
+    const Long64_t n_entries = tree->GetEntries();
+    fRecords.reserve(n_entries);
+    fIndex.reserve(n_entries);
+    for(Long64_t i = 0; i < n_entries; ++i) {
+      tree->GetEntry(i);
+      r.task = *task;
+      r.tagger = *tagger;
+      r.wp = *wp;
+      r.year = *year;
+      r.msc = *msc;
+      r.pt_bin = *pt_bin;
+      r.expobs = *expobs;
+      fIndex[key(r.task, r.tagger, r.wp, r.year, r.msc, r.pt_bin, r.expobs)] = fRecords.size();
+      fGroups[group_key(r.task, r.tagger, r.wp, r.year, r.msc, r.expobs)].push_back(fRecords.size());
+      fRecords.push_back(r);
+    }
+    tree->ResetBranchAddresses();
+    delete task; delete tagger; delete wp; delete year; delete msc; delete pt_bin; delete expobs;
+    file->Close();
+  }
+
+  static std::string key(const std::string & task, const std::string & tagger, const std::string & wp, const std::string & year, const std::string & msc, const std::string & pt_bin, const std::string & expobs) {
+    return group_key(task, tagger, wp, year, msc, expobs)+"/"+pt_bin;
+  }
+
+  // nullptr if the store has no such scale factor
+  const ScaleFactorRecord * find(const std::string & task, const std::string & tagger, const std::string & wp, const std::string & year, const std::string & msc, const std::string & pt_bin, const std::string & expobs) const {
+    const auto it = fIndex.find(key(task, tagger, wp, year, msc, pt_bin, expobs));
+    return it == fIndex.end() ? nullptr : &fRecords[it->second];
+  }
+
+  // Scale factor of the pt bin containing pt; nullptr if there is none
+  const ScaleFactorRecord * find_pt(const std::string & task, const std::string & tagger, const std::string & wp, const std::string & year, const std::string & msc, const std::string & expobs, const double pt) const {
+    const auto it = fGroups.find(group_key(task, tagger, wp, year, msc, expobs));
+    if(it == fGroups.end()) return nullptr;
+    for(const size_t i : it->second) {
+      if(pt >= fRecords[i].pt_min && pt < fRecords[i].pt_max) return &fRecords[i];
+    }
+    return nullptr;
+  }
+
+  const ScaleFactorRecord & at(const std::string & task, const std::string & tagger, const std::string & wp, const std::string & year, const std::string & msc, const std::string & pt_bin, const std::string & expobs) const {
+    const ScaleFactorRecord * r = find(task, tagger, wp, year, msc, pt_bin, expobs);
+    if(!r) throw std::out_of_range("ScaleFactorStore: no scale factor "+key(task, tagger, wp, year, msc, pt_bin, expobs));
+    return *r;
+  }
+
+  const std::vector<ScaleFactorRecord> & records() const { return fRecords; }
+  size_t size() const { return fRecords.size(); }
+
+private:
+  static std::string group_key(const std::string & task, const std::string & tagger, const std::string & wp, const std::string & year, const std::string & msc, const std::string & expobs) {
+    return task+"/"+tagger+"/"+wp+"/"+year+"/"+msc+"/"+expobs;
+  }
+
+  std::vector<ScaleFactorRecord> fRecords;
+  std::unordered_map<std::string, size_t> fIndex;
+  std::unordered_map<std::string, std::vector<size_t>> fGroups;
+};
@@ -25,6 +25,9 @@ systs = systematics.base
 sys.path.append(os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/NicePlots/python'))
 from plotter import NiceStackWithRatio, Process, human_format
 
+from scale_factor_store import update_store, make_record
+from task_graph import Node, TaskGraph
+
 
 all_years = [
 'UL16preVFP',
@@ -407,6 +410,12 @@ class ScaleFactorFits():
         return id
 
 
+    def template_path(self, combine_channel):
+        substring = '-'.join([self.tagger.name, self.wp.name, combine_channel['pt_bin'].name, combine_channel['year'], self.tagger.fit_variable])
+        return os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel', combine_channel['year'], 'combine', self.tagger.name, substring, 'Templates-'+substring+'.root')
+
+
+
     def write_rootfile(self):
 
         '''
@@ -420,8 +429,7 @@ class ScaleFactorFits():
         pbar = tqdm(total=n_histograms, desc='Histograms read', dynamic_ncols=True, leave=False)
 
         for combine_channel in self.combine_channels.values():
-            substring = '-'.join([self.tagger.name, self.wp.name, combine_channel['pt_bin'].name, combine_channel['year'], self.tagger.fit_variable])
-            infile_path = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel', combine_channel['year'], 'combine', self.tagger.name, substring, 'Templates-'+substring+'.root')
+            infile_path = self.template_path(combine_channel)
             infile = root.TFile.Open(infile_path, 'READ')
             infile_folder = '_'.join(['Main', combine_channel['region'], combine_channel['channel']])
             target_folder = outfile.mkdir(combine_channel['name'])
@@ -695,7 +703,7 @@ class ScaleFactorFits():
 
 
     def create_workspace(self, run=True):
-        print('Creating workspace')
+        if run: print('Creating workspace')
         command = 'text2workspace.py \\'
         command += self.datacard_path+' \\'
         command += '-o '+self.workspace_path+' \\'
@@ -711,7 +719,7 @@ class ScaleFactorFits():
 
 
     def generate_toys(self, run=True):
-        print('Creating toys')
+        if run: print('Creating toys')
         command = 'combine -M GenerateOnly \\'
         command += '-t -1 \\'
         command += '--setParameters '+','.join([x+'=1.' for x in self.pois.keys()])+' \\'
@@ -726,7 +734,7 @@ class ScaleFactorFits():
     def multidimfit(self, observed=False, freezeSyst=False, freezeEraCorrelated=False, run=True):
         if freezeSyst and freezeEraCorrelated:
             sys.exit('Cannot freeze total systematics and only correlated part at once.')
-        print('Performing maximum-likelihood fit (MultiDimFit):', expobs(observed, False), ('with frozen systematics' if freezeSyst else ('with frozen era-correlated uncertainties' if freezeEraCorrelated else '')))
+        if run: print('Performing maximum-likelihood fit (MultiDimFit):', expobs(observed, False), ('with frozen systematics' if freezeSyst else ('with frozen era-correlated uncertainties' if freezeEraCorrelated else '')))
         command = 'combine -M MultiDimFit \\'
         command += '-v 2 \\' # more verbosity
         # command += '--cminSingleNuisFit \\'
@@ -735,7 +743,7 @@ class ScaleFactorFits():
             datacard_path = os.path.join(self.workdir, 'higgsCombine_'+expobs(observed)+'.MultiDimFit.mH120.root')
         else:
             datacard_path = self.workspace_path
-        if not os.path.isfile(datacard_path):
+        if run and not os.path.isfile(datacard_path):
             print('Warning in CombineTask.multidimfit():', datacard_path, 'does not exist')
         command += '--datacard '+datacard_path+' \\'
         command += '-n _'+expobs(observed)+('_freezeSyst' if freezeSyst else ('_freezeEraCorrelated' if freezeEraCorrelated else ''))+' \\'
@@ -770,7 +778,7 @@ class ScaleFactorFits():
 
 
     def prepostfitshapes(self, observed=False, run=True):
-        print('Calculating prefit and postfit shapes:', expobs(observed, False))
+        if run: print('Calculating prefit and postfit shapes:', expobs(observed, False))
         command = 'PostFitShapesFromWorkspace \\'
         command += '-w '+self.workspace_path+' \\'
         command += '-o '+(self.prepostfitshapes_paths.get(expobs(observed)))+' \\'
@@ -1165,6 +1173,47 @@ class ScaleFactorFits():
                 sf_graph_uncorr.Write(msc+'_'+year+'_uncorr')
                 sf_graph_corr.Write(msc+'_'+year+'_corr')
         print('Wrote', sf_file_path)
+        records = []
+        for poi_info in self.pois.values():
+            result = poi_info.get(expobs(observed))
+            pt_bin = poi_info['pt_bin']
+            errors = dict((error_type, (result['loErr'+suffix], result['hiErr'+suffix])) for error_type, suffix in [('tot', ''), ('stat', '_stat'), ('syst', '_syst'), ('uncorr', '_uncorr'), ('corr', '_corr')])
+            records.append(make_record(self.task_name, self.tagger.name, self.wp.name, poi_info['year'], poi_info['msc'], pt_bin.name, expobs(observed), pt_bin.var_min, pt_bin.var_max, result['bestFitVal'], errors))
+        update_store(records)
+
+
+
+    def impacts_plot_commands(self, observed, impactsJsonPath):
+
+        '''
+        Task name -> (POI, command, plot file) of the impact plot of each POI
+        '''
+
+        results = OrderedDict()
+        # plot_command_base = 'plotImpacts.py \\'
+        plot_command_base = 'plotImpacts_old_version.py \\' #HACK
+        plot_command_base += '-i '+impactsJsonPath+' \\'
+        plot_command_base += '--POI {0} \\'
+        plot_command_base += '-o {1} \\'
+        # plot_command_base += '-t '+globalRenameJsonFile+' \\' # rename parameters
+
+        # HACK: adjust commands to produce nicer impact plots:
+        plot_command_base += '--cms-label Private\ Work \\'
+        # plot_command_base += '--cms-label Preliminary \\'
+        plot_command_base += '--per-page 20 \\'
+        plot_command_base += '--max-pages 1 \\'
+        plot_command_base += '--label-size 0.035 \\'
+        rename_file_name = 'rename_GoodExample-ak8_t__tau-BkgEff0p001-UL16preVFP-pt_480to600.json'
+        rename_file_path = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/Analysis/Combine/', rename_file_name)
+        plot_command_base += '--translate '+rename_file_path+' \\'
+
+        for signal_rate_param in self.pois.keys():
+            plot_path = os.path.join(self.workdir, impactsJsonPath.replace('.json', '_'+signal_rate_param))
+            plot_command = plot_command_base.format(signal_rate_param, os.path.join(os.path.basename(self.impact_plots_dir), os.path.basename(plot_path))) # need to use basename, else combine will try to save pdf to ./{plot_path} --> error
+            # self.ImpactPlotPaths.append(plot_path+'.pdf')
+            plot_task_name = '_'.join(['plot_impacts', expobs(observed), signal_rate_param])
+            results[plot_task_name] = (signal_rate_param, plot_command, os.path.join(self.impact_plots_dir, os.path.basename(plot_path)+'.pdf'))
+        return results
 
 
 
@@ -1203,34 +1252,92 @@ class ScaleFactorFits():
         results[task_name3] = self.combine_task(task_name3, command3, run)
         #________________________________
         os.system('mkdir -p '+self.impact_plots_dir)
-        # plot_command_base = 'plotImpacts.py \\'
-        plot_command_base = 'plotImpacts_old_version.py \\' #HACK
-        plot_command_base += '-i '+impactsJsonPath+' \\'
-        plot_command_base += '--POI {0} \\'
-        plot_command_base += '-o {1} \\'
-        # plot_command_base += '-t '+globalRenameJsonFile+' \\' # rename parameters
-
-        # HACK: adjust commands to produce nicer impact plots:
-        plot_command_base += '--cms-label Private\ Work \\'
-        # plot_command_base += '--cms-label Preliminary \\'
-        plot_command_base += '--per-page 20 \\'
-        plot_command_base += '--max-pages 1 \\'
-        plot_command_base += '--label-size 0.035 \\'
-        rename_file_name = 'rename_GoodExample-ak8_t__tau-BkgEff0p001-UL16preVFP-pt_480to600.json'
-        rename_file_path = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/Analysis/Combine/', rename_file_name)
-        plot_command_base += '--translate '+rename_file_path+' \\'
-
-        for signal_rate_param in self.pois.keys():
+        for plot_task_name, (signal_rate_param, plot_command, plot_file_path) in self.impacts_plot_commands(observed, impactsJsonPath).items():
             print('Plotting impacts for parameter:', signal_rate_param)
-            plot_path = os.path.join(self.workdir, impactsJsonPath.replace('.json', '_'+signal_rate_param))
-            plot_command = plot_command_base.format(signal_rate_param, os.path.join(os.path.basename(self.impact_plots_dir), os.path.basename(plot_path))) # need to use basename, else combine will try to save pdf to ./{plot_path} --> error
-            # self.ImpactPlotPaths.append(plot_path+'.pdf')
-            plot_task_name = '_'.join(['plot_impacts', expobs(observed), signal_rate_param])
             results[plot_task_name] = self.combine_task(plot_task_name, plot_command, run)
         return results
 
 
 
+    def nuisance_parameters(self):
+        # same list as used by combineTool.py -M Impacts
+        ws_file = root.TFile.Open(self.workspace_path, 'READ')
+        nuisance_set = ws_file.Get('w').set('ModelConfig_NuisParams')
+        names = []
+        it = nuisance_set.createIterator()
+        var = it.Next()
+        while var:
+            names.append(var.GetName())
+            var = it.Next()
+        ws_file.Close()
+        return sorted(names)
+
+
+
+    def add_nodes(self, graph, fits=[], impacts=False):
+
+        '''
+        Adds the fit tasks to a task graph (see task_graph.py), which runs them in parallel with other fits and skips
+        tasks whose inputs did not change since their last run. `fits` is a list of `observed` values, e.g. [False, True]
+        for the expected and observed fits; the workspace is always created. Needs to be run after `self.write_datacard()`
+        '''
+
+        def add(task_name, **kwargs):
+            return graph.add(Node(self.task_name+'/'+task_name, self.workdir, log_name=task_name, **kwargs))
+
+        # The ROOT file of the datacard is recreated by every call of write_rootfile() and thus never has the same
+        # content hash; it is fully determined by the templates, so these are the inputs instead
+        template_paths = sorted(set(self.template_path(combine_channel) for combine_channel in self.combine_channels.values()))
+        add('create_workspace', command=self.create_workspace(run=False), inputs=[self.datacard_path]+template_paths, outputs=[self.workspace_path])
+
+        toys_path = os.path.join(self.workdir, 'higgsCombine_toy.GenerateOnly.mH120.123456.root')
+        if False in fits:
+            add('generate_toys', command=self.generate_toys(run=False), inputs=[self.workspace_path], outputs=[toys_path])
+
+        for observed in fits:
+            toys = [] if observed else [toys_path]
+            mdf_snapshot = 'higgsCombine_'+expobs(observed)+'.MultiDimFit.mH120.root'
+            mdf_results = ['multidimfit_'+expobs(observed)+suffix+'.root' for suffix in ['', '_freezeSyst', '_freezeEraCorrelated']]
+            add('multidimfit_'+expobs(observed), command=self.multidimfit(observed=observed, run=False), inputs=[self.workspace_path]+toys, outputs=[mdf_results[0], mdf_snapshot])
+            add('multidimfit_'+expobs(observed)+'_freezeSyst', command=self.multidimfit(observed=observed, freezeSyst=True, run=False), inputs=[mdf_snapshot]+toys, outputs=[mdf_results[1]])
+            add('multidimfit_'+expobs(observed)+'_freezeEraCorrelated', command=self.multidimfit(observed=observed, freezeEraCorrelated=True, run=False), inputs=[mdf_snapshot]+toys, outputs=[mdf_results[2]])
+            add('write_scale_factor_file_'+expobs(observed), action=lambda observed=observed: self.write_scale_factor_file(observed=observed), signature='write_scale_factor_file '+expobs(observed),
+                inputs=mdf_results, outputs=[self.sf_file_path_obs if observed else self.sf_file_path_exp])
+            add('prepostfitshapes_'+expobs(observed), command=self.prepostfitshapes(observed=observed, run=False), inputs=[self.workspace_path, mdf_results[0]], outputs=[self.prepostfitshapes_paths.get(expobs(observed))])
+            add('prepostfitshapes_for_plots_'+expobs(observed), action=lambda observed=observed: self.prepostfitshapes_for_plots(observed=observed), signature='prepostfitshapes_for_plots '+expobs(observed),
+                inputs=[self.prepostfitshapes_paths.get(expobs(observed))], outputs=list(self.prepostfitshapes_for_plots_paths.get(expobs(observed)).values()))
+
+            if not impacts:
+                continue
+            # Same steps as combineTool.py -M Impacts --doInitialFit / --doFits / -o, but with one node per nuisance
+            # parameter, so that the fits of all nuisance parameters (and of all other tasks) share the core budget
+            command_base = 'combineTool.py -M Impacts \\'
+            command_base += '-m 0 \\' # required argument
+            command_base += '-d '+self.workspace_path+' \\'
+            command_base += '-n '+expobs(observed)+' \\'
+            command_fits = command_base+'--robustFit 1 \\'
+            if self.robust_hesse:
+                command_fits += '--robustHesse=1 \\' # produces covariance matrix of nuisance parameters
+            if not observed:
+                command_fits += '-t -1 \\'
+                command_fits += '--toysFile '+toys_path+' \\'
+            initial_fit = 'higgsCombine_initialFit_'+expobs(observed)+'.MultiDimFit.mH0.root'
+            impactsJsonPath = os.path.join(self.workdir, 'impacts_'+expobs(observed)+'.json')
+            collect = add('impacts_'+expobs(observed)+'_collect', command=command_base+'-o '+impactsJsonPath+' \\', inputs=[initial_fit], outputs=[impactsJsonPath])
+
+            def add_nuisance_fits(graph, observed=observed, command_fits=command_fits, initial_fit=initial_fit, toys=toys, collect=collect):
+                # the nuisance parameters are only known once the workspace exists
+                for param in self.nuisance_parameters():
+                    fit = add('impacts_'+expobs(observed)+'_'+param, command=command_fits+'--doFits \\'+'--named '+param+' \\', inputs=[initial_fit]+toys, outputs=['higgsCombine_paramFit_'+expobs(observed)+'_'+param+'.MultiDimFit.mH0.root'])
+                    graph.add_dependency(collect.name, fit.name)
+            add('impacts_'+expobs(observed)+'_initialFit', command=command_fits+'--doInitialFit \\', inputs=[self.workspace_path]+toys, outputs=[initial_fit], expand=add_nuisance_fits)
+
+            os.system('mkdir -p '+self.impact_plots_dir)
+            for plot_task_name, (signal_rate_param, plot_command, plot_file_path) in self.impacts_plot_commands(observed, impactsJsonPath).items():
+                add(plot_task_name, command=plot_command, inputs=[impactsJsonPath], outputs=[plot_file_path])
+
+
+
 
 # class ScaleFactorPlots():
 #
@@ -1270,68 +1377,57 @@ if __name__=='__main__':
     if not sys.argv[1:]: sys.exit('No arguments provided. Exit.')
     parser = argparse.ArgumentParser()
     parser.add_argument('-t', '--tagger', choices=taggers.keys())
-    parser.add_argument('-w', '--wp') # integer indices of wps, following the indexing given at the top of this python script
-    parser.add_argument('-p', '--pt-index') # integer indices of wps, following the indexing given at the top of this python script
-    parser.add_argument('-y', '--year', choices=all_years)
+    parser.add_argument('-w', '--wp', nargs='+') # integer indices of wps, following the indexing given at the top of this python script
+    parser.add_argument('-p', '--pt-index', nargs='+') # integer indices of wps, following the indexing given at the top of this python script
+    parser.add_argument('-y', '--year', nargs='+', choices=all_years, help='Years to fit separately (default: one combined fit of all years)')
+    parser.add_argument('-f', '--fits', nargs='*', choices=['exp', 'obs'], default=[], help='Fits to run after creating the workspace')
+    parser.add_argument('-i', '--impacts', action='store_true', help='Also calculate and plot impacts of the chosen fits')
+    parser.add_argument('-c', '--cores', type=int, default=None, help='Core budget for all tasks running in parallel (default: number of CPUs)')
+    parser.add_argument('--force', action='store_true', help='Rerun tasks even if their inputs did not change')
+    parser.add_argument('--dry-run', action='store_true', help='Only print the tasks which would run')
+    parser.add_argument('--plot', action='store_true', help='Plot prefit and postfit shapes of the observed fit at the end')
     args = parser.parse_args(sys.argv[1:])
 
-    # for tagger in taggers.values():
-
-    # for pt_index in range(0,3):
-    # for year in all_years:
-
-    x = ScaleFactorFits(
-        tagger_name = args.tagger,
-        # tagger_name = 'ak8_t__tau', # naf-cms11 tmux 1-5
-        # tagger_name = 'ak8_t_btagDJet__tau', # naf-cms12 tmux 1-5
-        # tagger_name = 'ak8_t_btagDCSV__tau', # naf-cms13 tmux 1-5
-        # tagger_name = 'hotvr_t__tau', # naf-cms11 tmux 0
-        # tagger_name = 'ak8_w__partnet', # naf-cms11 tmux 6
-        # tagger_name = 'ak8_t__MDdeepak8', # naf-cms13 tmux 0
-        # tagger_name = tagger.name,
-        wp = int(args.wp),
-        # wp = 1,
-        # total_range = True,
-        # pt_index = pt_index,
-        pt_index = int(args.pt_index),
-        # pt_index = 3,
-        # years = all_years,
-        years = args.year,
-        # years = year,
-        # mode='Hybrid',
-        # mscSplitting = 'mscW3',
-        # mscSplitting = 'mscTop3',
-        robust_hesse = False,
-        # robust_hesse = True,
-    )
-
-    # x.write_rootfile()
-    # x.write_datacard()
-    # x.impacts(observed=False)
-    # x.impacts(observed=True)
-
-    # Need to run this always:
-    x.write_rootfile()
-    x.write_datacard()
-    x.create_workspace()
-
-    # Expected:
-    # x.generate_toys()
-    # x.multidimfit(observed=False)
-    # x.multidimfit(observed=False, freezeEraCorrelated=True)
-    # x.multidimfit(observed=False, freezeSyst=True)
-    # x.write_scale_factor_file(observed=False)
-    # x.prepostfitshapes(observed=False)
-    # x.prepostfitshapes_for_plots(observed=False)
-    # x.impacts(observed=False)
-
-    # Observed:
-    # x.multidimfit(observed=True)
-    # x.multidimfit(observed=True, freezeEraCorrelated=True)
-    # x.multidimfit(observed=True, freezeSyst=True)
-    # x.write_scale_factor_file(observed=True)
-    # x.prepostfitshapes(observed=True)
-    # x.prepostfitshapes_for_plots(observed=True)
-    x.plot_prepostfitshapes(observed=True, prepostfit='prefitCombine')
-    x.plot_prepostfitshapes(observed=True, prepostfit='postfitCombine')
-    # x.impacts(observed=True)
+    # All combinations of working points, pt bins, and years share one task graph, so their fits run in parallel
+    graph = TaskGraph(max_cores=args.cores, dry_run=args.dry_run, force=args.force)
+    fits = []
+
+    for wp in args.wp:
+        for pt_index in args.pt_index:
+            for year in args.year or [None]: # None: combined fit of all years
+
+                x = ScaleFactorFits(
+                    tagger_name = args.tagger,
+                    # tagger_name = 'ak8_t__tau', # naf-cms11 tmux 1-5
+                    # tagger_name = 'ak8_t_btagDJet__tau', # naf-cms12 tmux 1-5
+                    # tagger_name = 'ak8_t_btagDCSV__tau', # naf-cms13 tmux 1-5
+                    # tagger_name = 'hotvr_t__tau', # naf-cms11 tmux 0
+                    # tagger_name = 'ak8_w__partnet', # naf-cms11 tmux 6
+                    # tagger_name = 'ak8_t__MDdeepak8', # naf-cms13 tmux 0
+                    wp = int(wp),
+                    # total_range = True,
+                    pt_index = int(pt_index),
+                    years = year,
+                    # years = all_years,
+                    # mode='Hybrid',
+                    # mscSplitting = 'mscW3',
+                    # mscSplitting = 'mscTop3',
+                    robust_hesse = False,
+                    # robust_hesse = True,
+                )
+
+                # Need to run this always (fills the yields and binnings of the combine channels):
+                x.write_rootfile()
+                x.write_datacard()
+                x.add_nodes(graph, fits=[f == 'obs' for f in args.fits], impacts=args.impacts)
+                fits.append(x)
+
+    failed = graph.run()
+
+    if args.plot and not args.dry_run:
+        for x in fits:
+            x.plot_prepostfitshapes(observed=True, prepostfit='prefitCombine')
+            x.plot_prepostfitshapes(observed=True, prepostfit='postfitCombine')
+
+    if failed:
+        sys.exit('Failed tasks (see their logs in the work directories): '+', '.join(failed))
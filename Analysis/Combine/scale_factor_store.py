@@ -0,0 +1,178 @@
+#!/usr/bin/env python2
+
+'''
+Consolidated store of all fitted scale factors.
+
+Every scale factor is one entry of the TTree "scale_factors" in a single ROOT file, with its key (combine task,
+tagger, working point, year, merge scenario, pt bin, exp/obs), the pt bin edges, the central value, and the up/down errors of the
+total, stat, syst, uncorrelated, and correlated components. Entries are sorted by key. Readers load the tree once and
+look up scale factors in a hash map (see include/ScaleFactorStore.h for C++), instead of opening the
+scale_factors_{exp,obs}.root file of every combine task. The combine task name stands for the fit
+configuration (years, pt binning, merge scenario splitting, suffix) and is part of the key, so fits of the same tagger
+and working point with different configurations do not overwrite each other.
+
+run_combine.py adds the scale factors of a fit with update_store(). Fits of several taggers/working points/pt bins run
+in parallel, so the store is rewritten under an exclusive lock and replaced atomically.
+
+Print the store, or add scale factor files written by older fits, with:
+  ./scale_factor_store.py show [--task <combine task>] [-t <tagger>] [-w <wp>] [-y <year>]
+  ./scale_factor_store.py import <combine task> <tagger> <wp> <exp|obs> <scale_factors_file> [--year <year>]
+'''
+
+from __future__ import print_function
+
+import os
+import sys
+import fcntl
+import argparse
+from array import array
+from collections import OrderedDict
+
+STORE_FILE = os.path.join(os.environ.get('CMSSW_BASE', ''), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel/combine/scale_factors.root')
+TREE_NAME = 'scale_factors'
+
+KEY_FIELDS = ['task', 'tagger', 'wp', 'year', 'msc', 'pt_bin', 'expobs']
+VALUE_FIELDS = ['pt_min', 'pt_max', 'central']
+ERROR_TYPES = ['tot', 'stat', 'syst', 'uncorr', 'corr']
+for error_type in ERROR_TYPES:
+    VALUE_FIELDS += [error_type+'_up', error_type+'_down']
+
+
+def record_key(record):
+    return tuple(record[k] for k in KEY_FIELDS)
+
+
+def read_store(store_path=STORE_FILE):
+
+    '''All records of the store as OrderedDict key tuple -> record dict; empty if the store does not exist'''
+
+    import ROOT as root
+    records = OrderedDict()
+    if not os.path.isfile(store_path):
+        return records
+    store_file = root.TFile.Open(store_path, 'READ')
+    tree = store_file.Get(TREE_NAME)
+    if not tree:
+        sys.exit('No tree "{}" in {}'.format(TREE_NAME, store_path))
+    for entry in tree:
+        record = OrderedDict()
+        for field in KEY_FIELDS:
+            record[field] = str(getattr(entry, field))
+        for field in VALUE_FIELDS:
+            record[field] = float(getattr(entry, field))
+        records[record_key(record)] = record
+    store_file.Close()
+    return records
+
+
+def write_store(records, store_path):
+
+    import ROOT as root
+    tmp_path = store_path+'.tmp'
+    store_file = root.TFile.Open(tmp_path, 'RECREATE')
+    tree = root.TTree(TREE_NAME, 'Scale factors')
+    strings = OrderedDict((field, root.std.string()) for field in KEY_FIELDS)
+    values = OrderedDict((field, array('d', [0.])) for field in VALUE_FIELDS)
+    for field, s in strings.items():
+        tree.Branch(field, s)
+    for field, v in values.items():
+        tree.Branch(field, v, field+'/D')
+    for key in sorted(records.keys()):
+        for field, s in strings.items():
+            s.assign(records[key][field])
+        for field, v in values.items():
+            v[0] = records[key][field]
+        tree.Fill()
+    tree.Write()
+    store_file.Close()
+    os.rename(tmp_path, store_path)
+
+
+def update_store(new_records, store_path=STORE_FILE):
+
+    '''Adds the records to the store, replacing records with the same key'''
+
+    store_dir = os.path.dirname(store_path)
+    if store_dir and not os.path.isdir(store_dir):
+        os.makedirs(store_dir)
+    with open(store_path+'.lock', 'w') as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        records = read_store(store_path)
+        for record in new_records:
+            records[record_key(record)] = record
+        write_store(records, store_path)
+    print('Updated', store_path, '({} scale factors)'.format(len(records)))
+
+
+def make_record(task, tagger, wp, year, msc, pt_bin, expobs, pt_min, pt_max, central, errors):
+
+    '''task: name of the combine task; errors: dict error type -> (down, up)'''
+
+    record = OrderedDict([('task', task), ('tagger', tagger), ('wp', wp), ('year', year), ('msc', msc), ('pt_bin', pt_bin), ('expobs', expobs)])
+    record['pt_min'] = float(pt_min)
+    record['pt_max'] = float(pt_max)
+    record['central'] = float(central)
+    for error_type in ERROR_TYPES:
+        record[error_type+'_down'] = float(errors[error_type][0])
+        record[error_type+'_up'] = float(errors[error_type][1])
+    return record
+
+
+def import_file(task, tagger, wp, expobs, file_path, year=None):
+
+    '''Records of a scale_factors_{exp,obs}.root file, with graphs <msc>_<year>_<error type> (or <msc>_<error type> for
+    fits of a single year, then year has to be given)'''
+
+    import ROOT as root
+    sf_file = root.TFile.Open(file_path, 'READ')
+    records = []
+    for tkey in sf_file.GetListOfKeys():
+        name = tkey.GetName()
+        if not name.endswith('_tot'):
+            continue
+        parts = name[:-len('_tot')].split('_')
+        msc = parts[0]
+        graph_year = parts[1] if len(parts) > 1 else year
+        if graph_year is None:
+            sys.exit('Graph {} has no year, use --year'.format(name))
+        graphs = dict((error_type, sf_file.Get(name[:-len('tot')]+error_type)) for error_type in ERROR_TYPES)
+        for i in range(graphs['tot'].GetN()):
+            x = graphs['tot'].GetX()[i]
+            pt_min = x-graphs['tot'].GetErrorXlow(i)
+            pt_max = x+graphs['tot'].GetErrorXhigh(i)
+            errors = dict((error_type, (g.GetErrorYlow(i), g.GetErrorYhigh(i)) if g else (0., 0.)) for error_type, g in graphs.items())
+            pt_bin = 'pt_{:g}to{:g}'.format(pt_min, pt_max)
+            records.append(make_record(task, tagger, wp, graph_year, msc, pt_bin, expobs, pt_min, pt_max, graphs['tot'].GetY()[i], errors))
+    sf_file.Close()
+    return records
+
+
+if __name__=='__main__':
+
+    parser = argparse.ArgumentParser(description='Consolidated store of all fitted scale factors.')
+    parser.add_argument('--store', default=STORE_FILE)
+    subparsers = parser.add_subparsers(dest='mode')
+    parser_show = subparsers.add_parser('show', help='Print the scale factors in the store.')
+    parser_show.add_argument('--task')
+    parser_show.add_argument('-t', '--tagger')
+    parser_show.add_argument('-w', '--wp')
+    parser_show.add_argument('-y', '--year')
+    parser_import = subparsers.add_parser('import', help='Add the scale factors of a scale_factors_{exp,obs}.root file.')
+    parser_import.add_argument('task', help='Name of the combine task (or work directory) the file was written by.')
+    parser_import.add_argument('tagger')
+    parser_import.add_argument('wp')
+    parser_import.add_argument('expobs', choices=['exp', 'obs'])
+    parser_import.add_argument('file')
+    parser_import.add_argument('--year', help='Year of graphs without year in their name.')
+    args = parser.parse_args(sys.argv[1:])
+
+    if args.mode == 'import':
+        update_store(import_file(args.task, args.tagger, args.wp, args.expobs, args.file, args.year), args.store)
+    elif args.mode == 'show':
+        for key, r in read_store(args.store).items():
+            if args.task and r['task'] != args.task: continue
+            if args.tagger and r['tagger'] != args.tagger: continue
+            if args.wp and r['wp'] != args.wp: continue
+            if args.year and r['year'] != args.year: continue
+            print('{:<48}{:<24}{:<14}{:<13}{:<13}{:<15}{:<5}{:>7.3f} -{:.3f} / +{:.3f} (tot.)  [ -{:.3f} / +{:.3f} (stat.)  |  -{:.3f} / +{:.3f} (syst.) ]'.format(
+                r['task'], r['tagger'], r['wp'], r['year'], r['msc'], r['pt_bin'], r['expobs'], r['central'], r['tot_down'], r['tot_up'], r['stat_down'], r['stat_up'], r['syst_down'], r['syst_up']))
@@ -3,6 +3,7 @@
 #include <array>
 
 #include "../constants.h"
+#include "include/HistRepository.h"
 
 using namespace macros;
 
@@ -11,21 +12,21 @@ const string data_path = "sig_eff_in_mc_BasicHists";
 
 
 
+// Signal efficiency graph ("sig_eff") and correlated/uncorrelated scale factors ("corr"/"uncorr") of each year
+// are resolved by the repository, see do_plot_nsubjettiness()
 TGraphAsymmErrors * create_sig_eff_graph_run2(
-  TFile * infile,
-  const string & graphNamePostfix,
-  double x_offset,
-  TFile * sf_file,
-  const string & tagger_and_wp
+  HistRepository & repo,
+  const string & tagger,
+  const string & wp,
+  double x_offset
 ) {
   map<Year, TGraph> graph_map;
   map<Year, TGraphAsymmErrors> sf_map_corr, sf_map_uncorr;
   for (auto year : kAllYears) {
-    const string graphName = kYears.at(year).name + graphNamePostfix;
-    graph_map[year] = *(TGraph*)infile->Get(graphName.c_str());
-    const string sfName = tagger_and_wp + "-" + kYears.at(year).name + "/FullyMerged_" + kYears.at(year).name;
-    sf_map_corr[year] = *(TGraphAsymmErrors*)sf_file->Get((sfName + "_corr").c_str());
-    sf_map_uncorr[year] = *(TGraphAsymmErrors*)sf_file->Get((sfName + "_uncorr").c_str());
+    const string year_name = kYears.at(year).name;
+    graph_map[year] = *repo.get<TGraph>(HistKey{year_name, tagger, wp, "", "sig_eff"});
+    sf_map_corr[year] = *repo.get<TGraphAsymmErrors>(HistKey{year_name, tagger, wp, "", "corr"});
+    sf_map_uncorr[year] = *repo.get<TGraphAsymmErrors>(HistKey{year_name, tagger, wp, "", "uncorr"});
   }
 
   int n = graph_map[Year::isUL18].GetN();
@@ -639,13 +640,15 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   const string inputGraphName = "graph_sig_eff_withWindow_both";
 
-  const string infilePath_nominal = data_path + "/sig_eff_in_mc-ak8_t__tau.root";
-  const string infilePath_btag = data_path + "/sig_eff_in_mc-ak8_t_btagDJet__tau.root";
-  const string infilePath_hotvr = data_path + "/sig_eff_in_mc-hotvr_t__tau.root";
-
-  TFile* infile_nominal = TFile::Open(infilePath_nominal.c_str(), "READ");
-  TFile* infile_btag = TFile::Open(infilePath_btag.c_str(), "READ");
-  TFile* infile_hotvr = TFile::Open(infilePath_hotvr.c_str(), "READ");
+  // Each input file is opened once, no matter how many working points and years are read from it
+  HistRepository repo([&inputGraphName](const HistKey & key) {
+    if(key.process == "sig_eff") return make_pair(data_path + "/sig_eff_in_mc-" + key.tagger + ".root", key.year + "-" + key.wp + "/" + inputGraphName);
+    const string tagger_and_wp = key.tagger + "-" + key.wp;
+    return make_pair(
+      "scaleFactors_2023-08-10/scaleFactors-" + tagger_and_wp + "/scaleFactors-" + tagger_and_wp + ".root",
+      tagger_and_wp + "-" + key.year + "/FullyMerged_" + key.year + "_" + key.process
+    );
+  });
 
   const int line_width = 2;
   const int marker_size = 1;
@@ -662,14 +665,9 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
   //double x_offset_general = 16;
   double x_offset_general = 0;
 
-  string tagger_and_wp = "";
-
   //const string graphName_nominal_vt = kYears.at(year).name + "-BkgEff0p001/"+inputGraphName;
   //TGraph graph_nominal_vt = *(TGraph*)infile_nominal->Get(graphName_nominal_vt.c_str());
-  const string graphNamePostfix_nominal_vt = "-BkgEff0p001/"+inputGraphName;
-  TFile* sf_file_nominal_vt = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t__tau-BkgEff0p001/scaleFactors-ak8_t__tau-BkgEff0p001.root", "READ");
-  tagger_and_wp = "ak8_t__tau-BkgEff0p001";
-  auto graph_nominal_vt = *(create_sig_eff_graph_run2(infile_nominal, graphNamePostfix_nominal_vt, x_offset_nominal-2*x_offset_general, sf_file_nominal_vt, tagger_and_wp));
+  auto graph_nominal_vt = *(create_sig_eff_graph_run2(repo, "ak8_t__tau", "BkgEff0p001", x_offset_nominal-2*x_offset_general));
   graph_nominal_vt.SetLineWidth(line_width);
   graph_nominal_vt.SetLineColor(kGreen);
   graph_nominal_vt.SetLineStyle(line_style_nominal);
@@ -682,10 +680,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
   
   //const string graphName_nominal_ti = kYears.at(year).name + "-BkgEff0p005/"+inputGraphName;
   //TGraph graph_nominal_ti = *(TGraph*)infile_nominal->Get(graphName_nominal_ti.c_str());
-  const string graphNamePostfix_nominal_ti = "-BkgEff0p005/"+inputGraphName;
-  TFile* sf_file_nominal_ti = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t__tau-BkgEff0p005/scaleFactors-ak8_t__tau-BkgEff0p005.root", "READ");
-  tagger_and_wp = "ak8_t__tau-BkgEff0p005";
-  auto graph_nominal_ti = *(create_sig_eff_graph_run2(infile_nominal, graphNamePostfix_nominal_ti, x_offset_nominal-x_offset_general, sf_file_nominal_ti, tagger_and_wp));
+  auto graph_nominal_ti = *(create_sig_eff_graph_run2(repo, "ak8_t__tau", "BkgEff0p005", x_offset_nominal-x_offset_general));
   graph_nominal_ti.SetLineWidth(line_width);
   graph_nominal_ti.SetLineColor(kCyan);
   graph_nominal_ti.SetLineStyle(line_style_nominal);
@@ -698,10 +693,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_nominal_me = kYears.at(year).name + "-BkgEff0p010/"+inputGraphName;
   //TGraph graph_nominal_me = *(TGraph*)infile_nominal->Get(graphName_nominal_me.c_str());
-  const string graphNamePostfix_nominal_me = "-BkgEff0p010/"+inputGraphName;
-  TFile* sf_file_nominal_me = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t__tau-BkgEff0p010/scaleFactors-ak8_t__tau-BkgEff0p010.root", "READ");
-  tagger_and_wp = "ak8_t__tau-BkgEff0p010";
-  auto graph_nominal_me = *(create_sig_eff_graph_run2(infile_nominal, graphNamePostfix_nominal_me, x_offset_nominal, sf_file_nominal_me, tagger_and_wp));
+  auto graph_nominal_me = *(create_sig_eff_graph_run2(repo, "ak8_t__tau", "BkgEff0p010", x_offset_nominal));
   graph_nominal_me.SetLineWidth(line_width);
   graph_nominal_me.SetLineColor(kBlue);
   graph_nominal_me.SetLineStyle(line_style_nominal);
@@ -714,10 +706,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_nominal_lo = kYears.at(year).name + "-BkgEff0p025/"+inputGraphName;
   //TGraph graph_nominal_lo = *(TGraph*)infile_nominal->Get(graphName_nominal_lo.c_str());
-  const string graphNamePostfix_nominal_lo = "-BkgEff0p025/"+inputGraphName;
-  TFile* sf_file_nominal_lo = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t__tau-BkgEff0p025/scaleFactors-ak8_t__tau-BkgEff0p025.root", "READ");
-  tagger_and_wp = "ak8_t__tau-BkgEff0p025";
-  auto graph_nominal_lo = *(create_sig_eff_graph_run2(infile_nominal, graphNamePostfix_nominal_lo, x_offset_nominal+x_offset_general, sf_file_nominal_lo, tagger_and_wp));
+  auto graph_nominal_lo = *(create_sig_eff_graph_run2(repo, "ak8_t__tau", "BkgEff0p025", x_offset_nominal+x_offset_general));
   graph_nominal_lo.SetLineWidth(line_width);
   graph_nominal_lo.SetLineColor(kMagenta);
   graph_nominal_lo.SetLineStyle(line_style_nominal);
@@ -730,10 +719,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_nominal_vl = kYears.at(year).name + "-BkgEff0p050/"+inputGraphName;
   //TGraph graph_nominal_vl = *(TGraph*)infile_nominal->Get(graphName_nominal_vl.c_str());
-  const string graphNamePostfix_nominal_vl = "-BkgEff0p050/"+inputGraphName;
-  TFile* sf_file_nominal_vl = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t__tau-BkgEff0p050/scaleFactors-ak8_t__tau-BkgEff0p050.root", "READ");
-  tagger_and_wp = "ak8_t__tau-BkgEff0p050";
-  auto graph_nominal_vl = *(create_sig_eff_graph_run2(infile_nominal, graphNamePostfix_nominal_vl, x_offset_nominal+2*x_offset_general, sf_file_nominal_vl, tagger_and_wp));
+  auto graph_nominal_vl = *(create_sig_eff_graph_run2(repo, "ak8_t__tau", "BkgEff0p050", x_offset_nominal+2*x_offset_general));
   graph_nominal_vl.SetLineWidth(line_width);
   graph_nominal_vl.SetLineColor(kRed);
   graph_nominal_vl.SetLineStyle(line_style_nominal);
@@ -749,10 +735,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_btag_vt = kYears.at(year).name + "-BkgEff0p001/"+inputGraphName;
   //TGraph graph_btag_vt = *(TGraph*)infile_btag->Get(graphName_btag_vt.c_str());
-  const string graphNamePostfix_btag_vt = "-BkgEff0p001/"+inputGraphName;
-  TFile* sf_file_btag_vt = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p001/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p001.root", "READ");
-  tagger_and_wp = "ak8_t_btagDJet__tau-BkgEff0p001";
-  auto graph_btag_vt = *(create_sig_eff_graph_run2(infile_btag, graphNamePostfix_btag_vt, x_offset_btag-2*x_offset_general, sf_file_btag_vt, tagger_and_wp));
+  auto graph_btag_vt = *(create_sig_eff_graph_run2(repo, "ak8_t_btagDJet__tau", "BkgEff0p001", x_offset_btag-2*x_offset_general));
   graph_btag_vt.SetLineWidth(line_width);
   graph_btag_vt.SetLineColor(kGreen);
   graph_btag_vt.SetLineStyle(line_style_btag);
@@ -765,10 +748,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
   
   //const string graphName_btag_ti = kYears.at(year).name + "-BkgEff0p005/"+inputGraphName;
   //TGraph graph_btag_ti = *(TGraph*)infile_btag->Get(graphName_btag_ti.c_str());
-  const string graphNamePostfix_btag_ti = "-BkgEff0p005/"+inputGraphName;
-  TFile* sf_file_btag_ti = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p005/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p005.root", "READ");
-  tagger_and_wp = "ak8_t_btagDJet__tau-BkgEff0p005";
-  auto graph_btag_ti = *(create_sig_eff_graph_run2(infile_btag, graphNamePostfix_btag_ti, x_offset_btag-x_offset_general, sf_file_btag_ti, tagger_and_wp));
+  auto graph_btag_ti = *(create_sig_eff_graph_run2(repo, "ak8_t_btagDJet__tau", "BkgEff0p005", x_offset_btag-x_offset_general));
   graph_btag_ti.SetLineWidth(line_width);
   graph_btag_ti.SetLineColor(kCyan);
   graph_btag_ti.SetLineStyle(line_style_btag);
@@ -781,10 +761,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_btag_me = kYears.at(year).name + "-BkgEff0p010/"+inputGraphName;
   //TGraph graph_btag_me = *(TGraph*)infile_btag->Get(graphName_btag_me.c_str());
-  const string graphNamePostfix_btag_me = "-BkgEff0p010/"+inputGraphName;
-  TFile* sf_file_btag_me = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p010/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p010.root", "READ");
-  tagger_and_wp = "ak8_t_btagDJet__tau-BkgEff0p010";
-  auto graph_btag_me = *(create_sig_eff_graph_run2(infile_btag, graphNamePostfix_btag_me, x_offset_btag, sf_file_btag_me, tagger_and_wp));
+  auto graph_btag_me = *(create_sig_eff_graph_run2(repo, "ak8_t_btagDJet__tau", "BkgEff0p010", x_offset_btag));
   graph_btag_me.SetLineWidth(line_width);
   graph_btag_me.SetLineColor(kBlue);
   graph_btag_me.SetLineStyle(line_style_btag);
@@ -797,10 +774,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_btag_lo = kYears.at(year).name + "-BkgEff0p025/"+inputGraphName;
   //TGraph graph_btag_lo = *(TGraph*)infile_btag->Get(graphName_btag_lo.c_str());
-  const string graphNamePostfix_btag_lo = "-BkgEff0p025/"+inputGraphName;
-  TFile* sf_file_btag_lo = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p025/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p025.root", "READ");
-  tagger_and_wp = "ak8_t_btagDJet__tau-BkgEff0p025";
-  auto graph_btag_lo = *(create_sig_eff_graph_run2(infile_btag, graphNamePostfix_btag_lo, x_offset_btag+x_offset_general, sf_file_btag_lo, tagger_and_wp));
+  auto graph_btag_lo = *(create_sig_eff_graph_run2(repo, "ak8_t_btagDJet__tau", "BkgEff0p025", x_offset_btag+x_offset_general));
   graph_btag_lo.SetLineWidth(line_width);
   graph_btag_lo.SetLineColor(kMagenta);
   graph_btag_lo.SetLineStyle(line_style_btag);
@@ -813,10 +787,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_btag_vl = kYears.at(year).name + "-BkgEff0p050/"+inputGraphName;
   //TGraph graph_btag_vl = *(TGraph*)infile_btag->Get(graphName_btag_vl.c_str());
-  const string graphNamePostfix_btag_vl = "-BkgEff0p050/"+inputGraphName;
-  TFile* sf_file_btag_vl = TFile::Open("scaleFactors_2023-08-10/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p050/scaleFactors-ak8_t_btagDJet__tau-BkgEff0p050.root", "READ");
-  tagger_and_wp = "ak8_t_btagDJet__tau-BkgEff0p050";
-  auto graph_btag_vl = *(create_sig_eff_graph_run2(infile_btag, graphNamePostfix_btag_vl, x_offset_btag+2*x_offset_general, sf_file_btag_vl, tagger_and_wp));
+  auto graph_btag_vl = *(create_sig_eff_graph_run2(repo, "ak8_t_btagDJet__tau", "BkgEff0p050", x_offset_btag+2*x_offset_general));
   graph_btag_vl.SetLineWidth(line_width);
   graph_btag_vl.SetLineColor(kRed);
   graph_btag_vl.SetLineStyle(line_style_btag);
@@ -834,10 +805,7 @@ void do_plot_nsubjettiness(const bool bool_prelim) {
 
   //const string graphName_hotvr = kYears.at(year).name + "-Standard/"+inputGraphName;
   //TGraph graph_hotvr = *(TGraph*)infile_hotvr->Get(graphName_hotvr.c_str());
-  const string graphNamePostfix_hotvr = "-Standard/"+inputGraphName;
-  TFile* sf_file_hotvr = TFile::Open("scaleFactors_2023-08-10/scaleFactors-hotvr_t__tau-Standard/scaleFactors-hotvr_t__tau-Standard.root", "READ");
-  tagger_and_wp = "hotvr_t__tau-Standard";
-  auto graph_hotvr = *(create_sig_eff_graph_run2(infile_hotvr, graphNamePostfix_hotvr, 0., sf_file_hotvr, tagger_and_wp));
+  auto graph_hotvr = *(create_sig_eff_graph_run2(repo, "hotvr_t__tau", "Standard", 0.));
   graph_hotvr.SetLineWidth(line_width);
   graph_hotvr.SetLineColor(kBlack);
   graph_hotvr.SetLineStyle(line_style_nominal);
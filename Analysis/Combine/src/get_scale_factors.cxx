@@ -25,6 +25,9 @@
 #include <sstream>
 #include <iomanip>
 
+#include "UHH2/LegacyTopTagging/Analysis/Combine/include/HistRepository.h"
+#include "UHH2/LegacyTopTagging/Analysis/Combine/include/ScaleFactorStore.h"
+
 using namespace std;
 
 template < typename Type > std::string to_str (const Type & t)
@@ -297,6 +300,13 @@ std::map<JetCategory, std::string> kJetCategoryAsString = {
   {JetCategory::HOTVRCutsAndMass, "HOTVRCutsAndMass"},
 };
 
+// Tagger names of run_combine.py (see _TAGGERS in constants.py), used in the keys of the scale factor store
+const std::map<std::pair<ProbeJetAlgo, JetCategory>, std::string> kCombineTaggerNames = {
+  {{ProbeJetAlgo::isAK8, JetCategory::All}, "ak8_t__tau"},
+  {{ProbeJetAlgo::isAK8, JetCategory::BTag}, "ak8_t_btagDJet__tau"},
+  {{ProbeJetAlgo::isHOTVR, JetCategory::HOTVRCuts}, "hotvr_t__tau"},
+};
+
 enum class ExpObs {
   isExp,
   isObs,
@@ -426,22 +436,47 @@ void ScaleFactorPlotter::Setup()
 }
 
 void ScaleFactorPlotter::ReadScaleFactors() {
+  // Scale factors are taken from the consolidated store written by run_combine.py if it has them, else from the output
+  // file of each fit. The store is keyed like run_combine.py names its tasks: the fit of all pt bins of one year is
+  // "combineTask-<tagger>-<wp>-PtSplit-<year>", the fit of a single pt bin
+  // "combineTask-<tagger>-<wp>-pt_<min>to<max>-<year>"
+  unique_ptr<ScaleFactorStore> store;
+  const TString store_path = fWorkDirBase+"combine/scale_factors.root";
+  const auto combine_tagger = kCombineTaggerNames.find({fAlgo, fJetCat});
+  if(!gSystem->AccessPathName(store_path) && combine_tagger != kCombineTaggerNames.end()) store.reset(new ScaleFactorStore(store_path.Data()));
+  const string store_tagger = store ? combine_tagger->second : "";
+  HistRepository repo; // each file holds the graphs of all merge scenarios, so it is opened once instead of once per scenario
   for(const auto & year : fYears) {
     for(const auto & msc : fMergeScenarios) {
       for(const auto & pt_bin : fPtBins) {
         double pt_above_min = kPtBins.at(pt_bin).pt_min+0.001;
         double pt_below_max = kPtBins.at(pt_bin).pt_max-0.001;
         for(const auto & wp : fWPs) {
+          const PtBinInfo & pt_bin_info = kPtBins.at(pt_bin);
+          const string combine_pt_part = fUsePtAll ? "PtSplit" : "pt_"+to_string((int)pt_bin_info.pt_min)+"to"+(isinf(pt_bin_info.pt_max) ? "Inf" : to_string((int)pt_bin_info.pt_max));
+          const string combine_task_name = "combineTask-"+store_tagger+"-"+kWorkingPoints.at(wp).name+"-"+combine_pt_part+"-"+kYears.at(year).short_name.Data();
+          const ScaleFactorRecord * record = store ? store->find_pt(combine_task_name, store_tagger, kWorkingPoints.at(wp).name, kYears.at(year).short_name.Data(), kMergeScenarios.at(msc).name.Data(), kExpObs.at(fExpObs).short_name.Data(), pt_above_min) : nullptr;
+          if(record) {
+            SFInfo sf;
+            sf.central = record->central;
+            sf.err_tot_up = record->tot_up;
+            sf.err_tot_down = record->tot_down;
+            sf.err_stat_up = record->stat_up;
+            sf.err_stat_down = record->stat_down;
+            sf.err_syst_up = record->syst_up;
+            sf.err_syst_down = record->syst_down;
+            fSFMap[year][msc][pt_bin][wp] = sf;
+            continue;
+          }
           TString file_path_pt_part;
           if(fUsePtAll) file_path_pt_part = "PtAll";
           else file_path_pt_part = kPtBins.at(pt_bin).name;
           TString file_path = fWorkDirBase+kYears.at(year).short_name+"/combine/"+kProbeJetAlgos.at(fAlgo).name+"/"
             +kProbeJetAlgos.at(fAlgo).name+"_"+file_path_pt_part+"_"+kJetCategoryAsString.at(fJetCat)+"_"+kWorkingPoints.at(wp).name
             +"/scale_factors_"+kExpObs.at(fExpObs).short_name+".root";
-          TFile *file = TFile::Open(file_path.Data(), "READ");
           SFInfo sf;
           TString graph_name = kMergeScenarios.at(msc).name+"_tot";
-          TGraphAsymmErrors *graph = (TGraphAsymmErrors*)file->Get(graph_name.Data());
+          shared_ptr<TGraphAsymmErrors> graph = repo.get<TGraphAsymmErrors>(file_path.Data(), graph_name.Data());
           unsigned int ibin(0);
           double x;
           double y;
@@ -454,11 +489,11 @@ void ScaleFactorPlotter::ReadScaleFactors() {
           sf.err_tot_up = graph->GetErrorYhigh(ibin);
           sf.err_tot_down = graph->GetErrorYlow(ibin);
           graph_name = kMergeScenarios.at(msc).name+"_stat";
-          graph = (TGraphAsymmErrors*)file->Get(graph_name.Data());
+          graph = repo.get<TGraphAsymmErrors>(file_path.Data(), graph_name.Data());
           sf.err_stat_up = graph->GetErrorYhigh(ibin);
           sf.err_stat_down = graph->GetErrorYlow(ibin);
           graph_name = kMergeScenarios.at(msc).name+"_syst";
-          graph = (TGraphAsymmErrors*)file->Get(graph_name.Data());
+          graph = repo.get<TGraphAsymmErrors>(file_path.Data(), graph_name.Data());
           sf.err_syst_up = graph->GetErrorYhigh(ibin);
           sf.err_syst_down = graph->GetErrorYlow(ibin);
           fSFMap[year][msc][pt_bin][wp] = sf;
@@ -466,6 +501,7 @@ void ScaleFactorPlotter::ReadScaleFactors() {
       }
     }
   }
+  cout << repo.stats() << endl;
 }
 
 void ScaleFactorPlotter::PlotSingleYears() {
@@ -0,0 +1,83 @@
+#include <TFile.h>
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <iostream>
+#include <string>
+
+#include "UHH2/LegacyTopTagging/include/HistBinning.h"
+
+using namespace std;
+using namespace uhh2::ltt;
+
+/*
+Rebins all one-dimensional histograms of a ROOT file according to a binning file (see include/HistBinning.h), e.g. to
+convert fine-binned outputs of the UHH2 modules into the coarser production binning. Only rebinnings which do not
+lose information are done, i.e. each new bin edge has to coincide with an existing one; histograms for which this is
+not the case are copied unchanged and reported. Everything that is not a TH1 is copied as is.
+
+Usage:
+  ./bin/rebin_hists <binning file> <input.root> <output.root>
+*/
+
+unsigned int n_rebinned = 0;
+unsigned int n_unchanged = 0;
+unsigned int n_not_lossless = 0;
+
+void process_directory(TDirectory *in, TDirectory *out, const string & path, const HistBinningRegistry & registry) {
+
+  TIter next(in->GetListOfKeys());
+  TKey *key;
+  while((key = (TKey*)next())) {
+    if(key->GetCycle() != in->GetKey(key->GetName())->GetCycle()) continue; // only the latest cycle
+    TObject *obj = key->ReadObj();
+    if(obj->InheritsFrom(TDirectory::Class())) {
+      TDirectory *subdir = out->mkdir(key->GetName(), key->GetTitle());
+      process_directory((TDirectory*)obj, subdir, path.empty() ? key->GetName() : path+"/"+key->GetName(), registry);
+      continue;
+    }
+    out->cd();
+    if(obj->InheritsFrom(TH1::Class()) && ((TH1*)obj)->GetDimension() == 1) {
+      TH1 *hist = (TH1*)obj;
+      const TArrayD *xbins = hist->GetXaxis()->GetXbins();
+      const HistBinning source = xbins->GetSize() > 0 ? HistBinning(vector<double>(xbins->GetArray(), xbins->GetArray() + xbins->GetSize())) : HistBinning(hist->GetNbinsX(), hist->GetXaxis()->GetXmin(), hist->GetXaxis()->GetXmax());
+      const HistBinning target = registry.get(path+"/"+hist->GetName(), source);
+      if(target.edge_vector() == source.edge_vector()) {
+        n_unchanged++;
+      }
+      else if(target.is_coarsening_of(source)) {
+        hist = (TH1*)hist->Rebin(target.nbins(), hist->GetName(), target.edges());
+        n_rebinned++;
+      }
+      else {
+        cerr << "Not lossless, keeping original binning: " << path << "/" << hist->GetName() << endl;
+        n_not_lossless++;
+      }
+      hist->Write(key->GetName());
+    }
+    else {
+      obj->Write(key->GetName());
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+
+  if(argc != 4) {
+    cerr << "Usage: " << argv[0] << " <binning file> <input.root> <output.root>" << endl;
+    return 1;
+  }
+  const HistBinningRegistry registry(argv[1]);
+  TFile *infile = TFile::Open(argv[2], "READ");
+  if(infile == nullptr || infile->IsZombie()) {
+    cerr << "Cannot open " << argv[2] << endl;
+    return 1;
+  }
+  TFile *outfile = TFile::Open(argv[3], "RECREATE");
+  process_directory(infile, outfile, "", registry);
+  outfile->Close();
+  infile->Close();
+
+  cout << "Rebinned: " << n_rebinned << ", unchanged: " << n_unchanged << ", not lossless (kept): " << n_not_lossless << endl;
+  return n_not_lossless > 0 ? 2 : 0;
+}
@@ -0,0 +1,262 @@
+#!/usr/bin/env python2
+
+'''
+Local executor for graphs of fit tasks (text2workspace, combine, combineTool, ...), used by run_combine.py.
+
+Each node is a shell command run in a work directory, or a Python function run in this process, with declared input
+and output files. A node depends on the nodes producing its inputs, plus any explicitly given dependencies.
+
+A node is skipped if its outputs exist and its key is unchanged since its last successful run. The key is a hash of
+the command (or signature of the function), of the content of all inputs which are not produced by other nodes
+(datacards, template histograms, ...), and of the keys of the nodes it depends on. ROOT files written by upstream
+nodes therefore do not need to be hashed (their content changes with every write, because of time stamps), and a
+changed datacard still invalidates everything downstream. Digests of input files are cached by path, size, and
+modification time. Keys are saved in task_graph_state.json in the work directory of each node.
+
+Independent nodes run in parallel as long as the sum of their cores stays within the core budget. A node can add
+further nodes when it is done (e.g. one fit per nuisance parameter once the workspace is known), see Node.expand.
+'''
+
+from __future__ import print_function
+
+import os
+import sys
+import errno
+import json
+import hashlib
+import subprocess
+from collections import OrderedDict
+from timeit import default_timer as timer
+
+
+class Node():
+
+    def __init__(self,
+        name, # unique in the graph
+        workdir,
+        command = None, # shell command, or
+        action = None, # function without arguments, run in this process
+        signature = None, # identifies the action in the key; defaults to the command
+        inputs = [],
+        outputs = [],
+        deps = [], # names of further nodes this one has to wait for
+        cores = 1,
+        log_name = None, # logs go to <workdir>/log/<log_name>.log.{out,err}
+        expand = None, # function(graph) called when the node is done or up to date, may add nodes
+    ):
+        if (command is None) == (action is None):
+            sys.exit('Node {} needs either a command or an action'.format(name))
+        self.name = name
+        self.workdir = workdir
+        self.command = command
+        self.action = action
+        self.signature = signature or command or name
+        self.inputs = [os.path.normpath(os.path.join(workdir, x)) for x in inputs]
+        self.outputs = [os.path.normpath(os.path.join(workdir, x)) for x in outputs]
+        self.deps = list(deps)
+        self.cores = cores
+        self.log_name = log_name or name.replace('/', '_')
+        self.expand = expand
+        self.key = None
+        self.status = 'pending' # pending, running, done, cached, failed, skipped
+
+
+class TaskGraph():
+
+    def __init__(self, max_cores=None, dry_run=False, force=False):
+
+        self.max_cores = max_cores or os.sysconf('SC_NPROCESSORS_ONLN')
+        self.dry_run = dry_run # only print what would be run
+        self.force = force # rerun nodes even if up to date
+        self.nodes = OrderedDict()
+        self.producers = {} # output path -> node name
+        self.states = {} # state file path -> {'nodes': {name: key}, 'files': {path: [size, mtime, digest]}}
+
+    def add(self, node):
+
+        if node.name in self.nodes:
+            sys.exit('Duplicate node in task graph: '+node.name)
+        for output in node.outputs:
+            if output in self.producers:
+                sys.exit('Output {} of node {} is already produced by node {}'.format(output, node.name, self.producers[output]))
+            self.producers[output] = node.name
+        self.nodes[node.name] = node
+        return node
+
+    def add_dependency(self, name, dep_name):
+
+        self.nodes[name].deps.append(dep_name)
+
+    def dependencies(self, node):
+
+        result = list(node.deps)
+        for path in node.inputs:
+            if path in self.producers and self.producers[path] not in result:
+                result.append(self.producers[path])
+        return result
+
+    def state(self, node):
+
+        state_path = os.path.join(node.workdir, 'task_graph_state.json')
+        if state_path not in self.states:
+            self.states[state_path] = {'nodes': {}, 'files': {}}
+            if os.path.isfile(state_path):
+                with open(state_path) as f:
+                    self.states[state_path] = json.load(f)
+        return self.states[state_path]
+
+    def save_state(self, node):
+
+        state_path = os.path.join(node.workdir, 'task_graph_state.json')
+        if not os.path.isdir(node.workdir):
+            os.makedirs(node.workdir)
+        with open(state_path+'.tmp', 'w') as f:
+            json.dump(self.state(node), f, indent=1, sort_keys=True)
+        os.rename(state_path+'.tmp', state_path)
+
+    def file_digest(self, node, path):
+
+        st = os.stat(path)
+        cache = self.state(node)['files']
+        cached = cache.get(path)
+        if cached and cached[0] == st.st_size and cached[1] == int(st.st_mtime):
+            return cached[2]
+        h = hashlib.sha1()
+        with open(path, 'rb') as f:
+            for chunk in iter(lambda: f.read(1<<20), b''):
+                h.update(chunk)
+        cache[path] = [st.st_size, int(st.st_mtime), h.hexdigest()]
+        return h.hexdigest()
+
+    def compute_key(self, node):
+
+        # only called once all dependencies are done, so their keys are known
+        h = hashlib.sha1()
+        h.update(node.signature.encode('utf-8'))
+        for dep in sorted(self.dependencies(node)):
+            h.update(('node:'+self.nodes[dep].key).encode('utf-8'))
+        for path in sorted(node.inputs):
+            if path in self.producers:
+                continue
+            if not os.path.isfile(path):
+                return None
+            h.update(('file:'+path+':'+self.file_digest(node, path)).encode('utf-8'))
+        return h.hexdigest()
+
+    def up_to_date(self, node):
+
+        if self.force or self.state(node)['nodes'].get(node.name) != node.key:
+            return False
+        return all(os.path.exists(x) for x in node.outputs)
+
+    def finish(self, node, success):
+
+        state = self.state(node)
+        if success:
+            if node.status != 'cached':
+                node.status = 'done'
+            if not self.dry_run:
+                state['nodes'][node.name] = node.key
+            if node.expand is not None and not (self.dry_run and node.status == 'done'):
+                node.expand(self)
+        else:
+            node.status = 'failed'
+            state['nodes'].pop(node.name, None)
+        if not self.dry_run:
+            self.save_state(node)
+
+    def run(self):
+
+        '''Runs all nodes which are not up to date; returns the names of failed nodes'''
+
+        running = {} # pid -> (node, process, log files, start time)
+        used_cores = 0
+        while True:
+            # resolve everything that can be decided without waiting: up-to-date nodes, Python actions, failed inputs
+            progress = True
+            while progress:
+                progress = False
+                for node in list(self.nodes.values()):
+                    if node.status != 'pending':
+                        continue
+                    deps = [self.nodes[x] for x in self.dependencies(node)]
+                    if any(x.status in ['failed', 'skipped'] for x in deps):
+                        node.status = 'skipped'
+                        print('Skipping {} (a dependency failed)'.format(node.name))
+                        progress = True
+                        continue
+                    if not all(x.status in ['done', 'cached'] for x in deps):
+                        continue
+                    node.key = self.compute_key(node)
+                    if node.key is None:
+                        missing = [x for x in node.inputs if x not in self.producers and not os.path.isfile(x)]
+                        print('Cannot run {}, missing input: {}'.format(node.name, ', '.join(missing)))
+                        self.finish(node, False)
+                        progress = True
+                        continue
+                    if self.up_to_date(node):
+                        node.status = 'cached'
+                        print('Up to date: {}'.format(node.name))
+                        self.finish(node, True)
+                        progress = True
+                        continue
+                    if node.action is not None:
+                        print('Running {}'.format(node.name))
+                        success = True
+                        if not self.dry_run:
+                            try:
+                                node.action()
+                            except Exception as e:
+                                print('{} failed: {}'.format(node.name, e))
+                                success = False
+                        self.finish(node, success)
+                        progress = True
+
+            # start commands in order of insertion while the core budget allows; one node may exceed it if it runs alone
+            started = False
+            for node in self.nodes.values():
+                if node.status != 'pending' or node.key is None:
+                    continue
+                if running and used_cores+node.cores > self.max_cores:
+                    continue
+                print('Running {}'.format(node.name))
+                started = True
+                if self.dry_run:
+                    print('  '+node.command)
+                    self.finish(node, True)
+                    continue
+                logdir = os.path.join(node.workdir, 'log')
+                if not os.path.isdir(logdir):
+                    os.makedirs(logdir)
+                logfile_out = open(os.path.join(logdir, node.log_name+'.log.out'), 'w')
+                logfile_err = open(os.path.join(logdir, node.log_name+'.log.err'), 'w')
+                p = subprocess.Popen((node.command), shell=True, cwd=node.workdir, stdout=logfile_out, stderr=logfile_err)
+                running[p.pid] = (node, p, (logfile_out, logfile_err), timer()) # keeps p alive until os.wait() returns its pid
+                node.status = 'running'
+                used_cores += node.cores
+
+            if not running:
+                if self.dry_run and started:
+                    continue
+                break
+            try:
+                pid, status = os.wait()
+            except OSError as e:
+                if e.errno == errno.EINTR: continue
+                raise
+            if pid not in running:
+                continue
+            node, p, logfiles, start = running.pop(pid)
+            p.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+            for f in logfiles:
+                f.close()
+            used_cores -= node.cores
+            success = p.returncode == 0
+            print('{} {} after {:.1f} sec'.format(node.name, 'finished' if success else 'FAILED', timer() - start))
+            self.finish(node, success)
+
+        counts = OrderedDict((x, 0) for x in ['done', 'cached', 'failed', 'skipped', 'pending'])
+        for node in self.nodes.values():
+            counts[node.status] += 1
+        print('Task graph: '+', '.join('{} {}'.format(v, k) for k, v in counts.items()))
+        return [x.name for x in self.nodes.values() if x.status == 'failed']
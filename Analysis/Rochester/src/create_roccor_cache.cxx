@@ -0,0 +1,46 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "UHH2/LegacyTopTagging/include/RoccoR.h"
+
+using namespace std;
+
+/*
+Converts the Rochester text files into the binary caches read by uhh2::ltt::RochesterCorrections.
+Needs to be rerun whenever one of the text files changes (RochesterCorrections falls back to the text file otherwise).
+
+Usage:
+  ./bin/create_roccor_cache                 # all files known to RochesterCorrections
+  ./bin/create_roccor_cache file1.txt ...   # only the given files
+*/
+
+int main(int argc, char **argv) {
+  vector<string> filenames;
+  for(int i = 1; i < argc; i++) filenames.push_back(argv[i]);
+  if(filenames.empty()) {
+    const char *cmssw_base = getenv("CMSSW_BASE");
+    if(cmssw_base == nullptr) {
+      cerr << "CMSSW_BASE not set. Did you do 'cmsenv'?" << endl;
+      return 1;
+    }
+    const string dir = (string)cmssw_base+"/src/UHH2/LegacyTopTagging/data/rochester/";
+    for(const char *name : {"RoccoR2016", "RoccoR2017", "RoccoR2018", "RoccoR2016aUL", "RoccoR2016bUL", "RoccoR2017UL", "RoccoR2018UL"}) {
+      filenames.push_back(dir+name+".txt");
+    }
+  }
+
+  for(const string & filename : filenames) {
+    RoccoR rc(filename);
+    const string cachename = RoccoR::cacheName(filename);
+    rc.writeCache(cachename, filename);
+    RoccoR check;
+    if(!check.initFromCache(cachename, filename)) {
+      cerr << "Failed to read back " << cachename << endl;
+      return 1;
+    }
+    cout << filename << " -> " << cachename << endl;
+  }
+  return 0;
+}
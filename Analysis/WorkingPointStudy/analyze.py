@@ -25,6 +25,7 @@ parser = argparse.ArgumentParser()
 parser.add_argument('-y', '--year', type=str, choices=options_year)
 parser.add_argument('-r', '--recalculate', action='store_true', help='Recalculate the efficiencies and do not use already existing numpy outfiles for the TGraphs')
 parser.add_argument('-p', '--pool', action='store_true', help='Use parallel threading (each analyzed tagger gets one thread)')
+parser.add_argument('-w', '--write-jobs', action='store_true', help='Only write the job file for the compiled scan_efficiencies engine, which replaces the recalculation and TGraph conversion')
 args = parser.parse_args(sys.argv[1:])
 
 recalculate = args.recalculate
@@ -34,11 +35,12 @@ if args.pool:
 
 if recalculate:
     import uproot
-else:
+elif not args.write_jobs:
     from ROOT import TGraph, TFile
 
 inputDir = os.environ.get("CMSSW_BASE")+'/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/'+year+'/nominal/'
 file_name_prefix = 'uhh2.AnalysisModuleRunner.MC.'
+scan_steps = 1000
 
 scan_vars = {
     'tau32': VarInterval('tau32', 0, 1, inversed=True),
@@ -83,7 +85,38 @@ def get_matching_rule(key):
     else:
         sys.exit('Cannot determine matching rule based on tagger name')
 
-def scan_eff_vs_variable(arr_weight_, arr_variable_, scan_var, norm=None, steps=1000, do_pbar=True):
+def get_rules(key, var=None):
+    # returns tag rules and norm rules for background and signal; without var, the cut on the var interval is left out
+    var_rule = '({0} > {1}) & ({0} < {2})'.format(var.var, var.var_min, var.var_max) if var else 'True'
+    rule_bkg = '({tag_rule}) & ({var_rule})'.format(tag_rule=_TAGGERS[key].get_tag_rule(year=year), var_rule=var_rule)
+    norm_rule_bkg = '({var_rule})'.format(var_rule=var_rule)
+    rule_sig = '(({expr}) & ({matching_rule}))'.format(expr=rule_bkg, matching_rule=get_matching_rule(key))
+    norm_rule_sig = '(({expr_norm}) & ({matching_rule}))'.format(expr_norm=norm_rule_bkg, matching_rule=get_matching_rule(key))
+    return rule_bkg, norm_rule_bkg, rule_sig, norm_rule_sig
+
+def write_jobs(taggers):
+    # one line per tagger and interval, read by scan_efficiencies.cxx; the rules do not contain the interval cut since
+    # scan_efficiencies shares one pass over the trees between all intervals of a tagger
+    jobs_file_path = os.path.join(inputDir, 'scan_efficiencies_jobs.txt')
+    with open(jobs_file_path, 'w') as jobs_file:
+        for tagger_k in taggers:
+            tagger_v = _TAGGERS[tagger_k]
+            file_path_bkg, file_path_sig = get_file_names(tagger_k, year)
+            scan_var = scan_vars[tagger_v.scan_var]
+            rule_bkg, norm_rule_bkg, rule_sig, norm_rule_sig = get_rules(tagger_k)
+            for var in tagger_v.var_intervals.values():
+                fields = [
+                    tagger_k, var.name, os.path.join(inputDir, tagger_k, var.name),
+                    scan_var.var, str(scan_var.var_min), str(scan_var.var_max), '1' if scan_var.inversed else '0', str(scan_steps),
+                    var.var, str(var.var_min), str(var.var_max),
+                    os.path.join(inputDir, file_path_bkg), rule_bkg, norm_rule_bkg,
+                    os.path.join(inputDir, file_path_sig), rule_sig, norm_rule_sig,
+                ]
+                jobs_file.write('\t'.join(fields)+'\n')
+    print('Written job file:', jobs_file_path)
+    print('Run: ./scan_efficiencies', jobs_file_path)
+
+def scan_eff_vs_variable(arr_weight_, arr_variable_, scan_var, norm=None, steps=scan_steps, do_pbar=True):
     arr_weight = arr_weight_
     arr_variable = arr_variable_
     x = np.array([scan_var.var_max if scan_var.inversed else scan_var.var_min], dtype='f')
@@ -121,17 +154,14 @@ def analyze_tagger(tagger_k, pool=False):
         if recalculate:
             if not pool: print('(Re-)calculate efficiencies')
             if not pool: print('Background')
-            expr = '({tag_rule}) & ({var_rule})'.format(tag_rule=tagger_v.get_tag_rule(year=year), var_rule='({0} > {1}) & ({0} < {2})'.format(var.var, var.var_min, var.var_max))
+            expr, expr_norm, expr_sig, expr_norm_sig = get_rules(tagger_k, var)
             arrays_bkg = tree_bkg.arrays(['weight', scan_var.var], expr)
-            expr_norm = '({var_rule})'.format(var_rule='({0} > {1}) & ({0} < {2})'.format(var.var, var.var_min, var.var_max))
             norm = np.sum(tree_bkg.arrays(['weight'], expr_norm)['weight'])
             var_cuts, eff_bkg = scan_eff_vs_variable(arrays_bkg['weight'], arrays_bkg[scan_var.var], scan_var, norm=norm, do_pbar=(not pool))
             np.save(os.path.join(outputDir, 'eff_bkg.npy'), eff_bkg)
             if not pool: print('Signal')
-            expr = '(({expr}) & ({matching_rule}))'.format(expr=expr, matching_rule=get_matching_rule(tagger_k))
-            arrays_sig = tree_sig.arrays(['weight', scan_var.var], expr)
-            expr_norm = '(({expr_norm}) & ({matching_rule}))'.format(expr_norm=expr_norm, matching_rule=get_matching_rule(tagger_k))
-            norm = np.sum(tree_sig.arrays(['weight'], expr_norm)['weight'])
+            arrays_sig = tree_sig.arrays(['weight', scan_var.var], expr_sig)
+            norm = np.sum(tree_sig.arrays(['weight'], expr_norm_sig)['weight'])
             var_cuts, eff_sig = scan_eff_vs_variable(arrays_sig['weight'], arrays_sig[scan_var.var], scan_var, norm=norm, do_pbar=(not pool))
             np.save(os.path.join(outputDir, 'eff_sig.npy'), eff_sig)
             np.save(os.path.join(outputDir, 'var_cuts.npy'), var_cuts)
@@ -182,6 +212,10 @@ if __name__=='__main__':
         'ak8_t_btagDCSV__tau',
         'ak8_t_btagDJet__tau',
     ]
+    if args.write_jobs:
+        # all taggers are evaluated in the same pass over the trees, so there is no need to select some of them
+        write_jobs([k for k, v in _TAGGERS.items() if v.scan_var in scan_vars])
+        sys.exit(0)
     sets_of_args = []
     for tagger in _TAGGERS_to_analyze:
         set_of_args = {}
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "../constants.h"
+#include "working_point_solver.h"
 
 using namespace macros;
 
@@ -18,7 +19,10 @@ typedef struct {
   float real_eff_bkg;
   float real_eff_sig;
   float scan_cut;
-  int scan_cut_i; // index of point of TGraph at which the cut is
+  float scan_cut_down; // range of cuts compatible with target_eff_bkg within its uncertainty
+  float scan_cut_up;
+  float real_eff_sig_down;
+  float real_eff_sig_up;
   // float real_eff_qcd_with_btag;
   // float real_eff_ttbar_with_btag;
 } WorkingPoint;
@@ -76,28 +80,61 @@ typedef struct {
 //   }
 // }
 
-WorkingPoint init_working_point(const float eff, const TGraph * graph_eff_bkg, const TGraph * graph_eff_sig) {
-  WorkingPoint result = { .target_eff_bkg = eff };
-  int scan_cut_i;
-  for(int i = graph_eff_bkg->GetN()-1; i >= 0; i--) {
-    double x, y;
-    graph_eff_bkg->GetPoint(i, x, y);
-    if(y < eff) {
-      result.real_eff_bkg = y;
-      result.scan_cut = x;
-      scan_cut_i = i;
-      if(i != graph_eff_bkg->GetN()-1) {
-        double x_before, y_before;
-        graph_eff_bkg->GetPoint(i+1, x_before, y_before);
-        if(abs(y_before - eff) < abs(y - eff)) { result.real_eff_bkg = y_before; result.scan_cut = x_before; scan_cut_i = i+1; }
-      }
-      break;
-    }
+// Graphs of one tagger and pt bin, given the path of the graphs.root written by analyze.py. If the consolidated file
+// of scan_efficiencies.cxx (roc_curves.root next to the tagger directories) exists, the graphs are taken from there
+TDirectory * open_graphs(const string & graphs_path) {
+  static map<string, TFile*> consolidated_files;
+  const string pt_bin_path = graphs_path.substr(0, graphs_path.find_last_of('/'));
+  const string tagger_path = pt_bin_path.substr(0, pt_bin_path.find_last_of('/'));
+  const string base_path = tagger_path.substr(0, tagger_path.find_last_of('/'));
+  const string consolidated_path = base_path+"/roc_curves.root";
+  if(consolidated_files.find(consolidated_path) == consolidated_files.end()) {
+    consolidated_files[consolidated_path] = gSystem->AccessPathName(consolidated_path.c_str()) ? nullptr : TFile::Open(consolidated_path.c_str(), "READ");
   }
-  double x, y;
-  graph_eff_sig->GetPoint(scan_cut_i, x, y);
-  result.real_eff_sig = y;
-  result.scan_cut_i = scan_cut_i;
+  TFile *consolidated_file = consolidated_files.at(consolidated_path);
+  if(consolidated_file == nullptr) return TFile::Open(graphs_path.c_str(), "READ");
+  const string dir_name = tagger_path.substr(base_path.size() + 1)+"/"+pt_bin_path.substr(tagger_path.size() + 1);
+  TDirectory *dir = consolidated_file->GetDirectory(dir_name.c_str());
+  if(dir == nullptr) throw runtime_error("No directory "+dir_name+" in "+consolidated_path);
+  return dir;
+}
+
+// The consolidated file stays open for all further calls of open_graphs()
+void close_graphs(TDirectory * graphs) {
+  if(dynamic_cast<TFile*>(graphs) != nullptr) graphs->Close();
+}
+
+// n_eff_bkg and n_eff_sig are only written by scan_efficiencies.cxx; without them, the WPs have no uncertainties
+WorkingPointSolver get_working_point_solver(TDirectory * infile) {
+  const TGraph* graph_eff_bkg = (TGraph*)infile->Get("eff_bkg");
+  const TGraph* graph_eff_sig = (TGraph*)infile->Get("eff_sig");
+  const TParameter<double>* n_eff_bkg = (TParameter<double>*)infile->Get("n_eff_bkg");
+  const TParameter<double>* n_eff_sig = (TParameter<double>*)infile->Get("n_eff_sig");
+  return WorkingPointSolver(graph_eff_bkg, graph_eff_sig, n_eff_bkg ? n_eff_bkg->GetVal() : -1., n_eff_sig ? n_eff_sig->GetVal() : -1.);
+}
+
+WorkingPoint to_working_point(const float target_eff_bkg, const SolvedWorkingPoint & solved) {
+  WorkingPoint result = { .target_eff_bkg = target_eff_bkg };
+  result.real_eff_bkg = solved.eff_bkg;
+  result.real_eff_sig = solved.eff_sig;
+  result.scan_cut = solved.cut;
+  result.scan_cut_down = solved.cut_down;
+  result.scan_cut_up = solved.cut_up;
+  result.real_eff_sig_down = solved.eff_sig_down;
+  result.real_eff_sig_up = solved.eff_sig_up;
+  return result;
+}
+
+// Exact cut at which the interpolated background efficiency equals the target, not just the closest scan step
+WorkingPoint init_working_point(const float eff, const WorkingPointSolver & solver) {
+  return to_working_point(eff, solver.solve(eff));
+}
+
+// Same cut as a WP derived elsewhere (e.g. for the base tagger or the reference pt bin); target eff only valid there
+WorkingPoint transfer_working_point(const WorkingPoint & wp_ref, const WorkingPointSolver & solver) {
+  WorkingPoint result = to_working_point(-1., solver.at_cut(wp_ref.scan_cut));
+  result.scan_cut_down = wp_ref.scan_cut_down;
+  result.scan_cut_up = wp_ref.scan_cut_up;
   return result;
 }
 
@@ -134,77 +171,58 @@ void print_working_point(const WorkingPoint & wp) {
   cout << ">>> WP: <<<" << endl;
   cout << "Target eff BKG:    " << wp.target_eff_bkg << endl;
   cout << "Actual eff BKG:    " << wp.real_eff_bkg << endl;
-  cout << "Actual eff SIG:    " << wp.real_eff_sig << endl;
-  cout << "Scan variable cut: " << wp.scan_cut << endl;
+  cout << "Actual eff SIG:    " << wp.real_eff_sig << " [" << wp.real_eff_sig_down << ", " << wp.real_eff_sig_up << "]" << endl;
+  cout << "Scan variable cut: " << wp.scan_cut << " [" << wp.scan_cut_down << ", " << wp.scan_cut_up << "]" << endl;
 }
 
 void calculate_working_points(const Year & year, Tagger & tagger, const PtBin & pt_bin, const bool print=false) {
   const string infilePath = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+tagger.name_base+"/"+pt_bin.name+"/graphs.root";
-  TFile* infile = TFile::Open(infilePath.c_str(), "READ");
-  const TGraph* graph_eff_bkg = (TGraph*)infile->Get("eff_bkg");
-  const TGraph* graph_eff_sig = (TGraph*)infile->Get("eff_sig");
+  TDirectory* infile = open_graphs(infilePath);
+  const WorkingPointSolver solver = get_working_point_solver(infile);
 
   for(const auto & eff : tagger.target_effs_bkg) {
-    WorkingPoint wp = init_working_point(eff, graph_eff_bkg, graph_eff_sig);
+    WorkingPoint wp = init_working_point(eff, solver);
     tagger.wps[tagger.name_base].push_back(wp);
     if(print) print_working_point(wp);
   }
-  infile->Close();
+  close_graphs(infile);
 
   for(const auto & variant : tagger.name_variants) {
     const string infilePath_var = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+variant+"/"+pt_bin.name+"/graphs.root";
-    TFile* infile_var = TFile::Open(infilePath_var.c_str(), "READ");
-    const TGraph* graph_eff_bkg_var = (TGraph*)infile_var->Get("eff_bkg");
-    const TGraph* graph_eff_sig_var = (TGraph*)infile_var->Get("eff_sig");
+    TDirectory* infile_var = open_graphs(infilePath_var);
+    const WorkingPointSolver solver_var = get_working_point_solver(infile_var);
     for(const auto & wp_base : tagger.wps.at(tagger.name_base)) {
-      double x, y;
-      WorkingPoint wp_var = { .target_eff_bkg = -1., .scan_cut = wp_base.scan_cut, .scan_cut_i = wp_base.scan_cut_i }; // target eff only valid for base tagger, e.g. ak8_t__tau
-      graph_eff_bkg_var->GetPoint(wp_base.scan_cut_i, x, y);
-      wp_var.real_eff_bkg = y;
-      graph_eff_sig_var->GetPoint(wp_base.scan_cut_i, x, y);
-      wp_var.real_eff_sig = y;
+      WorkingPoint wp_var = transfer_working_point(wp_base, solver_var); // target eff only valid for base tagger, e.g. ak8_t__tau
       tagger.wps[variant].push_back(wp_var);
       if(print) print_working_point(wp_var);
     }
-    infile_var->Close();
+    close_graphs(infile_var);
   }
 }
 
 
 void get_reference_working_points(const Year & year, Tagger & tagger, const PtBin & pt_bin, const Tagger & reference_tagger, const bool print=false) {
   const string infilePath = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+tagger.name_base+"/"+pt_bin.name+"/graphs.root";
-  TFile* infile = TFile::Open(infilePath.c_str(), "READ");
-  const TGraph* graph_eff_bkg = (TGraph*)infile->Get("eff_bkg");
-  const TGraph* graph_eff_sig = (TGraph*)infile->Get("eff_sig");
+  TDirectory* infile = open_graphs(infilePath);
+  const WorkingPointSolver solver = get_working_point_solver(infile);
 
   for(const auto & wp_ref : reference_tagger.wps.at(reference_tagger.name_base)) {
-    double x, y;
-    WorkingPoint wp = { .target_eff_bkg = -1., .scan_cut = wp_ref.scan_cut, .scan_cut_i = wp_ref.scan_cut_i };
-    graph_eff_bkg->GetPoint(wp_ref.scan_cut_i, x, y);
-    wp.real_eff_bkg = y;
-    graph_eff_sig->GetPoint(wp_ref.scan_cut_i, x, y);
-    wp.real_eff_sig = y;
+    WorkingPoint wp = transfer_working_point(wp_ref, solver);
     tagger.wps[tagger.name_base].push_back(wp);
     if(print) print_working_point(wp);
   }
-  infile->Close();
+  close_graphs(infile);
 
   for(const auto & variant : tagger.name_variants) {
     const string infilePath_var = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+variant+"/"+pt_bin.name+"/graphs.root";
-    TFile* infile_var = TFile::Open(infilePath_var.c_str(), "READ");
-    const TGraph* graph_eff_bkg_var = (TGraph*)infile_var->Get("eff_bkg");
-    const TGraph* graph_eff_sig_var = (TGraph*)infile_var->Get("eff_sig");
+    TDirectory* infile_var = open_graphs(infilePath_var);
+    const WorkingPointSolver solver_var = get_working_point_solver(infile_var);
     for(const auto & wp_ref : reference_tagger.wps.at(reference_tagger.name_base)) {
-      double x, y;
-      WorkingPoint wp_var = { .target_eff_bkg = -1., .scan_cut = wp_ref.scan_cut, .scan_cut_i = wp_ref.scan_cut_i }; // target eff only valid for base tagger, e.g. ak8_t__tau
-      graph_eff_bkg_var->GetPoint(wp_ref.scan_cut_i, x, y);
-      wp_var.real_eff_bkg = y;
-      graph_eff_sig_var->GetPoint(wp_ref.scan_cut_i, x, y);
-      wp_var.real_eff_sig = y;
+      WorkingPoint wp_var = transfer_working_point(wp_ref, solver_var); // target eff only valid for base tagger, e.g. ak8_t__tau
       tagger.wps[variant].push_back(wp_var);
       if(print) print_working_point(wp_var);
     }
-    infile_var->Close();
+    close_graphs(infile_var);
   }
 }
 
@@ -282,26 +300,26 @@ void do_plot(
   vector<string> legends;
 
   const string infilePath = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+tagger.name_base+"/"+pt_bin.name+"/graphs.root";
-  TFile* infile = TFile::Open(infilePath.c_str(), "READ");
+  TDirectory* infile = open_graphs(infilePath);
   graph_pipe = *(TGraph*)infile->Get(graph_base_name.c_str());
   graph_pipe.SetLineWidth(2);
   graph_pipe.SetLineStyle(1);
   graph_pipe.SetLineColor(kRed);
   graphs.push_back(graph_pipe);
   legends.push_back(tagger.legend_base);
-  infile->Close();
+  close_graphs(infile);
 
   int iterator = 0;
   for(const auto & variant : tagger.name_variants) {
     const string infilePath_var = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+variant+"/"+pt_bin.name+"/graphs.root";
-    TFile* infile_var = TFile::Open(infilePath_var.c_str(), "READ");
+    TDirectory* infile_var = open_graphs(infilePath_var);
     graph_pipe = *(TGraph*)infile_var->Get(graph_base_name.c_str());
     graph_pipe.SetLineWidth(2);
     graph_pipe.SetLineStyle(tagger.linestyle_variants.at(iterator));
     graph_pipe.SetLineColor(tagger.linecolor_variants.at(iterator));
     graphs.push_back(graph_pipe);
     legends.push_back(tagger.legend_variants.at(iterator));
-    infile_var->Close();
+    close_graphs(infile_var);
     iterator++;
   }
 
@@ -576,7 +594,7 @@ void do_summary_plot(
   vector<TGraph> graphs;
   for(const auto & pt_bin : pt_bins) {
     const string infilePath = (string)getenv("CMSSW_BASE")+"/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/"+kYears.at(year).name+"/nominal/"+variant+"/"+pt_bin.name+"/graphs.root";
-    TFile* infile = TFile::Open(infilePath.c_str(), "READ");
+    TDirectory* infile = open_graphs(infilePath);
     graphs.push_back(*(TGraph*)infile->Get(graph_base_name.c_str()));
   }
 
@@ -948,7 +966,7 @@ void do_plot_all_years(
   for(const auto & year_ : kAllYears) {
     const auto year = kYears.at(year_);
     infilePath = infilePathBase+year.name+"/nominal/"+tagger.name_base+"/"+pt_bin.name+"/graphs.root";
-    TFile* infile = TFile::Open(infilePath.c_str(), "READ");
+    TDirectory* infile = open_graphs(infilePath);
     graph_pipe = *(TGraph*)infile->Get(graph_base_name.c_str());
     graph_pipe.SetLineWidth(2);
     graph_pipe.SetLineStyle(year.linestyle);
@@ -957,7 +975,7 @@ void do_plot_all_years(
     TString year_nice_name = year.nice_name;
     year_nice_name.ReplaceAll("Ultra Legacy ", "");
     legends.push_back(string(year_nice_name.Data()));
-    infile->Close();
+    close_graphs(infile);
   }
 
 
@@ -0,0 +1,585 @@
+#include <TFile.h>
+#include <TGraph.h>
+#include <TParameter.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include "working_point_solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace macros;
+
+/*
+Compiled replacement of the efficiency calculation of "analyze.py -r". Computes the efficiency and ROC curves, AUCs,
+and working points of all taggers and pt intervals in one pass over the restructured trees and writes them to one
+consolidated file (default: roc_curves.root next to the job file), which plots.cxx reads:
+
+  <tagger>/<pt interval>/{eff_bkg,eff_sig,roc}  TGraphs, same points as the graphs.root of analyze.py
+  <tagger>/<pt interval>/{n_eff_bkg,n_eff_sig}  effective number of entries of the efficiency denominators
+  <tagger>/<pt interval>/auc                    area under the ROC curve
+  working_points                                TTree with the WP table (cuts for --wp-effs, with uncertainties)
+
+The jobs (one line per tagger and pt interval) are written by "python analyze.py -y <year> -w". Each input file is
+read only once, in chunks of --chunk-size entries, by a pool of threads (one file per thread). Jobs which only differ
+by the pt interval share one accumulator: a 2D array of the sum of weights in (cut grid bin) x (pt segment), where
+the pt segments are the open ranges between all interval edges plus the edges themselves. Each pt interval is then a
+range of segments, so all intervals are derived from the arrays in memory by a second pool of threads.
+
+The efficiencies are only needed at the points of the fixed cut grid of analyze.py (steps+1 cut values between
+var_min and var_max), so instead of repeating the sum for each cut, every jet adds its weight to the grid bin given by
+the number of cuts it passes. A prefix sum over these bins then gives the sum of weights passing each cut. This is
+exact, including the strict inequalities (var > cut, or var < cut if inversed) and jets outside [var_min, var_max].
+
+The selections are the numexpr-style rules of constants.py, i.e. conjunctions like "(msd > 105) & (dr < reff)" of
+comparisons between a branch and a number or another branch; "True" selects everything.
+
+Build and run:
+  g++ -O2 -pthread -o scan_efficiencies scan_efficiencies.cxx $(root-config --cflags --glibs)
+  ./scan_efficiencies $CMSSW_BASE/src/UHH2/LegacyTopTagging/output/WorkingPointStudy/UL17/nominal/scan_efficiencies_jobs.txt -j 8
+*/
+
+enum class Op { kLess, kLessEqual, kGreater, kGreaterEqual, kEqual, kNotEqual };
+
+typedef struct {
+  unsigned int lhs; // column index
+  Op op;
+  int rhs; // column index, or -1 if comparing to value
+  float value;
+} Cut;
+
+// Branches of one input file which are needed by any of its jobs; each gets one column in the chunk buffers
+class Columns {
+public:
+  unsigned int index(const string & branch) {
+    const auto it = fIndices.find(branch);
+    if(it != fIndices.end()) return it->second;
+    fIndices[branch] = fNames.size();
+    fNames.push_back(branch);
+    return fNames.size() - 1;
+  }
+  const vector<string> & names() const { return fNames; }
+private:
+  map<string, unsigned int> fIndices;
+  vector<string> fNames;
+};
+
+string strip(const string & s, const string & chars = " \t()") {
+  const size_t first = s.find_first_not_of(chars);
+  if(first == string::npos) return "";
+  return s.substr(first, s.find_last_not_of(chars) - first + 1);
+}
+
+vector<Cut> parse_rule(const string & rule, Columns & columns) {
+  vector<Cut> result;
+  stringstream terms(rule);
+  string term;
+  while(getline(terms, term, '&')) {
+    term = strip(term);
+    if(term.empty()) continue; // "&&"
+    if(term == "True") continue;
+    static const vector<pair<string, Op>> kOps = {
+      { "<=", Op::kLessEqual }, { ">=", Op::kGreaterEqual }, { "==", Op::kEqual }, { "!=", Op::kNotEqual }, { "<", Op::kLess }, { ">", Op::kGreater },
+    };
+    bool parsed = false;
+    for(const auto & op : kOps) {
+      const size_t pos = term.find(op.first);
+      if(pos == string::npos) continue;
+      const string lhs = strip(term.substr(0, pos));
+      const string rhs = strip(term.substr(pos + op.first.size()));
+      if(lhs.empty() || rhs.empty()) break;
+      Cut cut;
+      cut.lhs = columns.index(lhs);
+      cut.op = op.second;
+      cut.rhs = -1;
+      cut.value = 0.;
+      size_t n_parsed(0);
+      try { cut.value = stof(rhs, &n_parsed); } catch(const invalid_argument &) {}
+      if(n_parsed != rhs.size()) cut.rhs = columns.index(rhs);
+      result.push_back(cut);
+      parsed = true;
+      break;
+    }
+    if(!parsed) throw invalid_argument("Cannot parse term '"+term+"' of rule '"+rule+"' (only conjunctions of comparisons are supported)");
+  }
+  return result;
+}
+
+// Sets mask[i] to 0 for all entries of the chunk failing any of the cuts
+void apply_rule(const vector<Cut> & rule, const vector<vector<float>> & columns, const size_t n, vector<char> & mask) {
+  mask.assign(n, 1);
+  for(const Cut & cut : rule) {
+    const float *a = columns.at(cut.lhs).data();
+    const float *b = cut.rhs >= 0 ? columns.at(cut.rhs).data() : nullptr;
+    const float value = cut.value;
+    for(size_t i = 0; i < n; i++) {
+      const float x = b ? b[i] : value;
+      bool pass;
+      switch(cut.op) {
+        case Op::kLess: pass = a[i] < x; break;
+        case Op::kLessEqual: pass = a[i] <= x; break;
+        case Op::kGreater: pass = a[i] > x; break;
+        case Op::kGreaterEqual: pass = a[i] >= x; break;
+        case Op::kEqual: pass = a[i] == x; break;
+        default: pass = a[i] != x;
+      }
+      mask[i] &= pass;
+    }
+  }
+}
+
+// Cut grid of scan_eff_vs_variable() in analyze.py: cut(i) = i*(var_max-var_min)/steps + var_min. If not inversed,
+// the cuts i = 1..steps are applied as "var > cut(i)", else the cuts i = 0..steps-1 as "var < cut(i)"
+class CutGrid {
+public:
+  CutGrid(const double var_min, const double var_max, const unsigned int steps, const bool inversed):
+    fMin(var_min), fMax(var_max), fSteps(steps), fInversed(inversed) {}
+  double cut(const unsigned int i) const { return double(i)*(fMax - fMin)/fSteps + fMin; }
+  unsigned int steps() const { return fSteps; }
+  bool inversed() const { return fInversed; }
+  double var_min() const { return fMin; }
+  double var_max() const { return fMax; }
+
+  // Not inversed: number of cuts passed, i.e. the jet passes the cuts 1..bin
+  // Inversed: number of cuts failed, i.e. the jet passes the cuts bin..steps-1
+  unsigned int bin(const float var) const {
+    if(std::isnan(var)) return fInversed ? fSteps : 0;
+    const double v = var;
+    const unsigned int offset = fInversed ? 0 : 1;
+    const auto below = [&](const unsigned int i) { return fInversed ? cut(i) <= v : cut(i) < v; }; // i-th cut of the grid (counting from offset) is below v
+    // initial guess from the cut spacing, then exact comparisons against the same cut values as analyze.py
+    double guess = floor((v - fMin) * fSteps / (fMax - fMin)) + 1. - offset;
+    guess = max(0., min(double(fSteps), guess));
+    unsigned int result = guess;
+    while(result < fSteps && below(result + offset)) ++result;
+    while(result > 0 && !below(result - 1 + offset)) --result;
+    return result;
+  }
+private:
+  const double fMin, fMax;
+  const unsigned int fSteps;
+  const bool fInversed;
+};
+
+// Exact binning of the pt interval variable: with the sorted interval edges e_0 < ... < e_m-1, segment 2k+1 holds the
+// values equal to e_k, segment 2k the values strictly between e_k-1 and e_k. The interval (e_a, e_b) (strict, as in
+// analyze.py) is then segments 2a+2 to 2b. NaN goes into an extra segment not contained in any interval
+class IntervalAxis {
+public:
+  void add_edge(const double edge) { fEdges.push_back(edge); }
+  void finalize() {
+    sort(fEdges.begin(), fEdges.end());
+    fEdges.erase(unique(fEdges.begin(), fEdges.end()), fEdges.end());
+  }
+  unsigned int n_segments() const { return 2 * fEdges.size() + 2; }
+  unsigned int segment(const float var) const {
+    if(std::isnan(var)) return n_segments() - 1;
+    const size_t k = lower_bound(fEdges.begin(), fEdges.end(), (double)var) - fEdges.begin();
+    return (k < fEdges.size() && fEdges[k] == var) ? 2 * k + 1 : 2 * k;
+  }
+  pair<unsigned int, unsigned int> segments(const double interval_min, const double interval_max) const {
+    const size_t a = lower_bound(fEdges.begin(), fEdges.end(), interval_min) - fEdges.begin();
+    const size_t b = lower_bound(fEdges.begin(), fEdges.end(), interval_max) - fEdges.begin();
+    return { 2 * a + 2, 2 * b };
+  }
+private:
+  vector<double> fEdges;
+};
+
+typedef struct {
+  string path;
+  string rule;
+  string norm_rule;
+} Sample;
+
+typedef struct {
+  string tagger;
+  string interval;
+  string outdir;
+  string scan_var;
+  CutGrid grid;
+  string interval_var;
+  double interval_min;
+  double interval_max;
+  Sample bkg;
+  Sample sig;
+} Job;
+
+// Sums of weights of one sample of one tagger, for all pt intervals
+class Accumulator {
+public:
+  Accumulator(const CutGrid & grid, const unsigned int var, const unsigned int interval_var, const vector<Cut> & rule, const vector<Cut> & norm_rule):
+    fGrid(grid), fVar(var), fIntervalVar(interval_var), fRule(rule), fNormRule(norm_rule) {}
+
+  IntervalAxis & axis() { return fAxis; }
+  void finalize() {
+    fAxis.finalize();
+    fBins.assign((fGrid.steps() + 1) * fAxis.n_segments(), 0.);
+    fNorm.assign(fAxis.n_segments(), 0.);
+    fNormSumw2.assign(fAxis.n_segments(), 0.);
+  }
+
+  void fill(const vector<vector<float>> & columns, const unsigned int weight, const size_t n, vector<char> & mask, vector<unsigned int> & segments) {
+    const float *w = columns.at(weight).data();
+    const float *v = columns.at(fVar).data();
+    const float *p = columns.at(fIntervalVar).data();
+    segments.resize(n);
+    for(size_t i = 0; i < n; i++) segments[i] = fAxis.segment(p[i]);
+    apply_rule(fNormRule, columns, n, mask);
+    for(size_t i = 0; i < n; i++) {
+      if(mask[i]) {
+        fNorm[segments[i]] += w[i];
+        fNormSumw2[segments[i]] += w[i] * w[i];
+      }
+    }
+    apply_rule(fRule, columns, n, mask);
+    const unsigned int n_segments = fAxis.n_segments();
+    for(size_t i = 0; i < n; i++) {
+      if(mask[i]) fBins[fGrid.bin(v[i]) * n_segments + segments[i]] += w[i];
+    }
+  }
+
+  // Same points and order as scan_eff_vs_variable() in analyze.py: the first point (cut at var_min if not inversed,
+  // var_max if inversed) is the sum of all weights passing the rule
+  void efficiencies(const double interval_min, const double interval_max, vector<double> & x, vector<double> & y, double & n_eff) const {
+    const pair<unsigned int, unsigned int> range = fAxis.segments(interval_min, interval_max);
+    const unsigned int n_segments = fAxis.n_segments();
+    const unsigned int steps = fGrid.steps();
+    vector<double> bins(steps + 1, 0.);
+    double norm(0.), norm_sumw2(0.), total(0.);
+    for(unsigned int s = range.first; s <= range.second; s++) {
+      norm += fNorm.at(s);
+      norm_sumw2 += fNormSumw2.at(s);
+      for(unsigned int i = 0; i <= steps; i++) bins[i] += fBins[i * n_segments + s];
+    }
+    for(const double b : bins) total += b;
+    x.assign(steps + 1, 0.);
+    y.assign(steps + 1, 0.);
+    double sum(0.);
+    if(fGrid.inversed()) {
+      for(unsigned int i = 0; i < steps; i++) {
+        sum += bins.at(i);
+        x.at(i) = fGrid.cut(i);
+        y.at(i) = sum;
+      }
+      x.at(steps) = fGrid.var_max();
+      y.at(steps) = total;
+    }
+    else {
+      for(unsigned int i = steps; i >= 1; i--) {
+        sum += bins.at(i);
+        x.at(steps - i) = fGrid.cut(i);
+        y.at(steps - i) = sum;
+      }
+      x.at(steps) = fGrid.var_min();
+      y.at(steps) = total;
+    }
+    for(double & e : y) e /= norm;
+    // effective number of entries of the efficiency denominator, used for the uncertainties of the working points
+    n_eff = norm_sumw2 > 0. ? norm * norm / norm_sumw2 : 0.;
+  }
+
+private:
+  const CutGrid fGrid;
+  const unsigned int fVar;
+  const unsigned int fIntervalVar;
+  const vector<Cut> fRule;
+  const vector<Cut> fNormRule;
+  IntervalAxis fAxis;
+  vector<double> fBins; // (steps+1) x n_segments
+  vector<double> fNorm;
+  vector<double> fNormSumw2;
+};
+
+// One input file and all accumulators filled from it
+typedef struct {
+  string path;
+  Columns columns;
+  vector<unique_ptr<Accumulator>> accumulators;
+  vector<string> keys; // identify accumulators which can be shared between jobs
+} FileJob;
+
+// Everything derived for one tagger and pt interval
+typedef struct {
+  vector<double> var_cuts;
+  vector<double> eff_bkg;
+  vector<double> eff_sig;
+  double n_eff_bkg;
+  double n_eff_sig;
+  double auc;
+  vector<pair<double, SolvedWorkingPoint>> wps; // target bkg eff, WP
+} Result;
+
+// Area under the ROC curve (signal vs. background efficiency), closed with (0, 0) and (1, 1). For taggers with a
+// preselection (e.g. an msd window), the line from the loosest cut to (1, 1) corresponds to dropping the preselection
+double area_under_roc(const vector<double> & eff_sig, const vector<double> & eff_bkg) {
+  vector<pair<double, double>> points = { {0., 0.}, {1., 1.} };
+  for(unsigned int i = 0; i < eff_sig.size(); i++) points.push_back({eff_bkg.at(i), eff_sig.at(i)});
+  sort(points.begin(), points.end());
+  double result(0.);
+  for(unsigned int i = 1; i < points.size(); i++) result += 0.5 * (points.at(i).second + points.at(i-1).second) * (points.at(i).first - points.at(i-1).first);
+  return result;
+}
+
+vector<Job> read_jobs(const string & jobs_path) {
+  ifstream file(jobs_path);
+  if(!file) throw runtime_error("Cannot open job file "+jobs_path);
+  vector<Job> result;
+  string line;
+  unsigned int i_line(0);
+  while(getline(file, line)) {
+    ++i_line;
+    if(strip(line, " \t").empty() || strip(line, " \t").front() == '#') continue;
+    vector<string> fields;
+    stringstream fields_stream(line);
+    string field;
+    while(getline(fields_stream, field, '\t')) fields.push_back(field);
+    if(fields.size() != 17) throw runtime_error("Job file "+jobs_path+", line "+to_string(i_line)+": expected 17 tab-separated fields, found "+to_string(fields.size()));
+    result.push_back(Job{
+      fields.at(0), fields.at(1), fields.at(2), fields.at(3),
+      CutGrid(stod(fields.at(4)), stod(fields.at(5)), stoi(fields.at(7)), fields.at(6) == "1"),
+      fields.at(8), stod(fields.at(9)), stod(fields.at(10)),
+      Sample{fields.at(11), fields.at(12), fields.at(13)},
+      Sample{fields.at(14), fields.at(15), fields.at(16)},
+    });
+  }
+  return result;
+}
+
+void process_file(FileJob & file_job, const size_t chunk_size, mutex & cout_mutex) {
+  unique_ptr<TFile> file(TFile::Open(file_job.path.c_str(), "READ"));
+  if(!file || file->IsZombie()) throw runtime_error("Cannot open "+file_job.path);
+  TTree *tree = (TTree*)file->Get("my_tree");
+  if(tree == nullptr) throw runtime_error("No tree 'my_tree' in "+file_job.path);
+
+  const vector<string> & names = file_job.columns.names();
+  vector<float> values(names.size());
+  tree->SetBranchStatus("*", 0);
+  for(unsigned int i = 0; i < names.size(); i++) {
+    if(tree->GetBranch(names.at(i).c_str()) == nullptr) throw runtime_error("No branch '"+names.at(i)+"' in "+file_job.path);
+    tree->SetBranchStatus(names.at(i).c_str(), 1);
+    tree->SetBranchAddress(names.at(i).c_str(), &values.at(i));
+  }
+  const unsigned int weight = file_job.columns.index("weight");
+
+  const Long64_t entries = tree->GetEntries();
+  {
+    lock_guard<mutex> lock(cout_mutex);
+    cout << "Processing " << entries << " entries for " << file_job.accumulators.size() << " samples: " << file_job.path << endl;
+  }
+  vector<vector<float>> columns(names.size(), vector<float>(chunk_size));
+  vector<char> mask;
+  vector<unsigned int> segments;
+  for(Long64_t first = 0; first < entries; first += chunk_size) {
+    const size_t n = min((Long64_t)chunk_size, entries - first);
+    for(size_t i = 0; i < n; i++) {
+      tree->GetEntry(first + i);
+      for(unsigned int c = 0; c < values.size(); c++) columns[c][i] = values[c];
+    }
+    for(auto & accumulator : file_job.accumulators) accumulator->fill(columns, weight, n, mask, segments);
+  }
+}
+
+// Runs task(0), ..., task(n_tasks-1) on a pool of threads; returns false if any task threw
+bool run_pool(const unsigned int n_tasks, const unsigned int n_threads, const function<void(unsigned int)> & task, mutex & cout_mutex) {
+  atomic<unsigned int> next_task(0);
+  atomic<bool> failed(false);
+  const auto worker = [&]() {
+    for(unsigned int i_task = next_task++; i_task < n_tasks; i_task = next_task++) {
+      try {
+        task(i_task);
+      }
+      catch(const exception & e) {
+        lock_guard<mutex> lock(cout_mutex);
+        cerr << e.what() << endl;
+        failed = true;
+      }
+    }
+  };
+  vector<thread> pool;
+  for(unsigned int i = 0; i < min(n_threads, n_tasks); i++) pool.emplace_back(worker);
+  for(thread & t : pool) t.join();
+  return !failed;
+}
+
+int main(int argc, char **argv) {
+
+  const string usage = string("Usage: ")+argv[0]+" <job file> [-o <output file>] [-j <threads>] [--chunk-size <entries>] [--wp-effs <effs>]";
+  string jobs_path;
+  string output_path;
+  unsigned int n_threads = max(1u, thread::hardware_concurrency());
+  size_t chunk_size = 1000000;
+  vector<double> wp_effs = { 0.001, 0.005, 0.01, 0.025, 0.05 };
+
+  for(int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if((arg == "-j" || arg == "--threads") && i + 1 < argc) n_threads = max(1, stoi(argv[++i]));
+    else if((arg == "-o" || arg == "--output") && i + 1 < argc) output_path = argv[++i];
+    else if(arg == "--chunk-size" && i + 1 < argc) chunk_size = max(1, stoi(argv[++i]));
+    else if(arg == "--wp-effs" && i + 1 < argc) {
+      wp_effs.clear();
+      stringstream effs(argv[++i]);
+      string eff;
+      while(getline(effs, eff, ',')) wp_effs.push_back(stod(eff));
+    }
+    else if(jobs_path.empty() && arg.front() != '-') jobs_path = arg;
+    else {
+      cerr << usage << endl;
+      return 1;
+    }
+  }
+  if(jobs_path.empty()) {
+    cerr << usage << endl;
+    return 1;
+  }
+  if(output_path.empty()) {
+    const size_t slash = jobs_path.find_last_of('/');
+    output_path = (slash == string::npos ? "" : jobs_path.substr(0, slash + 1))+"roc_curves.root";
+  }
+
+  vector<Job> jobs;
+  // Group the samples of all jobs by input file; sample_index[job] = {index of bkg, index of sig} as (file, accumulator)
+  vector<FileJob> file_jobs;
+  vector<pair<pair<unsigned int, unsigned int>, pair<unsigned int, unsigned int>>> sample_index;
+  try {
+    jobs = read_jobs(jobs_path);
+    const auto add_sample = [&file_jobs](const Job & job, const Sample & sample) {
+      auto it = find_if(file_jobs.begin(), file_jobs.end(), [&sample](const FileJob & f){ return f.path == sample.path; });
+      if(it == file_jobs.end()) {
+        file_jobs.emplace_back();
+        file_jobs.back().path = sample.path;
+        it = file_jobs.end() - 1;
+      }
+      stringstream key;
+      key << job.scan_var << "\t" << job.grid.var_min() << "\t" << job.grid.var_max() << "\t" << job.grid.steps() << "\t" << job.grid.inversed()
+        << "\t" << job.interval_var << "\t" << sample.rule << "\t" << sample.norm_rule;
+      auto key_it = find(it->keys.begin(), it->keys.end(), key.str());
+      if(key_it == it->keys.end()) {
+        Columns & columns = it->columns;
+        columns.index("weight");
+        const unsigned int var = columns.index(job.scan_var);
+        const unsigned int interval_var = columns.index(job.interval_var);
+        const vector<Cut> rule = parse_rule(sample.rule, columns);
+        const vector<Cut> norm_rule = parse_rule(sample.norm_rule, columns);
+        it->accumulators.emplace_back(new Accumulator(job.grid, var, interval_var, rule, norm_rule));
+        it->keys.push_back(key.str());
+        key_it = it->keys.end() - 1;
+      }
+      const unsigned int i_accumulator = key_it - it->keys.begin();
+      it->accumulators.at(i_accumulator)->axis().add_edge(job.interval_min);
+      it->accumulators.at(i_accumulator)->axis().add_edge(job.interval_max);
+      return make_pair((unsigned int)(it - file_jobs.begin()), i_accumulator);
+    };
+    for(const Job & job : jobs) {
+      const auto bkg = add_sample(job, job.bkg);
+      const auto sig = add_sample(job, job.sig);
+      sample_index.push_back({bkg, sig});
+    }
+    for(FileJob & file_job : file_jobs) {
+      for(auto & accumulator : file_job.accumulators) accumulator->finalize();
+    }
+  }
+  catch(const exception & e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  cout << "Read " << jobs.size() << " jobs using " << file_jobs.size() << " input files" << endl;
+
+  ROOT::EnableThreadSafety();
+  mutex cout_mutex;
+  if(!run_pool(file_jobs.size(), n_threads, [&](const unsigned int i) { process_file(file_jobs.at(i), chunk_size, cout_mutex); }, cout_mutex)) return 1;
+
+  // Curves, AUC, and WPs of all pt intervals from the accumulated arrays
+  vector<Result> results(jobs.size());
+  const auto derive = [&](const unsigned int i_job) {
+    const Job & job = jobs.at(i_job);
+    const auto & bkg = sample_index.at(i_job).first;
+    const auto & sig = sample_index.at(i_job).second;
+    Result & result = results.at(i_job);
+    file_jobs.at(bkg.first).accumulators.at(bkg.second)->efficiencies(job.interval_min, job.interval_max, result.var_cuts, result.eff_bkg, result.n_eff_bkg);
+    file_jobs.at(sig.first).accumulators.at(sig.second)->efficiencies(job.interval_min, job.interval_max, result.var_cuts, result.eff_sig, result.n_eff_sig);
+    result.auc = area_under_roc(result.eff_sig, result.eff_bkg);
+    const int n = result.var_cuts.size();
+    const TGraph graph_eff_bkg(n, result.var_cuts.data(), result.eff_bkg.data());
+    const TGraph graph_eff_sig(n, result.var_cuts.data(), result.eff_sig.data());
+    const WorkingPointSolver solver(&graph_eff_bkg, &graph_eff_sig, result.n_eff_bkg, result.n_eff_sig);
+    for(const double eff : wp_effs) result.wps.push_back({eff, solver.solve(eff)});
+  };
+  if(!run_pool(jobs.size(), n_threads, derive, cout_mutex)) return 1;
+
+  unique_ptr<TFile> outfile(TFile::Open(output_path.c_str(), "RECREATE"));
+  if(!outfile || outfile->IsZombie()) {
+    cerr << "Cannot create " << output_path << endl;
+    return 1;
+  }
+  string wp_tagger, wp_interval;
+  double wp_target, wp_cut, wp_cut_down, wp_cut_up, wp_eff_bkg, wp_eff_sig, wp_eff_sig_down, wp_eff_sig_up;
+  outfile->cd();
+  TTree *wp_tree = new TTree("working_points", "working points of all taggers and pt intervals");
+  wp_tree->Branch("tagger", &wp_tagger);
+  wp_tree->Branch("interval", &wp_interval);
+  wp_tree->Branch("target_eff_bkg", &wp_target);
+  wp_tree->Branch("cut", &wp_cut);
+  wp_tree->Branch("cut_down", &wp_cut_down);
+  wp_tree->Branch("cut_up", &wp_cut_up);
+  wp_tree->Branch("eff_bkg", &wp_eff_bkg);
+  wp_tree->Branch("eff_sig", &wp_eff_sig);
+  wp_tree->Branch("eff_sig_down", &wp_eff_sig_down);
+  wp_tree->Branch("eff_sig_up", &wp_eff_sig_up);
+  cout << left << setw(28) << "tagger" << setw(20) << "interval" << right << setw(8) << "AUC";
+  for(const double eff : wp_effs) cout << setw(18) << ("cut@"+to_string(eff).substr(0, 5));
+  cout << endl;
+  for(unsigned int i_job = 0; i_job < jobs.size(); i_job++) {
+    const Job & job = jobs.at(i_job);
+    const Result & result = results.at(i_job);
+    gSystem->mkdir(job.outdir.c_str(), true); // plots.cxx puts its plots there
+    TDirectory *dir = outfile->GetDirectory(job.tagger.c_str());
+    if(dir == nullptr) dir = outfile->mkdir(job.tagger.c_str());
+    dir = dir->mkdir(job.interval.c_str());
+    dir->cd();
+    const int n = result.var_cuts.size();
+    TGraph(n, result.var_cuts.data(), result.eff_bkg.data()).Write("eff_bkg");
+    TGraph(n, result.var_cuts.data(), result.eff_sig.data()).Write("eff_sig");
+    TGraph(n, result.eff_sig.data(), result.eff_bkg.data()).Write("roc");
+    TParameter<double>("n_eff_bkg", result.n_eff_bkg).Write();
+    TParameter<double>("n_eff_sig", result.n_eff_sig).Write();
+    TParameter<double>("auc", result.auc).Write();
+    cout << left << setw(28) << job.tagger << setw(20) << job.interval << right << setw(8) << fixed << setprecision(4) << result.auc;
+    for(const auto & wp : result.wps) {
+      wp_tagger = job.tagger;
+      wp_interval = job.interval;
+      wp_target = wp.first;
+      wp_cut = wp.second.cut;
+      wp_cut_down = wp.second.cut_down;
+      wp_cut_up = wp.second.cut_up;
+      wp_eff_bkg = wp.second.eff_bkg;
+      wp_eff_sig = wp.second.eff_sig;
+      wp_eff_sig_down = wp.second.eff_sig_down;
+      wp_eff_sig_up = wp.second.eff_sig_up;
+      wp_tree->Fill();
+      cout << setw(18) << setprecision(4) << wp_cut;
+    }
+    cout << endl;
+  }
+  outfile->cd();
+  wp_tree->Write();
+  outfile->Close();
+  cout << "Written " << jobs.size() << " taggers/intervals to " << output_path << endl;
+  return 0;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "TEfficiency.h"
+#include "TGraph.h"
+
+namespace macros {
+
+// Monotone interpolant y(x) of an efficiency curve (e.g. eff_bkg vs. cut value), built from the points of a TGraph.
+// The points are sorted by x and made monotone by isotonic regression (pool adjacent violators), which only changes
+// anything if negative weights produced small wiggles. Between the points, a monotone cubic Hermite spline
+// (Fritsch-Carlson slopes) is used, so both eval(x) and the inverse solve(y) are exact on the points, smooth in
+// between, and O(log N).
+class MonotoneCurve {
+public:
+  MonotoneCurve(const TGraph * graph) {
+    std::vector<std::pair<double, double>> points;
+    for(int i = 0; i < graph->GetN(); i++) {
+      double x, y;
+      graph->GetPoint(i, x, y);
+      if(std::isfinite(x) && std::isfinite(y)) points.push_back({x, y});
+    }
+    std::sort(points.begin(), points.end());
+    for(const auto & p : points) {
+      if(!fX.empty() && p.first == fX.back()) continue;
+      fX.push_back(p.first);
+      fY.push_back(p.second);
+    }
+    if(fX.size() < 2) throw std::runtime_error("MonotoneCurve: need at least two distinct points");
+    fIncreasing = fY.back() >= fY.front();
+    make_monotone();
+    init_slopes();
+  }
+
+  double eval(const double x) const {
+    if(x <= fX.front()) return fY.front();
+    if(x >= fX.back()) return fY.back();
+    const size_t i = std::upper_bound(fX.begin(), fX.end(), x) - fX.begin() - 1;
+    return hermite(i, x);
+  }
+
+  // Inverse of eval(); if y is outside the range of the curve, the x of the closest end point is returned
+  double solve(const double y) const {
+    const double y_first = fIncreasing ? fY.front() : fY.back();
+    const double y_last = fIncreasing ? fY.back() : fY.front();
+    if(y <= y_first) return fIncreasing ? fX.front() : fX.back();
+    if(y >= y_last) return fIncreasing ? fX.back() : fX.front();
+    // index i of the segment [x_i, x_i+1] containing y
+    size_t i;
+    if(fIncreasing) i = std::lower_bound(fY.begin(), fY.end(), y) - fY.begin() - 1;
+    else i = std::lower_bound(fY.begin(), fY.end(), y, std::greater<double>()) - fY.begin() - 1;
+    // bisection within the segment; the spline is monotone there, so this always converges
+    double lo = fX.at(i), hi = fX.at(i + 1);
+    for(int iteration = 0; iteration < 60; iteration++) {
+      const double mid = 0.5 * (lo + hi);
+      if((hermite(i, mid) < y) == fIncreasing) lo = mid;
+      else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+  }
+
+private:
+  void make_monotone() {
+    // pool adjacent violators on the sign-flipped curve if decreasing
+    const double sign = fIncreasing ? 1. : -1.;
+    std::vector<double> value, weight;
+    std::vector<size_t> size;
+    for(const double y : fY) {
+      value.push_back(sign * y);
+      weight.push_back(1.);
+      size.push_back(1);
+      while(value.size() > 1 && value.at(value.size() - 2) > value.back()) {
+        const size_t n = value.size();
+        value.at(n - 2) = (value.at(n - 2) * weight.at(n - 2) + value.back() * weight.back()) / (weight.at(n - 2) + weight.back());
+        weight.at(n - 2) += weight.back();
+        size.at(n - 2) += size.back();
+        value.pop_back();
+        weight.pop_back();
+        size.pop_back();
+      }
+    }
+    size_t k = 0;
+    for(size_t block = 0; block < value.size(); block++) {
+      for(size_t j = 0; j < size.at(block); j++) fY.at(k++) = sign * value.at(block);
+    }
+  }
+
+  void init_slopes() {
+    const size_t n = fX.size();
+    std::vector<double> delta(n - 1);
+    for(size_t i = 0; i < n - 1; i++) delta.at(i) = (fY.at(i + 1) - fY.at(i)) / (fX.at(i + 1) - fX.at(i));
+    fM.assign(n, 0.);
+    fM.front() = delta.front();
+    fM.back() = delta.back();
+    for(size_t i = 1; i < n - 1; i++) fM.at(i) = (delta.at(i - 1) * delta.at(i) > 0.) ? 0.5 * (delta.at(i - 1) + delta.at(i)) : 0.;
+    for(size_t i = 0; i < n - 1; i++) {
+      if(delta.at(i) == 0.) {
+        fM.at(i) = 0.;
+        fM.at(i + 1) = 0.;
+        continue;
+      }
+      const double a = fM.at(i) / delta.at(i);
+      const double b = fM.at(i + 1) / delta.at(i);
+      const double r = a * a + b * b;
+      if(r > 9.) {
+        const double t = 3. / std::sqrt(r);
+        fM.at(i) = t * a * delta.at(i);
+        fM.at(i + 1) = t * b * delta.at(i);
+      }
+    }
+  }
+
+  double hermite(const size_t i, const double x) const {
+    const double h = fX.at(i + 1) - fX.at(i);
+    const double t = (x - fX.at(i)) / h;
+    const double t2 = t * t, t3 = t2 * t;
+    return (2*t3 - 3*t2 + 1) * fY.at(i) + (t3 - 2*t2 + t) * h * fM.at(i) + (-2*t3 + 3*t2) * fY.at(i + 1) + (t3 - t2) * h * fM.at(i + 1);
+  }
+
+  std::vector<double> fX, fY, fM;
+  bool fIncreasing;
+};
+
+typedef struct {
+  double cut;
+  double cut_down; // cut range within which the background efficiency is compatible with the target
+  double cut_up;
+  double eff_bkg;
+  double eff_sig;
+  double eff_sig_down;
+  double eff_sig_up;
+} SolvedWorkingPoint;
+
+// Solves for the cut value at which the background efficiency equals a target value, and gives the signal
+// efficiency at that cut. The uncertainties are Clopper-Pearson intervals using the effective number of entries
+// n_eff = (sum w)^2 / sum w^2 of the efficiency denominators (written by scan_efficiencies.cxx). The cut interval
+// is the range of cuts for which the measured background efficiency lies in the interval of the target; the signal
+// efficiency interval is the one at the solved cut. Without n_eff (n_eff <= 0), the intervals collapse to the
+// central values.
+class WorkingPointSolver {
+public:
+  WorkingPointSolver(const TGraph * graph_eff_bkg, const TGraph * graph_eff_sig, const double n_eff_bkg = -1., const double n_eff_sig = -1., const double confidence_level = 0.682689):
+    fBkg(graph_eff_bkg), fSig(graph_eff_sig), fNEffBkg(n_eff_bkg), fNEffSig(n_eff_sig), fConfidenceLevel(confidence_level) {}
+
+  SolvedWorkingPoint solve(const double target_eff_bkg) const {
+    SolvedWorkingPoint result = at_cut(fBkg.solve(target_eff_bkg));
+    const double cut_a = fNEffBkg > 0. ? fBkg.solve(clopper_pearson(target_eff_bkg, fNEffBkg, false)) : result.cut;
+    const double cut_b = fNEffBkg > 0. ? fBkg.solve(clopper_pearson(target_eff_bkg, fNEffBkg, true)) : result.cut;
+    result.cut_down = std::min(cut_a, cut_b);
+    result.cut_up = std::max(cut_a, cut_b);
+    return result;
+  }
+
+  // Efficiencies at a given cut, e.g. of a working point derived for another tagger variant or pt bin
+  SolvedWorkingPoint at_cut(const double cut) const {
+    SolvedWorkingPoint result;
+    result.cut = cut;
+    result.cut_down = cut;
+    result.cut_up = cut;
+    result.eff_bkg = fBkg.eval(cut);
+    result.eff_sig = fSig.eval(cut);
+    result.eff_sig_down = fNEffSig > 0. ? clopper_pearson(result.eff_sig, fNEffSig, false) : result.eff_sig;
+    result.eff_sig_up = fNEffSig > 0. ? clopper_pearson(result.eff_sig, fNEffSig, true) : result.eff_sig;
+    return result;
+  }
+
+private:
+  // TEfficiency::ClopperPearson takes integer counts, so the effective (weighted) numbers of events are rounded here
+  double clopper_pearson(const double eff, const double n_eff, const bool upper) const {
+    const UInt_t total = std::lround(std::max(0., n_eff));
+    const UInt_t passed = std::lround(std::max(0., std::min(1., eff)) * total);
+    return TEfficiency::ClopperPearson(total, passed, fConfidenceLevel, upper);
+  }
+
+  const MonotoneCurve fBkg;
+  const MonotoneCurve fSig;
+  const double fNEffBkg;
+  const double fNEffSig;
+  const double fConfidenceLevel;
+};
+
+}
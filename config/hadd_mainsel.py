@@ -6,6 +6,7 @@ import numpy as np
 import ROOT as root
 import subprocess
 import multiprocessing
+from sampleMetadata import sampleMetadata
 
 sys.path.append(os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/Analysis'))
 from constants import _JECSMEAR_SOURCES
@@ -220,6 +221,8 @@ parser.add_argument('-s', '--systs', choices=possible_systs, nargs='+', default=
 parser.add_argument('--all', action='store_true', help='Instead of defining the syst directories via --syst, you can hadd all of them in one go.')
 parser.add_argument('-t', '--targets', choices=dict_sourceFiles.keys(), nargs='+', default=dict_sourceFiles.keys(), help='E. g., if you choose "TTbar__FullyMerged", then only this target root file will be created.')
 parser.add_argument('-f', '--force', action='store_true', help='''Use hadd's -f option. Force overwriting of output files.''')
+parser.add_argument('--hadd', action='store_true', help='Use hadd instead of the native merge_trees tool (build it with: g++ -O2 -o merge_trees merge_trees.cxx $(root-config --cflags --glibs))')
+parser.add_argument('-j', '--jobs', type=int, default=2, help='Number of parallel merges per target file (merge_trees only)')
 args = parser.parse_args(sys.argv[1:])
 
 if not args.all:
@@ -230,6 +233,12 @@ print args_systs
 
 # sys.exit()
 
+mergeTreesPath = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'merge_trees')
+if not args.hadd and not os.path.isfile(mergeTreesPath):
+    sys.exit('merge_trees not found. Build it with "g++ -O2 -o merge_trees merge_trees.cxx $(root-config --cflags --glibs)" or use --hadd')
+if args.hadd:
+    metadata = sampleMetadata()
+
 mainselOutputDir = os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/output/TagAndProbe/mainsel')
 
 hadd_tasks = list() # pairs of command_string, logFilePath (see below)
@@ -268,14 +277,20 @@ for year in args.years:
                 if len(sourceFilePaths) == 0:
                     continue
 
+                if not args.hadd:
+                    # merge_trees sorts the inputs itself, merges them as a parallel binary tree, validates the event counts, and can resume after a failure
+                    command_string = 'nice -n 10 '+mergeTreesPath+' -j '+str(args.jobs)+' '
+                    if args.force:
+                        command_string += '-f '
+                    command_string += '-o '+targetFilePath+' '+' '.join([x for x in sourceFilePaths])
+                    logFilePath = os.path.join(logDir, 'log.'+key+'.txt')
+                    hadd_tasks.append([command_string, logFilePath])
+                    continue
+
                 # In the following few lines, we sort the root files which are to be hadded by the number of events stored in their analysis trees
                 # (there is a bug in hadd that would lead to not correctly added trees if the first file in the list has no events; in case that all trees are empty, we have nothing to fear)
-                numbersOfEntries = np.array([])
-                for rootFileName in sourceFilePaths:
-                    rootFile = root.TFile.Open(rootFileName, 'READ')
-                    print rootFileName
-                    numbersOfEntries = np.append(numbersOfEntries, rootFile.Get('AnalysisTree').GetEntries())
-                numbersOfEntries.flatten()
+                # The numbers of entries are cached by sampleMetadata, so only new or changed files are opened
+                numbersOfEntries = np.array(metadata.entries('mainsel_'+'_'.join([year, channel, syst, key]), list(sourceFilePaths)))
                 # print numbersOfEntries
                 sourceFilePaths = sourceFilePaths[np.argsort(-numbersOfEntries)]
                 # print sourceFilePaths
@@ -293,8 +308,13 @@ for year in args.years:
 FNULL = open(os.devnull, 'w')
 
 def hadd_task(args): # args = [command, logfile]
-    process = subprocess.Popen([args[0]+' > '+args[1]], shell=True, stdout=FNULL, stderr=FNULL)
+    process = subprocess.Popen([args[0]+' > '+args[1]+' 2>&1'], shell=True, stdout=FNULL, stderr=FNULL)
     process.wait()
+    if process.returncode != 0:
+        print 'Failed (see '+args[1]+'): '+args[0]
 
-p = multiprocessing.Pool(multiprocessing.cpu_count() / 2) # only use half of all CPU threads to be friendly to other users
+n_workers = multiprocessing.cpu_count() / 2 # only use half of all CPU threads to be friendly to other users
+if not args.hadd:
+    n_workers = max(1, n_workers / args.jobs) # each merge_trees call runs up to args.jobs merges in parallel
+p = multiprocessing.Pool(n_workers)
 p.map(hadd_task, hadd_tasks)
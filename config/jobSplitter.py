@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+
+'''
+Cost model for the job splitting of xmlCreator.py.
+
+The throughput of each sample class is measured from the logs of previous jobs (or of a profiling run, e.g. a few
+jobs of each sample run with run_local.py): SelectionScheduler prints the number of events and the wall time of the
+event loop at the end of each job. From this, the split sizes are chosen such that a job takes about the target wall
+time:
+- main selection: NEventsBreak = target time * events per second
+- preselection: FileSplit = target time * events per second / entries per input file, if the entries of the sample
+  are in the cache of sampleMetadata.py, else target time / seconds per input file
+
+Record the throughput of finished jobs with:
+  ./jobSplitter.py record -s mainsel workdir_mainsel_UL17_muo workdir_mainsel_UL18_muo ...
+'''
+
+import os
+import sys
+import re
+import json
+import argparse
+from collections import OrderedDict
+
+_THROUGHPUT_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'throughput.json')
+
+_LOG_PATTERN = re.compile(r'event loop: ([0-9]+) events in ([0-9.]+) s wall time')
+
+
+def sample_class(name):
+
+   '''Cost class of a sample nick name or of a job/log file name derived from it; the TTbar samples share one class'''
+
+   name = os.path.basename(name)
+   if name.startswith('TTbar'): return 'TTbar'
+   return name.split('_')[0]
+
+
+def round_split(value):
+
+   '''Rounds down to 1, 2, or 5 times a power of ten, so that samples with similar throughput get the same split'''
+
+   if value < 1: return 1
+   base = 10**(len(str(int(value)))-1)
+   for step in [5, 2, 1]:
+      if step*base <= value: return step*base
+
+
+class jobSplitter:
+
+   '''Chooses the split size of each sample from the measured throughput of its sample class'''
+
+   def __init__(self, selection: str, targetJobWallTime: float, throughputFile=_THROUGHPUT_FILE):
+
+      self.selection = selection
+      self.targetJobWallTime = targetJobWallTime
+      self.throughput = dict()
+      if os.path.isfile(throughputFile):
+         with open(throughputFile, 'r') as file:
+            self.throughput = json.load(file).get(selection, dict())
+
+   def n_events_break(self, nickName: str, default: int):
+
+      measurement = self.throughput.get(sample_class(nickName))
+      if not measurement or not measurement.get('events_per_second'): return default
+      return round_split(self.targetJobWallTime*measurement['events_per_second'])
+
+   def file_split(self, nickName: str, default: int, entries_per_file=None):
+
+      measurement = self.throughput.get(sample_class(nickName))
+      if measurement and measurement.get('events_per_second') and entries_per_file:
+         return round_split(self.targetJobWallTime*measurement['events_per_second']/entries_per_file)
+      if not measurement or not measurement.get('seconds_per_file'): return default
+      return round_split(self.targetJobWallTime/measurement['seconds_per_file'])
+
+
+def read_job_logs(workdirs: list):
+
+   '''Sums events, wall time, and input files of all job logs found in the workdirs, per sample class'''
+
+   sums = OrderedDict()
+   for workdir in workdirs:
+      for dirpath, dirnames, filenames in os.walk(workdir):
+         for filename in sorted(filenames):
+            if filename.endswith('.xml') or filename.endswith('.root'): continue
+            with open(os.path.join(dirpath, filename), 'r', errors='replace') as file:
+               match = _LOG_PATTERN.search(file.read())
+            if not match or int(match.group(1)) == 0 or float(match.group(2)) <= 0.: continue
+            # the log belongs to the job XML <dataset>_<number>.xml
+            job = re.match(r'(.*_[0-9]+)', filename)
+            if not job: continue
+            n_files = 0
+            if os.path.isfile(os.path.join(dirpath, job.group(1)+'.xml')):
+               with open(os.path.join(dirpath, job.group(1)+'.xml'), 'r') as file:
+                  n_files = len(re.findall(r'<In\s+FileName', file.read()))
+            s = sums.setdefault(sample_class(filename), {'n_jobs': 0, 'events': 0, 'seconds': 0., 'files': 0})
+            s['n_jobs'] += 1
+            s['events'] += int(match.group(1))
+            s['seconds'] += float(match.group(2))
+            s['files'] += n_files
+   return sums
+
+
+def record(selection: str, workdirs: list, throughputFile=_THROUGHPUT_FILE):
+
+   throughput = dict()
+   if os.path.isfile(throughputFile):
+      with open(throughputFile, 'r') as file:
+         throughput = json.load(file)
+   measurements = throughput.setdefault(selection, dict())
+   for k, s in read_job_logs(workdirs).items():
+      measurements[k] = {
+         'n_jobs': s['n_jobs'],
+         'events_per_second': s['events']/s['seconds'],
+         'seconds_per_file': s['seconds']/s['files'] if s['files'] else None,
+      }
+      print('{:<24}{:>8} jobs{:>12.1f} events/s'.format(k, s['n_jobs'], measurements[k]['events_per_second'])+('{:>12.1f} s/file'.format(measurements[k]['seconds_per_file']) if s['files'] else ''))
+   with open(throughputFile+'.tmp', 'w') as file:
+      json.dump(throughput, file, indent=2, sort_keys=True)
+   os.rename(throughputFile+'.tmp', throughputFile)
+   print('Updated '+throughputFile)
+
+
+if __name__=='__main__':
+
+   parser = argparse.ArgumentParser(description='Record the throughput of each sample class from job logs, for the job splitting of xmlCreator.py.')
+   parser.add_argument('mode', choices=['record', 'show'])
+   parser.add_argument('-s', '--selection', choices=['presel', 'mainsel'], required=True)
+   parser.add_argument('-t', '--job-time', type=float, default=2., help='Target job wall time in hours (for "show").')
+   parser.add_argument('workdirs', nargs='*', help='Work directories containing the job logs (for "record").')
+   args = parser.parse_args(sys.argv[1:])
+
+   if args.mode == 'record':
+      if not args.workdirs: sys.exit('No work directories given. Exit.')
+      record(args.selection, args.workdirs)
+   else:
+      splitter = jobSplitter(args.selection, args.job_time*3600.)
+      for k, measurement in sorted(splitter.throughput.items()):
+         if args.selection == 'mainsel':
+            print('{:<24}NEventsBreak={}'.format(k, splitter.n_events_break(k, None)))
+         else:
+            print('{:<24}FileSplit={}'.format(k, splitter.file_split(k, None)))
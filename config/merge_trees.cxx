@@ -0,0 +1,314 @@
+#include <TClass.h>
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/*
+Native replacement of the hadd calls of hadd_mainsel.py. Merges the input files as a balanced binary tree: on each
+level, pairs of files are merged in parallel (one forked process per merge, at most -j at a time), so the wall time
+grows with log2(number of inputs) instead of linearly.
+
+- TTree baskets are copied without decompression (TFileMerger fast method) if all inputs have the same compression
+  settings. Otherwise, everything is recompressed with the settings of the first input.
+- Histograms and other mergeable objects are added in memory by TFileMerger.
+- The inputs are sorted by number of entries (largest first), so the first input of a merge is never an empty tree
+  unless all are (see the hadd bug mentioned in hadd_mainsel.py). The ordering is kept on all levels.
+- Every finished merge is a checkpoint: it is written to a temporary file and renamed when it is complete and
+  validated. The work directory (<output>.merge) is kept if the merge fails, and rerunning the same command resumes
+  from the finished merges, as long as the inputs (paths, sizes, modification times) are unchanged.
+- Once all merges of a level are validated, the intermediate files they consumed are deleted, so the work directory
+  holds at most two levels at a time. The inputs are never deleted.
+- The number of entries of every top-level TTree is validated after each merge and for the final output against the
+  sum of the inputs.
+
+Build and run:
+  g++ -O2 -o merge_trees merge_trees.cxx $(root-config --cflags --glibs)
+  ./merge_trees -o merged.root -j 4 input1.root input2.root ...
+*/
+
+typedef map<string, Long64_t> TreeEntries; // top-level TTree name -> entries
+
+typedef struct {
+  string path;
+  TreeEntries entries;
+  int compression;
+} Input;
+
+typedef struct {
+  vector<string> parts;
+  string output;
+  TreeEntries expected;
+} Merge;
+
+bool file_exists(const string & path) {
+  struct stat buffer;
+  return stat(path.c_str(), &buffer) == 0;
+}
+
+string file_signature(const string & path) {
+  struct stat buffer;
+  if(stat(path.c_str(), &buffer) != 0) return path+" missing";
+  return path+" "+to_string((long long)buffer.st_size)+" "+to_string((long long)buffer.st_mtime);
+}
+
+bool read_tree_entries(const string & path, TreeEntries & entries, int * compression = nullptr) {
+  unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+  if(!file || file->IsZombie()) return false;
+  if(compression) *compression = file->GetCompressionSettings();
+  entries.clear();
+  for(TObject *obj : *file->GetListOfKeys()) {
+    TKey *key = (TKey*)obj;
+    const TClass *cls = TClass::GetClass(key->GetClassName());
+    if(cls == nullptr || !cls->InheritsFrom(TTree::Class())) continue;
+    if(entries.count(key->GetName())) continue; // only the highest cycle
+    TTree *tree = (TTree*)key->ReadObj();
+    entries[key->GetName()] = tree->GetEntries();
+  }
+  return true;
+}
+
+TreeEntries sum_entries(const vector<const TreeEntries*> & parts) {
+  TreeEntries result;
+  for(const TreeEntries *part : parts) {
+    for(const auto & tree : *part) result[tree.first] += tree.second;
+  }
+  return result;
+}
+
+string describe(const TreeEntries & entries) {
+  stringstream result;
+  for(const auto & tree : entries) result << " " << tree.first << "=" << tree.second;
+  return result.str();
+}
+
+// Merges the inputs into output via a temporary file; returns true if the result has the expected entries
+bool merge(const vector<string> & inputs, const string & output, const int compression, const bool fast, const TreeEntries & expected) {
+  const string tmp_output = output+".tmp";
+  {
+    TFileMerger merger(kFALSE, kFALSE);
+    merger.SetPrintLevel(0);
+    merger.SetFastMethod(fast);
+    if(!merger.OutputFile(tmp_output.c_str(), "RECREATE", compression)) return false;
+    for(const string & input : inputs) {
+      if(!merger.AddFile(input.c_str(), kFALSE)) return false;
+    }
+    if(!merger.Merge()) return false;
+  }
+  TreeEntries entries;
+  if(!read_tree_entries(tmp_output, entries) || entries != expected) {
+    cerr << "Validation failed for " << output << ": expected" << describe(expected) << ", found" << describe(entries) << endl;
+    return false;
+  }
+  return rename(tmp_output.c_str(), output.c_str()) == 0;
+}
+
+int main(int argc, char **argv) {
+
+  const string usage = string("Usage: ")+argv[0]+" -o <output> [-j <parallel merges>] [-f] <inputs>";
+  string output;
+  unsigned int n_jobs = 1;
+  bool force = false;
+  vector<string> input_paths;
+  for(int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if((arg == "-o" || arg == "--output") && i + 1 < argc) output = argv[++i];
+    else if((arg == "-j" || arg == "--jobs") && i + 1 < argc) n_jobs = max(1, stoi(argv[++i]));
+    else if(arg == "-f" || arg == "--force") force = true;
+    else if(arg.front() != '-') input_paths.push_back(arg);
+    else {
+      cerr << usage << endl;
+      return 1;
+    }
+  }
+  if(output.empty() || input_paths.empty()) {
+    cerr << usage << endl;
+    return 1;
+  }
+  if(file_exists(output) && !force) {
+    cerr << output << " already exists (use -f to overwrite)" << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch(kTRUE);
+  vector<Input> inputs;
+  for(const string & path : input_paths) {
+    Input input{path};
+    if(!read_tree_entries(path, input.entries, &input.compression)) {
+      cerr << "Cannot open " << path << endl;
+      return 1;
+    }
+    inputs.push_back(input);
+  }
+  // largest first; ties keep the given order
+  const auto total = [](const Input & input) { Long64_t n(0); for(const auto & tree : input.entries) n += tree.second; return n; };
+  stable_sort(inputs.begin(), inputs.end(), [&total](const Input & a, const Input & b) { return total(a) > total(b); });
+  const int compression = inputs.front().compression;
+  const bool fast = all_of(inputs.begin(), inputs.end(), [compression](const Input & input) { return input.compression == compression; });
+  if(!fast) cout << "Inputs have different compression settings, recompressing everything with " << compression << endl;
+
+  // Checkpoints are only valid for the same inputs
+  const string work_dir = output+".merge";
+  stringstream manifest;
+  manifest << compression << "\n";
+  for(const Input & input : inputs) manifest << file_signature(input.path) << "\n";
+  const string manifest_path = work_dir+"/manifest.txt";
+  bool resume = false;
+  if(file_exists(manifest_path)) {
+    ifstream manifest_file(manifest_path);
+    stringstream previous;
+    previous << manifest_file.rdbuf();
+    resume = previous.str() == manifest.str();
+    if(!resume) {
+      cout << "Inputs changed since the previous attempt, discarding the checkpoints in " << work_dir << endl;
+      if(system(("rm -rf '"+work_dir+"'").c_str()) != 0) return 1;
+    }
+  }
+  if(!resume) {
+    mkdir(work_dir.c_str(), 0755);
+    ofstream manifest_file(manifest_path);
+    manifest_file << manifest.str();
+    if(!manifest_file) {
+      cerr << "Cannot write " << manifest_path << endl;
+      return 1;
+    }
+  }
+
+  // Level 0 are the inputs; node i of level l is the merge of nodes 2i and 2i+1 of level l-1. A node without partner
+  // is passed on to the next level unchanged. The last level has a single node, which becomes the output
+  vector<string> nodes;
+  vector<TreeEntries> node_entries;
+  for(const Input & input : inputs) {
+    nodes.push_back(input.path);
+    node_entries.push_back(input.entries);
+  }
+  vector<const TreeEntries*> all_entries;
+  for(const TreeEntries & e : node_entries) all_entries.push_back(&e);
+  const TreeEntries expected_total = sum_entries(all_entries);
+  vector<vector<Merge>> levels;
+  while(nodes.size() > 1 || levels.empty()) {
+    const unsigned int level = levels.size() + 1;
+    const bool last_level = nodes.size() <= 2;
+    vector<string> next_nodes;
+    vector<TreeEntries> next_entries;
+    levels.emplace_back();
+    for(unsigned int i = 0; i < nodes.size(); i += 2) {
+      if(i + 1 == nodes.size() && !last_level) {
+        next_nodes.push_back(nodes.at(i));
+        next_entries.push_back(node_entries.at(i));
+        continue;
+      }
+      vector<string> parts = { nodes.at(i) };
+      vector<const TreeEntries*> part_entries = { &node_entries.at(i) };
+      if(i + 1 < nodes.size()) {
+        parts.push_back(nodes.at(i + 1));
+        part_entries.push_back(&node_entries.at(i + 1));
+      }
+      const string node = last_level ? work_dir+"/result.root" : work_dir+"/L"+to_string(level)+"_"+to_string(i / 2)+".root";
+      const TreeEntries expected = sum_entries(part_entries);
+      next_nodes.push_back(node);
+      next_entries.push_back(expected);
+      levels.back().push_back({parts, node, expected});
+    }
+    nodes = next_nodes;
+    node_entries = next_entries;
+  }
+
+  // The intermediates of a level are deleted once the next level is done, so a missing intermediate is only merged
+  // again if the node consuming it is missing as well
+  map<string, const Merge*> producers; // output -> merge
+  for(const vector<Merge> & level_merges : levels) {
+    for(const Merge & m : level_merges) producers[m.output] = &m;
+  }
+  set<const Merge*> to_run;
+  vector<string> required = { nodes.front() };
+  while(!required.empty()) {
+    const string node = required.back();
+    required.pop_back();
+    const auto producer = producers.find(node);
+    if(producer == producers.end()) continue; // an input
+    if(file_exists(node)) {
+      cout << "Reusing " << node << endl;
+      continue;
+    }
+    to_run.insert(producer->second);
+    for(const string & part : producer->second->parts) required.push_back(part);
+  }
+
+  for(unsigned int level = 1; level <= levels.size(); ++level) {
+    vector<const Merge*> merges;
+    for(const Merge & m : levels.at(level - 1)) {
+      if(to_run.count(&m)) merges.push_back(&m);
+    }
+    cout << "Level " << level << ": " << merges.size() << " merges" << endl;
+
+    // fork one process per merge, at most n_jobs at a time
+    map<pid_t, string> running;
+    bool failed = false;
+    unsigned int next_merge = 0;
+    while(next_merge < merges.size() || !running.empty()) {
+      while(!failed && next_merge < merges.size() && running.size() < n_jobs) {
+        const Merge & m = *merges.at(next_merge++);
+        const pid_t pid = fork();
+        if(pid < 0) {
+          cerr << "Cannot fork" << endl;
+          failed = true;
+          break;
+        }
+        if(pid == 0) _exit(merge(m.parts, m.output, compression, fast, m.expected) ? 0 : 1);
+        running[pid] = m.output;
+      }
+      if(running.empty()) break;
+      int status;
+      const pid_t pid = wait(&status);
+      if(pid < 0) break;
+      if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << "Merge into " << running.at(pid) << " failed" << endl;
+        failed = true;
+      }
+      running.erase(pid);
+    }
+    if(failed) {
+      cerr << "Merge failed; rerun the same command to resume from the checkpoints in " << work_dir << endl;
+      return 1;
+    }
+
+    // all merges of this level are validated, so the intermediates they consumed are not needed anymore
+    for(const Merge & m : levels.at(level - 1)) {
+      for(const string & part : m.parts) {
+        if(producers.count(part)) remove(part.c_str());
+      }
+    }
+  }
+
+  TreeEntries entries;
+  if(!read_tree_entries(nodes.front(), entries) || entries != expected_total) {
+    cerr << "Validation of the merged file failed: expected" << describe(expected_total) << ", found" << describe(entries) << endl;
+    remove(nodes.front().c_str()); // else it would be reused by the next attempt
+    return 1;
+  }
+  if(rename(nodes.front().c_str(), output.c_str()) != 0) {
+    cerr << "Cannot move " << nodes.front() << " to " << output << endl;
+    return 1;
+  }
+  if(system(("rm -rf '"+work_dir+"'").c_str()) != 0) cerr << "Cannot remove " << work_dir << endl;
+  cout << "Merged " << inputs.size() << " files into " << output << ":" << describe(entries) << endl;
+  return 0;
+}
@@ -5,6 +5,64 @@ import subprocess
 import signal
 import argparse
 import time
+import json
+import errno
+import re
+
+# Jobs are started as soon as enough slots, cores, and memory are free; the scheduler blocks in os.wait4() and thus
+# reacts immediately to finished jobs. The peak memory (max RSS) and duration of each finished job are measured and
+# used as estimate for the remaining jobs of the same dataset. Long jobs (by measured duration, else by size of the
+# input files) are started first so that they do not end up as the tail of the production. Failed jobs are retried
+# with exponential backoff. The measurements and the state of each job are saved in the workdir and reused when
+# run_local.py is called again; which jobs run is only decided by missing_files.txt, so after an interruption update
+# it (sframe_batch.py) to resume with the jobs whose output is still missing.
+
+def job_group(job_name):
+    # sframe_batch.py job files are called <dataset>_<number>.xml
+    return re.sub(r'_[0-9]+$', '', job_name)
+
+def input_size(job_path):
+    size = 0
+    with open(job_path) as f:
+        for file_name in re.findall(r'FileName\s*=\s*"([^"]+)"', f.read()):
+            if os.path.isfile(file_name):
+                size += os.path.getsize(file_name)
+    return size
+
+def total_memory_gb():
+    with open('/proc/meminfo') as f:
+        for line in f:
+            if line.startswith('MemTotal:'):
+                return float(line.split()[1])/1024./1024.
+    return 0.
+
+class JobState:
+
+    def __init__(self, state_path):
+        self.state_path = state_path
+        self.jobs = {}
+        if os.path.isfile(state_path):
+            with open(state_path) as f:
+                self.jobs = json.load(f)
+
+    def get(self, name):
+        return self.jobs.setdefault(name, {'status': 'pending', 'attempts': 0})
+
+    def save(self):
+        tmp_path = self.state_path+'.tmp'
+        with open(tmp_path, 'w') as f:
+            json.dump(self.jobs, f, indent=1, sort_keys=True)
+        os.rename(tmp_path, self.state_path)
+
+    def measured(self, name, key):
+        # measurement of the job itself, else maximum of the finished jobs of the same group
+        if key in self.jobs.get(name, {}):
+            return self.jobs[name][key]
+        values = [j[key] for n, j in self.jobs.items() if key in j and job_group(n) == job_group(name)]
+        return max(values) if values else None
+
+def on_alarm(signum, frame):
+    pass # only interrupts os.wait4() when a retried job becomes ready
 
 if __name__=="__main__":
     # parse input
@@ -12,6 +70,13 @@ if __name__=="__main__":
     parser.add_argument('workdir', help='sframe_batch.py work directory')
     parser.add_argument('--nice', '-n', default=0, type=int)
     parser.add_argument('--max_jobs', '-m', default=10, type=int)
+    parser.add_argument('--max_cores', '-c', default=None, type=int, help='Maximum number of cores used by all running jobs (default: number of CPUs)')
+    parser.add_argument('--max_memory', default=None, type=float, help='Maximum memory in GB used by all running jobs (default: 80%% of the total memory)')
+    parser.add_argument('--job_cores', default=1, type=int, help='Cores used by each job')
+    parser.add_argument('--job_memory', default=2., type=float, help='Memory estimate in GB for jobs of datasets without finished jobs yet')
+    parser.add_argument('--retries', '-r', default=2, type=int, help='Number of retries of failed jobs')
+    parser.add_argument('--backoff', default=30., type=float, help='Delay in seconds before the first retry; doubled for each further retry, up to 10 minutes')
+    parser.add_argument('--restart', action='store_true', help='Discard the saved job durations and memory measurements')
     args = parser.parse_args()
 
     if args.nice < -20 or args.nice > 19:
@@ -20,59 +85,113 @@ if __name__=="__main__":
     if args.max_jobs <= 0:
         raise ValueError('Number of jobs has to be positive. Exit')
 
+    max_cores = max(args.max_cores or os.sysconf('SC_NPROCESSORS_ONLN'), args.job_cores)
+    max_memory = args.max_memory or 0.8*total_memory_gb()
+
     print 'Start looking for missing files in {}...'.format(args.workdir)
     with open(args.workdir+'/missing_files.txt') as f:
-        jobs  = f.read().splitlines()
-        n_jobs = len(jobs)
-    print 'Found {:d} missing files. Start running local spawning {:d} parallel jobs with nicecess of {:d}'.format(n_jobs, args.max_jobs, args.nice)
+        jobs = [line.split()[-1] for line in f.read().splitlines() if line.strip() != '']
 
-    n_running = 0
-    n_completed = 0
-    processes = []
+    state_path = os.path.join(args.workdir, 'run_local_state.json')
+    if args.restart and os.path.isfile(state_path):
+        os.remove(state_path)
+    state = JobState(state_path)
+    queue = [] # names of jobs to run, without .xml
     for job in jobs:
-        if job == '': continue
-        job = job.split()
-        arg = args.workdir + '/' + job[-1]
-        log_name = arg[:arg.rfind('.')]+'_log.txt'
-
-        b_wait = (n_running >= args.max_jobs)
-        while b_wait:
-            n_running = 0
-            n_completed = 0
-            for proc in processes:
-                if proc[0].poll() == None: n_running += 1
-                else:
-                    n_completed += 1
-                    if not proc[1].closed:
-                        proc[1].close()
-                        print 'Job "{}" has finished.'.format(proc[1].name)
-            percent = round(float(n_completed)/float(n_jobs)*100, 1)
-            sys.stdout.write( '{0:d} of {1:d} ({2:4.2f}%) jobs done.\r'.format(n_completed, n_jobs, percent))
-            sys.stdout.flush()
-            time.sleep(10)
-            b_wait = (n_running >= args.max_jobs)
-
-        print 'Spawning job: {}'.format(arg[:arg.rfind('.')])
-        n_running += 1
-        f = open(log_name,'w')
-        command = ['nice', '-n', str(args.nice), 'sframe_main', arg]
-        processes.append((subprocess.Popen(command, stdout=f),f))
-
-    b_wait = (n_completed < n_jobs)
-    while b_wait:
-        n_running = 0
-        n_completed = 0
-        for proc in processes:
-            if proc[0].poll() == None: n_running += 1
-            else:
+        # listed jobs are missing their output, even if they were done before (e.g. the output was deleted since)
+        name = job[:job.rfind('.')]
+        state.get(name)['status'] = 'pending'
+        state.get(name)['ready_at'] = 0.
+        state.get(name)['attempts'] = 0
+        queue.append(name)
+    n_jobs = len(jobs)
+    n_completed = 0
+    state.save()
+    print 'Found {:d} missing files. Start running local spawning up to {:d} parallel jobs ({:d} cores, {:.1f} GB) with niceness of {:d}'.format(n_jobs, args.max_jobs, max_cores, max_memory, args.nice)
+
+    # longest first: measured duration if available, else size of the input files
+    sizes = dict((name, input_size(os.path.join(args.workdir, name+'.xml'))) for name in queue)
+    queue.sort(key=lambda name: (state.measured(name, 'duration') or 0., sizes[name]), reverse=True)
+
+    def memory_estimate(name):
+        measured = state.measured(name, 'memory')
+        return measured*1.2 if measured else args.job_memory
+
+    signal.signal(signal.SIGALRM, on_alarm)
+    running = {} # pid -> (name, log file, start time, memory estimate, process)
+    n_failed = 0
+    try:
+        while queue or running:
+            # start everything that fits, in order of priority; smaller jobs may overtake a job that does not fit
+            now = time.time()
+            used_memory = sum(r[3] for r in running.values())
+            for name in list(queue):
+                if len(running) >= args.max_jobs or (len(running)+1)*args.job_cores > max_cores: break
+                if state.get(name)['ready_at'] > now: continue
+                memory = memory_estimate(name)
+                if running and used_memory+memory > max_memory: continue
+                arg = os.path.join(args.workdir, name+'.xml')
+                print 'Spawning job: {}'.format(os.path.join(args.workdir, name))
+                f = open(os.path.join(args.workdir, name+'_log.txt'), 'w')
+                command = ['nice', '-n', str(args.nice), 'sframe_main', arg]
+                process = subprocess.Popen(command, stdout=f)
+                # a Popen that gets garbage collected is reaped by subprocess on the next Popen, before os.wait4() sees it
+                running[process.pid] = (name, f, now, memory, process)
+                used_memory += memory
+                queue.remove(name)
+                state.get(name)['status'] = 'running'
+            state.save()
+
+            if not running:
+                # only jobs waiting for their retry are left
+                time.sleep(max(0., min(state.get(name)['ready_at'] for name in queue)-time.time()))
+                continue
+
+            delays = [state.get(name)['ready_at']-now for name in queue if state.get(name)['ready_at'] > now]
+            if delays:
+                signal.setitimer(signal.ITIMER_REAL, max(0.1, min(delays)))
+            try:
+                pid, status, rusage = os.wait4(-1, 0)
+            except OSError as e:
+                if e.errno == errno.EINTR: continue
+                raise
+            finally:
+                signal.setitimer(signal.ITIMER_REAL, 0)
+            if pid not in running: continue
+            name, f, start, memory, process = running.pop(pid)
+            process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+            f.close()
+            job = state.get(name)
+            job['attempts'] += 1
+            job['duration'] = time.time()-start
+            job['memory'] = rusage.ru_maxrss/1024./1024. # ru_maxrss is in kB
+            if process.returncode == 0:
+                job['status'] = 'done'
                 n_completed += 1
-                if not proc[1].closed:
-                    proc[1].close()
-                    print 'Job "%s" has finished.' % proc[1].name
-        percent = float(n_completed)/float(n_jobs)*100
-        sys.stdout.write( '{0:d} of {1:d} ({2:4.2f} %) jobs done.\r'.format(n_completed, n_jobs, percent))
-        sys.stdout.flush()
-        time.sleep(10)
-        b_wait = (n_completed < n_jobs)
+                print 'Job "{}" has finished ({:.0f} s, {:.2f} GB).'.format(f.name, job['duration'], job['memory'])
+            elif job['attempts'] <= args.retries:
+                delay = min(args.backoff*2**(job['attempts']-1), 600.)
+                job['status'] = 'pending'
+                job['ready_at'] = time.time()+delay
+                queue.append(name)
+                print 'Job "{}" failed, retrying in {:.0f} s (attempt {:d} of {:d}).'.format(f.name, delay, job['attempts']+1, args.retries+1)
+            else:
+                job['status'] = 'failed'
+                n_failed += 1
+                print 'Job "{}" failed {:d} times, giving up.'.format(f.name, job['attempts'])
+            state.save()
+            percent = float(n_completed)/float(n_jobs)*100
+            sys.stdout.write( '{0:d} of {1:d} ({2:4.2f} %) jobs done.\r'.format(n_completed, n_jobs, percent))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        for name, f, start, memory, process in running.values():
+            state.get(name)['status'] = 'pending'
+        state.save()
+        print ''
+        print 'Interrupted. Update missing_files.txt (sframe_batch.py) and run the same command again to resume.'
+        sys.exit(1)
     print ''
-    print 'Done'
+    if n_failed:
+        print 'Done, {:d} jobs failed (see their logs; update missing_files.txt and run the same command again to retry them)'.format(n_failed)
+    else:
+        print 'Done'
@@ -0,0 +1,203 @@
+#!/usr/bin/env python
+
+'''
+Local cache of per-file sample metadata (number of entries, sum of generator weights, and cluster size of the
+AnalysisTree), so that tools and job splitting can query them without opening the data files again.
+
+The cache is an SQLite file with one row per file, indexed by sample name. A file is identified by its path, size, and
+modification time; refresh() only opens files which are new or changed since the last refresh and drops files which
+are no longer part of the sample. Only refresh() needs ROOT, all queries work without it. The module is used from
+Python 2 (hadd_mainsel.py) and Python 3 (xmlCreator.py).
+
+Samples are named <nick name>_<year>, like the Version of the SFrame InputData.
+
+Fill the cache for all samples of database.csv, or for the files of one sample, and print its content with:
+  ./sampleMetadata.py refresh [-y UL17 UL18]
+  ./sampleMetadata.py add <sample> <files>
+  ./sampleMetadata.py show [<sample>]
+'''
+
+from __future__ import print_function
+
+import os
+import sys
+import re
+import csv
+import sqlite3
+import argparse
+
+_CACHE_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'sample_metadata.sqlite')
+
+_TREE_NAME = 'AnalysisTree'
+_GEN_WEIGHT = 'genInfo.m_weights[0]' # nominal generator weight in UHH2 ntuples
+
+
+def file_signature(path):
+
+   '''Size and modification time, or None if the file is not accessible'''
+
+   try:
+      st = os.stat(path)
+   except OSError:
+      return None
+   return (st.st_size, int(st.st_mtime))
+
+
+def scan_file(path, is_data):
+
+   '''Reads the metadata of one file; returns (n_entries, sum_weights, cluster_size) or None if it cannot be opened'''
+
+   import ROOT as root
+   root.gErrorIgnoreLevel = root.kError
+   rootFile = root.TFile.Open(path, 'READ')
+   if not rootFile or rootFile.IsZombie():
+      return None
+   tree = rootFile.Get(_TREE_NAME)
+   if not tree:
+      rootFile.Close()
+      return (0, 0., None)
+   n_entries = int(tree.GetEntries())
+   sum_weights = float(n_entries)
+   if not is_data and n_entries > 0:
+      hist = root.TH1D('sampleMetadata_sumw', '', 1, 0., 2.)
+      hist.SetDirectory(rootFile)
+      sum_weights = float(hist.GetSumOfWeights()) if tree.Project(hist.GetName(), '1', _GEN_WEIGHT) >= 0 else None
+   cluster_size = None
+   if n_entries > 0:
+      clusters = tree.GetClusterIterator(0)
+      clusters.Next()
+      cluster_size = int(clusters.GetNextEntry())
+   rootFile.Close()
+   return (n_entries, sum_weights, cluster_size)
+
+
+class sampleMetadata:
+
+   '''Per-file metadata of samples, cached in an SQLite file'''
+
+   def __init__(self, cacheFile=_CACHE_FILE):
+
+      self.cacheFile = cacheFile
+      self.connection = sqlite3.connect(cacheFile)
+      self.connection.execute('''CREATE TABLE IF NOT EXISTS files (
+         path TEXT PRIMARY KEY,
+         sample TEXT NOT NULL,
+         size INTEGER NOT NULL,
+         mtime INTEGER NOT NULL,
+         n_entries INTEGER,
+         sum_weights REAL,
+         cluster_size INTEGER
+      )''')
+      self.connection.execute('CREATE INDEX IF NOT EXISTS files_sample ON files (sample)')
+      self.connection.commit()
+
+   def refresh(self, sample, paths, is_data=False):
+
+      '''Makes the cached files of the sample equal to paths, opening only new or changed files'''
+
+      cached = dict((row[0], (row[1], row[2])) for row in self.connection.execute('SELECT path, size, mtime FROM files WHERE sample=?', (sample,)))
+      paths = set(paths)
+      n_scanned = 0
+      for path in sorted(paths):
+         signature = file_signature(path)
+         if signature is None:
+            print('Cannot access '+path)
+            continue
+         if cached.get(path) == signature:
+            continue
+         result = scan_file(path, is_data)
+         if result is None:
+            print('Cannot open '+path)
+            continue
+         self.connection.execute('INSERT OR REPLACE INTO files VALUES (?, ?, ?, ?, ?, ?, ?)', (path, sample, signature[0], signature[1])+result)
+         n_scanned += 1
+         if n_scanned % 100 == 0:
+            self.connection.commit()
+      for path in set(cached.keys()) - paths:
+         self.connection.execute('DELETE FROM files WHERE path=?', (path,))
+      self.connection.commit()
+      return n_scanned
+
+   def refresh_xml(self, sample, xmlPath, is_data=False):
+
+      '''Same as refresh() for the files listed in an SFrame dataset XML file'''
+
+      with open(xmlPath, 'r') as file:
+         paths = re.findall(r'<In\s+FileName\s*=\s*"([^"]+)"', file.read())
+      return self.refresh(sample, paths, is_data)
+
+   def samples(self):
+
+      return [row[0] for row in self.connection.execute('SELECT DISTINCT sample FROM files ORDER BY sample')]
+
+   def files(self, sample):
+
+      '''List of (path, n_entries, sum_weights, cluster_size) of the files of the sample'''
+
+      return list(self.connection.execute('SELECT path, n_entries, sum_weights, cluster_size FROM files WHERE sample=? ORDER BY path', (sample,)))
+
+   def summary(self, sample):
+
+      '''Number of files, entries, and sum of weights of the sample; None if the sample is not in the cache'''
+
+      n_files, n_entries, sum_weights = self.connection.execute('SELECT COUNT(*), SUM(n_entries), SUM(sum_weights) FROM files WHERE sample=?', (sample,)).fetchone()
+      if not n_files:
+         return None
+      return {'n_files': n_files, 'n_entries': n_entries, 'sum_weights': sum_weights}
+
+   def entries_per_file(self, sample):
+
+      summary = self.summary(sample)
+      return float(summary['n_entries'])/summary['n_files'] if summary else None
+
+   def entries(self, sample, paths):
+
+      '''Number of entries of each of the given files, refreshing the sample with exactly these files first'''
+
+      self.refresh(sample, paths)
+      cached = dict((row[0], row[1]) for row in self.files(sample))
+      return [cached.get(path, 0) for path in paths]
+
+
+if __name__=='__main__':
+
+   parser = argparse.ArgumentParser(description='Cache of per-file sample metadata.')
+   subparsers = parser.add_subparsers(dest='mode')
+   parser_refresh = subparsers.add_parser('refresh', help='Refresh all samples of database.csv (files are taken from the dataset XML files).')
+   parser_refresh.add_argument('-y', '--years', nargs='*', default=[])
+   parser_add = subparsers.add_parser('add', help='Refresh one sample with the given files.')
+   parser_add.add_argument('sample')
+   parser_add.add_argument('files', nargs='+')
+   parser_add.add_argument('-d', '--data', action='store_true', help='Data sample (sum of weights = entries).')
+   parser_show = subparsers.add_parser('show', help='Print the cached samples or the files of one sample.')
+   parser_show.add_argument('sample', nargs='?')
+   args = parser.parse_args(sys.argv[1:])
+
+   metadata = sampleMetadata()
+
+   if args.mode == 'refresh':
+      config_dir = os.path.dirname(os.path.abspath(__file__))
+      with open(os.path.join(config_dir, 'database.csv'), 'r') as file:
+         for row in csv.DictReader(file):
+            if args.years and row['year'] not in args.years: continue
+            sample = row['nick_name']+'_'+row['year']
+            xmlPath = os.path.join(config_dir, 'datasets', row['xml_path'])
+            if not os.path.isfile(xmlPath):
+               print('XML for sample  '+sample+'  does not exist. Skipping this sample')
+               continue
+            n_scanned = metadata.refresh_xml(sample, xmlPath, row['is_data']=='True')
+            print('{:<60}{:>6} files scanned'.format(sample, n_scanned))
+
+   elif args.mode == 'add':
+      n_scanned = metadata.refresh(args.sample, [os.path.abspath(x) for x in args.files], args.data)
+      print('{:<60}{:>6} files scanned'.format(args.sample, n_scanned))
+
+   elif args.mode == 'show':
+      if args.sample:
+         for path, n_entries, sum_weights, cluster_size in metadata.files(args.sample):
+            print('{:>12}{:>18}{:>10}  {}'.format(str(n_entries), str(sum_weights), str(cluster_size), path))
+      else:
+         print('{:<60}{:>8}{:>14}{:>18}'.format('sample', 'files', 'entries', 'sum of weights'))
+         for sample in metadata.samples():
+            s = metadata.summary(sample)
+            print('{:<60}{:>8}{:>14}{:>18}'.format(sample, s['n_files'], str(s['n_entries']), str(s['sum_weights'])))
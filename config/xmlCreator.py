@@ -19,6 +19,8 @@ from constants import _YEARS, _JECSMEAR_SOURCES, JECSmearSource
 
 # sys.path.append(os.path.join(os.environ.get('CMSSW_BASE'), 'src/UHH2/LegacyTopTagging/config'))
 from database import samplesDict
+from jobSplitter import jobSplitter
+import sampleMetadata
 
 
 class configContainer:
@@ -30,6 +32,7 @@ class configContainer:
    userMail = str()
    yearVars = dict()
    used_samples = OrderedDict()
+   targetJobWallTime = 2*3600 # seconds; used to choose the job splitting of samples with measured throughput, see jobSplitter.py
 
 
    def __init__(self):
@@ -318,6 +321,26 @@ class xmlCreator:
       self.xmlFilePath = self.xmlFilePathBase+self.xmlFileName
       self.workdirName = '_'.join(['workdir', self.selection, self.year])+('_'+self.channel if self.channel else '')+('_syst_'+self.extra_syst if self.extra_syst else '')
 
+      # Samples with measured throughput get the split size for the target job wall time (see jobSplitter.py). Each
+      # split size needs its own XML file and workdir, since SFrameBatch applies NEventsBreak/FileSplit to all samples
+      # of an XML file. Samples without measurement keep the default split, and with it the usual file names
+      default_split = 1500000 if self.is_mainsel else int(self.yearVars['preselFileSplit'][self.year])
+      splitter = jobSplitter(self.selection, confCon.targetJobWallTime)
+      metadata = sampleMetadata.sampleMetadata() if os.path.isfile(sampleMetadata._CACHE_FILE) else None
+      split_samples = OrderedDict({default_split: list()})
+      for s in self.sample_list:
+         if self.is_mainsel and self.channel not in s.channel: continue
+         if self.is_mainsel:
+            split = splitter.n_events_break(s.nickName, default_split)
+         else:
+            split = splitter.file_split(s.nickName, default_split, metadata.entries_per_file(s.nickName+'_'+self.year) if metadata else None)
+         split_samples.setdefault(split, list()).append(s)
+      self.splitXmls = list() # tuples of XML file path, workdir name, samples, split size
+      for split, samples in split_samples.items():
+         if not samples: continue
+         suffix = '' if split == default_split else '_split'+str(split)
+         self.splitXmls.append((self.xmlFilePath.replace('.xml', suffix+'.xml'), self.workdirName+suffix, samples, split))
+
       self.write_xml_successful = False
       self.systXmlFilePaths = list()
       self.systWorkdirNames = list()
@@ -325,7 +348,17 @@ class xmlCreator:
 
    def write_xml(self):
 
-      with open(self.xmlFilePath, 'w') as file:
+      for xmlFilePath, workdirName, samples, split in self.splitXmls:
+         self.write_split_xml(xmlFilePath, workdirName, samples, split)
+
+      self.write_xml_successful = True
+
+      return [x[0] for x in self.splitXmls]
+
+
+   def write_split_xml(self, xmlFilePath: str, workdirName: str, samples: list, split: int):
+
+      with open(xmlFilePath, 'w') as file:
          file.write('''<?xml version="1.0" encoding="UTF-8"?>\n''')
          file.write('''\n''')
          file.write('''<!DOCTYPE JobConfiguration PUBLIC "" "JobConfig.dtd"[\n''')
@@ -340,7 +373,7 @@ class xmlCreator:
          file.write('''<!ENTITY YEARsuffix "_'''+self.year+self.yearVersion+'''">\n''')
          file.write('''<!ENTITY PROOFdir "/nfs/dust/cms/user/'''+self.userName+'''/.proof2">\n''')
          file.write('''\n''')
-         for s in self.sample_list:
+         for s in samples:
             if self.is_mainsel:
                if self.channel in s.channel:
                   file.write('''<!ENTITY '''+s.nickName+''' "&PRESELdir;/&PRESELfilename;'''+('.DATA.' if s.is_data else '.MC.')+s.nickName+'''&YEARsuffix;.root">\n''')
@@ -350,8 +383,8 @@ class xmlCreator:
          file.write(''']>\n''')
          file.write('''\n''')
          file.write('''<!--\n''')
-         file.write('''<ConfigParse NEventsBreak="'''+('1500000' if self.is_mainsel else '0')+'''" FileSplit="'''+('0' if self.is_mainsel else self.yearVars['preselFileSplit'][self.year])+'''" AutoResubmit="5"/>\n''')
-         file.write('''<ConfigSGE RAM="4" DISK="3" Mail="'''+self.userMail+'''" Notification="as" Workdir="'''+self.workdirName+'''"/>\n''')
+         file.write('''<ConfigParse NEventsBreak="'''+(str(split) if self.is_mainsel else '0')+'''" FileSplit="'''+('0' if self.is_mainsel else str(split))+'''" AutoResubmit="5"/>\n''')
+         file.write('''<ConfigSGE RAM="4" DISK="3" Mail="'''+self.userMail+'''" Notification="as" Workdir="'''+workdirName+'''"/>\n''')
          file.write('''-->\n''')
          file.write('''\n''')
          file.write('''<!-- OutputLevel controls which messages are printed; set to VERBOSE or DEBUG for more verbosity, to WARNING or ERROR for less -->\n''')
@@ -360,7 +393,7 @@ class xmlCreator:
          file.write('''<Package Name="SUHH2LegacyTopTagging.par"/>\n''')
          file.write('''<Cycle Name="uhh2::AnalysisModuleRunner" OutputDirectory="&OUTPUTdir;/" PostFix="" TargetLumi="&TargetLumi;">\n''')
          file.write('''\n''')
-         for s in self.sample_list:
+         for s in samples:
             if self.is_mainsel:
                if self.channel in s.channel:
                   for v in s.mainsel_versions:
@@ -427,6 +460,13 @@ class xmlCreator:
               file.write('''<Item Name="analysis_channel" Value="'''+self.channel+'''"/>\n''')
          # file.write('''<Item Name="uhh2Dir" Value="'''+self.uhh2Dir+'''"/>\n''')
          file.write('''\n''')
+         if not self.is_mainsel:
+            file.write('''<!-- Reorder independent selection steps by measured cost and rejection rate (same selected events and weights, but no intermediate cutflow histograms) -->\n''')
+            file.write('''<Item Name="presel_adaptive_ordering" Value="false"/>\n''')
+            file.write('''<!-- Only write the collections and jet members read by the main selection; set output_genparticles_datasets (e.g. "TTbar ST") to write genparticles only for these MC datasets -->\n''')
+            file.write('''<Item Name="presel_output_slimming" Value="true"/>\n''')
+            file.write('''<Item Name="output_genparticles_datasets" Value=""/>\n''')
+            file.write('''\n''')
          file.write('''<!-- Switch for debugging of the central AnalysisModule -->\n''')
          file.write('''<Item Name="debug" Value="false"/>\n''')
          file.write('''\n''')
@@ -435,11 +475,7 @@ class xmlCreator:
          file.write('''</Cycle>\n''')
          file.write('''</JobConfiguration>\n''')
 
-      self.write_xml_successful = True
-
-      print('Created '+self.xmlFilePath)
-
-      return self.xmlFilePath
+      print('Created '+xmlFilePath)
 
 
    def write_systematics_xml(self, syst: systEntity):
@@ -450,12 +486,19 @@ class xmlCreator:
       if not self.write_xml_successful:
          sys.exit('xmlCreator::write_xml() not called. Danger of parsing potentially outdated XML file. Exit.')
 
+      for xmlFilePath, workdirName, samples, split in self.splitXmls:
+         if all(s.is_data for s in samples): continue # data is skipped for systematics
+         self.write_split_systematics_xml(syst, xmlFilePath, workdirName)
+
+
+   def write_split_systematics_xml(self, syst: systEntity, xmlFilePath: str, workdirName: str):
+
       for direction in syst.directions:
          for jecsmear_source in syst.jecsmear_sources:
             shortNameModified = syst.shortName if syst.shortName != 'jes' else syst.shortName+jecsmear_source.name
-            systXmlFilePath = self.xmlFilePath.replace('.xml', '_')+'_'.join(['syst', shortNameModified, direction])+'.xml'
-            systWorkdirName = self.workdirName+'_'+'_'.join(['syst', shortNameModified, direction])
-            infile = open(self.xmlFilePath, 'r')
+            systXmlFilePath = xmlFilePath.replace('.xml', '_')+'_'.join(['syst', shortNameModified, direction])+'.xml'
+            systWorkdirName = workdirName+'_'+'_'.join(['syst', shortNameModified, direction])
+            infile = open(xmlFilePath, 'r')
             with open(systXmlFilePath, 'w') as outfile:
                for line in infile:
                   newline = line
@@ -465,8 +508,8 @@ class xmlCreator:
                      newline = newline.replace('/nominal', '/'+'_'.join(['syst', shortNameModified, direction]))
                   # if newline.startswith('<ConfigSGE'):
                   #    newline = newline.replace('"/>', '_'+'_'.join(['syst', syst.shortName, direction])+'"/>')
-                  if self.workdirName in newline:
-                     newline = newline.replace(self.workdirName, systWorkdirName)
+                  if workdirName in newline:
+                     newline = newline.replace(workdirName, systWorkdirName)
                   if newline.startswith('<!ENTITY DATA_'):
                      continue
                   if newline.startswith('<InputData') and 'Type="DATA"' in newline:
@@ -502,7 +545,8 @@ class xmlCreator:
       with open(scriptFilePath_sframe_batch, 'w') as outfile:
          outfile.write('#!/bin/bash\n')
          newline_base = 'sframe_batch.py $1 '
-         outfile.write(newline_base+self.xmlFilePath+'\n')
+         for xmlFilePath, workdirName, samples, split in self.splitXmls:
+            outfile.write(newline_base+xmlFilePath+'\n')
          for systXmlFilePath in self.systXmlFilePaths:
             outfile.write(newline_base+systXmlFilePath+'\n')
       p = subprocess.Popen('chmod +x '+scriptFilePath_sframe_batch, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
@@ -513,7 +557,8 @@ class xmlCreator:
       with open(scriptFilePath_run_local, 'w') as outfile:
          outfile.write('#!/bin/bash\n')
          newline_base = 'python run_local.py $1 '
-         outfile.write(newline_base+self.workdirName+'\n')
+         for xmlFilePath, workdirName, samples, split in self.splitXmls:
+            outfile.write(newline_base+workdirName+'\n')
          for systWorkdirName in self.systWorkdirNames:
             outfile.write(newline_base+systWorkdirName+'\n')
       p = subprocess.Popen('chmod +x '+scriptFilePath_run_local, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
@@ -540,8 +585,11 @@ if __name__=='__main__':
    parser.add_argument('-y', '--years', choices=years, nargs='*', default=[])
    parser.add_argument('-c', '--channels', choices=channels, nargs='*', default=['muo, ele'])
    parser.add_argument('-a', '--auto-complete', action='store_true', help='Auto-complete arguments if not all arguments for selections and years are given.')
+   parser.add_argument('-t', '--job-time', type=float, default=2., help='Target job wall time in hours for samples with throughput measured by jobSplitter.py.')
    args = parser.parse_args(sys.argv[1:])
 
+   configContainer.targetJobWallTime = args.job_time*3600.
+
    if(args.all == True):
       if(len(args.selections) + len(args.years) != 0):
          sys.exit('Not allowed to use "--all" option jointly with manually given selection or year argument. Exit.')
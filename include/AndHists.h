@@ -3,21 +3,54 @@
 #include "UHH2/core/include/Hists.h"
 #include "UHH2/core/include/Event.h"
 
+#include "UHH2/LegacyTopTagging/include/StagedHists.h"
+
+#include <functional>
+#include <memory>
+
 
 namespace uhh2 { namespace ltt {
 
+//____________________________________________________________________________________________________
+// One selection stage worth of hist groups (Lumi, Common, AK8, HOTVR, AK4), all booked in the constructor.
+// Quantities needed by several groups (weight, primary lepton, pt-sorted AK8/HOTVR jets) are computed once per
+// fill and handed to all StagedHists of the stage.
+//
+// The config allows to restrict which stages and groups are filled at all (comma-separated, an entry
+// ending with '*' acts as prefix wildcard; empty means "everything"):
+//   <Item Name="AndHists_stages" Value="0_NoCuts,Presel_*"/>
+//   <Item Name="AndHists_groups" Value="Common,AK8"/>
 class AndHists: public uhh2::Hists {
 public:
   AndHists(uhh2::Context & ctx, const std::string & dirname, const bool b_topjethists = false, const bool b_ak4hists = false);
   virtual void fill(const uhh2::Event & event) override;
   void add_hist(uhh2::Hists *hist);
+  void add_hist(const std::string & group, const std::function<uhh2::Hists*()> & factory);
   std::string dirname() const { return m_dirname; };
+  bool enabled() const { return m_enabled; };
 
 private:
+  struct HistGroup {
+    std::string name;
+    std::unique_ptr<uhh2::Hists> hists;
+    bool use_quantities = false; // only the built-in groups read from StageQuantities
+    StagedHists *staged = nullptr;
+  };
+
+  void add_group(const std::string & group, const std::function<uhh2::Hists*()> & factory, const bool staged);
+
   const std::string m_dirname;
+  const bool m_enabled;
+  const std::vector<std::string> m_allowed_groups;
+  std::vector<HistGroup> m_groups;
 
-protected:
-  std::vector<uhh2::Hists*> hists_vector;
+  const uhh2::Event::Handle<FlavorParticle> fHandle_PrimaryLepton;
+  uhh2::Event::Handle<std::vector<TopJet>> fHandle_AK8jets;
+  uhh2::Event::Handle<std::vector<TopJet>> fHandle_HOTVRjets;
+  bool m_need_ak8jets = false;
+  bool m_need_hotvrjets = false;
+  std::vector<TopJet> m_ak8jets;
+  std::vector<TopJet> m_hotvrjets;
 };
 
 }}
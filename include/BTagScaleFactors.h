@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+
+#include "UHH2/core/include/AnalysisModule.h"
+#include "UHH2/core/include/Event.h"
+
+#include "UHH2/common/include/JetIds.h"
+#include "UHH2/common/include/BTagCalibrationStandalone.h"
+
+#include "UHH2/LegacyTopTagging/include/Constants.h"
+#include "UHH2/LegacyTopTagging/include/WeightLedgerSchema.h"
+
+
+namespace uhh2 { namespace ltt {
+
+const std::string kBasePathToULBTagSFs = "LegacyTopTagging/data/ScaleFactors/btagging_SFs_UL_September2022/";
+
+//____________________________________________________________________________________________________
+// Variations of the fixed-WP b-tagging scale factors, in the order in which they are stored in the weight vector
+// written by BTagFixedWPScaleFactors. "sysType" is the name used in the BTV csv files
+struct BTagSFVariationInfo {
+  std::string name;
+  std::string sysType;
+  bool affects_bc;
+  bool affects_light;
+};
+
+const std::vector<BTagSFVariationInfo> kBTagSFVariations = {
+  BTagSFVariationInfo{"central", "central", false, false},
+  BTagSFVariationInfo{"bc_up", "up", true, false},
+  BTagSFVariationInfo{"bc_down", "down", true, false},
+  BTagSFVariationInfo{"bc_up_correlated", "up_correlated", true, false},
+  BTagSFVariationInfo{"bc_down_correlated", "down_correlated", true, false},
+  BTagSFVariationInfo{"bc_up_uncorrelated", "up_uncorrelated", true, false},
+  BTagSFVariationInfo{"bc_down_uncorrelated", "down_uncorrelated", true, false},
+  BTagSFVariationInfo{"bc_up_jes", "up_jes", true, false},
+  BTagSFVariationInfo{"bc_down_jes", "down_jes", true, false},
+  BTagSFVariationInfo{"bc_up_pileup", "up_pileup", true, false},
+  BTagSFVariationInfo{"bc_down_pileup", "down_pileup", true, false},
+  BTagSFVariationInfo{"bc_up_statistic", "up_statistic", true, false},
+  BTagSFVariationInfo{"bc_down_statistic", "down_statistic", true, false},
+  BTagSFVariationInfo{"bc_up_type3", "up_type3", true, false},
+  BTagSFVariationInfo{"bc_down_type3", "down_type3", true, false},
+  BTagSFVariationInfo{"light_up", "up", false, true},
+  BTagSFVariationInfo{"light_down", "down", false, true},
+  BTagSFVariationInfo{"light_up_correlated", "up_correlated", false, true},
+  BTagSFVariationInfo{"light_down_correlated", "down_correlated", false, true},
+  BTagSFVariationInfo{"light_up_uncorrelated", "up_uncorrelated", false, true},
+  BTagSFVariationInfo{"light_down_uncorrelated", "down_uncorrelated", false, true},
+};
+
+//____________________________________________________________________________________________________
+// MC b-tagging efficiencies as produced by BTagMCEfficiencyHists (and merged by Analysis/BTagMCEff/create_histos.py),
+// converted once into dense (flavor, pt, eta) arrays
+class BTagMCEfficiencyMap {
+public:
+  enum Flavor { b, c, udsg };
+  BTagMCEfficiencyMap(const std::string & file_path);
+  double efficiency(const Flavor flavor, const double pt, const double eta) const;
+  static Flavor flavor(const Jet & jet);
+private:
+  struct FlavorMap {
+    std::vector<double> pt_edges;
+    std::vector<double> eta_edges;
+    bool abs_eta;
+    std::vector<float> efficiencies; // index = i_pt * n_eta + i_eta
+  };
+  std::array<FlavorMap, 3> fMaps; // the binning may differ between flavors
+};
+
+//____________________________________________________________________________________________________
+// Fixed-WP b-tagging event weights (BTV method 1a) with all variations of kBTagSFVariations computed in a single loop
+// over the jets. Per jet, the efficiency is looked up once and only the variations affecting the jet's flavor are
+// evaluated; all others share the central factor.
+//
+// The central weight (or the variation chosen via "SystDirection_BTaggingFixedWP") is applied to event.weight;
+// all weights are written to the vector branch "weight_btag_fixedwp"+weight_postfix in the order of kBTagSFVariations
+// and, as MCBTagScaleFactor did, to one float branch "weight_btag_<variation>"+weight_postfix each.
+class BTagFixedWPScaleFactors: public uhh2::AnalysisModule {
+public:
+  BTagFixedWPScaleFactors(uhh2::Context & ctx, const BTag::algo & algo, const BTag::wp & wp, const std::string & handle_name_jets, const std::string & measType_bc, const std::string & measType_udsg, const std::string & xml_key_of_eff_file, const std::string & weight_postfix = "");
+  virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
+private:
+  const bool fIsMC;
+  const JetId fBTagID;
+  const uhh2::Event::Handle<std::vector<Jet>> fHandle_jets;
+  const uhh2::Event::Handle<std::vector<float>> fHandle_weights;
+  std::vector<uhh2::Event::Handle<float>> fHandles_weight; // one per variation
+  unsigned int fAppliedVariation = 0;
+  std::unique_ptr<BTagMCEfficiencyMap> fEfficiencies;
+  std::unique_ptr<BTagCalibrationReader> fReader;
+  std::vector<unsigned int> fVariations_bc; // indices into kBTagSFVariations
+  std::vector<unsigned int> fVariations_light;
+  std::vector<double> fWeights;
+  WeightLedgerSlot fLedgerSlot;
+};
+
+}}
@@ -3,14 +3,17 @@
 #include "UHH2/core/include/Hists.h"
 #include "UHH2/core/include/Event.h"
 
+#include "UHH2/LegacyTopTagging/include/StagedHists.h"
+
 
 namespace uhh2 { namespace ltt {
 
-class CommonHists: public uhh2::Hists {
+class CommonHists: public StagedHists {
 public:
   CommonHists(uhh2::Context & ctx, const std::string & dirname, const unsigned int default_nbins = 100);
 
   virtual void fill(const uhh2::Event & event) override;
+  virtual void fill(const uhh2::Event & event, const StageQuantities & quantities) override;
 
 protected:
   TH1F *hist_count;
@@ -68,6 +68,7 @@ const std::string kHandleName_pairedPUPPIjets = "pairedPUPPIjets";
 const std::string kHandleName_pairedPUPPIjets_hemi = "pairedPUPPIjets_hemi";
 const std::string kHandleName_pairedCHSjets = "pairedCHSjets";
 const std::string kHandleName_pairedCHSjets_hemi = "pairedCHSjets_hemi";
+const std::string kHandleSuffix_BTagDecisions = "_BTagDecisions"; // e.g. "pairedCHSjets_BTagDecisions", see ltt::BTagDecision
 const double kDeltaRForPuppiCHSMatch = 0.2;
 const double kAbsEtaBTagThreshold = 2.5;
 const std::string kHandleName_forwardPUPPIjets = "forwardPUPPIjets";
@@ -76,11 +77,15 @@ const std::string kCollectionName_METCHS = "slimmedMETs";
 const std::string kCollectionName_METPUPPI = "slimmedMETsPuppi";
 
 const std::string kHandleName_weight_btag_njet_sf = "weight_btag_njet_sf";
+const std::string kHandleName_WeightLedger = "weight_ledger"; // see ltt::WeightLedger
+const std::string kHandleName_TheoryWeights = "weight_theory"; // see ltt::TheoryWeightBlock
 
 const std::string kCollectionName_AK8_rec = "jetsAk8PuppiSubstructure_SoftDropPuppi";
 const std::string kCollectionName_AK8_gen = "genjetsAk8SubstructureSoftDrop";
 
 const std::string kHandleName_PrimaryLepton = "PrimaryLepton";
+const std::string kHandleName_LeptonJetProximity = "LeptonJetProximity";
+const std::string kHandleName_LeptonContext = "LeptonContext";
 const double kDeltaRLeptonicHemisphere = M_PI*2./3.;
 
 const std::string kHandleName_bJets = "bJets";
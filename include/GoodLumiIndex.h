@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Compact lookup table of certified luminosity sections. Each run between the first and last certified run has an
+// entry in a dense run table pointing to its lumi range; runs in which all sections between the first and last
+// certified one are good do not need the bitmap, all other runs get one bit per section in a shared bitmap:
+//
+//   contains(run, lumi): run table -> run entry -> (bit test)
+//
+// Free of UHH2 and ROOT dependencies. Can be built from the ranges of a golden JSON file or from single (run, lumi)
+// pairs, and can be saved to / loaded from a binary file (native byte order). The file records the path, size, and
+// modification time of the lumi file the index was built from, so that users can detect a stale index.
+class GoodLumiIndex {
+public:
+  typedef std::map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> Ranges; // run -> inclusive lumi ranges
+
+  struct Source {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    bool operator==(const Source & other) const { return path == other.path && size == other.size && mtime == other.mtime; };
+    bool operator!=(const Source & other) const { return !(*this == other); };
+  };
+  static Source source_of(const std::string & file_path); // current size and modification time of the file
+
+  GoodLumiIndex() {};
+  GoodLumiIndex(const Ranges & ranges);
+  static GoodLumiIndex from_json(const std::string & json);
+  static GoodLumiIndex from_pairs(const std::vector<std::pair<uint32_t, uint32_t>> & run_lumis);
+  static GoodLumiIndex load(const std::string & file_path);
+  void save(const std::string & file_path) const;
+
+  inline bool contains(const uint32_t run, const uint32_t lumi) const {
+    const uint32_t i = run - fMinRun; // wraps around for run < fMinRun
+    if(i >= fRunTable.size() || fRunTable[i] < 0) return false;
+    const RunEntry & entry = fRuns[fRunTable[i]];
+    const uint32_t l = lumi - entry.first_lumi;
+    if(l >= entry.n_lumis) return false;
+    if(entry.all_good) return true;
+    const uint64_t bit = entry.bit_offset + l;
+    return (fBits[bit >> 6] >> (bit & 63)) & 1;
+  };
+
+  const Source & source() const { return fSource; };
+  void set_source(const Source & source) { fSource = source; };
+
+  unsigned int n_runs() const { return fRuns.size(); };
+  unsigned int n_partial_runs() const;
+  unsigned long long n_good_lumis() const;
+
+private:
+  struct RunEntry {
+    uint32_t run;
+    uint32_t first_lumi;
+    uint32_t n_lumis;
+    uint32_t all_good;
+    uint64_t bit_offset;
+  };
+  void build_run_table();
+  Source fSource;
+  std::vector<RunEntry> fRuns;
+  std::vector<uint64_t> fBits;
+  uint32_t fMinRun = 0;
+  std::vector<int32_t> fRunTable; // run - fMinRun -> index in fRuns, -1 if no good sections
+};
+
+}}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "UHH2/core/include/Event.h"
+#include "UHH2/core/include/Selection.h"
+
+#include "UHH2/LegacyTopTagging/include/GoodLumiIndex.h"
+
+#include <memory>
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Drop-in replacement of LumiSelection from UHH2/common based on GoodLumiIndex (always passes for MC). The index is
+// built from "lumi_file" (the ROOT file also read by LumiSelection, or a golden JSON file if it ends with ".json" or
+// ".txt").
+//
+// If "good_lumi_index_file" is set, the index is loaded from this binary file; if it does not exist yet or was built
+// from a different lumi file (path, size, or modification time differ), it is built as above and saved there for the
+// next jobs.
+//
+// If "validate_good_lumi_index" is true, LumiSelection is run in addition for every event and an exception is thrown
+// at the first disagreement. Use this once per year after changing the lumi file.
+class GoodLumiSelection: public uhh2::Selection {
+public:
+  GoodLumiSelection(uhh2::Context & ctx);
+  virtual bool passes(const uhh2::Event & event) override;
+private:
+  GoodLumiIndex fIndex;
+  std::unique_ptr<uhh2::Selection> fValidation;
+};
+
+}}
@@ -3,14 +3,17 @@
 #include "UHH2/core/include/Hists.h"
 #include "UHH2/core/include/Event.h"
 
+#include "UHH2/LegacyTopTagging/include/StagedHists.h"
+
 
 namespace uhh2 { namespace ltt {
 
-class HOTVRHists: public uhh2::Hists {
+class HOTVRHists: public StagedHists {
 public:
   HOTVRHists(uhh2::Context & ctx, const std::string & dirname, const std::string & coll_rec = "", const std::string & coll_gen = "", const std::string & handle_name_tag = "dummy", const bool doResponseHists_ = false, const unsigned int default_nbins = 100);
 
   virtual void fill(const uhh2::Event & event) override;
+  virtual void fill(const uhh2::Event & event, const StageQuantities & quantities) override;
 
 protected:
   TH1F *hist_number;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class TH1F;
+
+namespace uhh2 { class Context; }
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Bin edges of a one-dimensional histogram
+class HistBinning {
+public:
+  HistBinning() {};
+  HistBinning(const unsigned int nbins, const double xmin, const double xmax);
+  HistBinning(const std::vector<double> & edges);
+
+  int nbins() const { return fEdges.empty() ? 0 : fEdges.size() - 1; };
+  double xmin() const { return fEdges.front(); };
+  double xmax() const { return fEdges.back(); };
+  const double * edges() const { return fEdges.data(); };
+  const std::vector<double> & edge_vector() const { return fEdges; };
+  bool is_uniform() const { return fUniform; };
+
+  // True if every edge of this binning is also an edge of "finer", i.e. histograms booked with "finer" can be
+  // rebinned to this binning without losing information
+  bool is_coarsening_of(const HistBinning & finer) const;
+  // Merges each "factor" adjacent bins; nbins() needs to be divisible by factor
+  HistBinning coarsened(const unsigned int factor) const;
+
+private:
+  std::vector<double> fEdges;
+  bool fUniform = false;
+};
+
+//____________________________________________________________________________________________________
+// Binning overrides for histograms, read from a text file with one rule per line:
+//
+//   <pattern>  uniform    <nbins> <xmin> <xmax>
+//   <pattern>  edges      <x0> <x1> ... <xN>
+//   <pattern>  piecewise  <x0> <width0> <x1> <width1> ... <xN>  (bins of width0 from x0 to x1, then width1, ...)
+//   <pattern>  rebin      <factor>                               (merge "factor" adjacent bins of the default binning)
+//
+// <pattern> is matched (shell-style wildcards) against "<hists dirname>/<histogram name>"; the first matching rule
+// wins. Empty lines and lines starting with '#' are ignored. Histograms without matching rule keep their default
+// binning, so an empty registry reproduces the binnings hardcoded in the Hists classes.
+class HistBinningRegistry {
+public:
+  HistBinningRegistry() {};
+  HistBinningRegistry(const std::string & filename);
+
+  HistBinning get(const std::string & name, const HistBinning & default_binning) const;
+  bool empty() const { return fRules.empty(); };
+
+  // Parses each file only once per process; relative paths are looked up in $CMSSW_BASE/src/UHH2/LegacyTopTagging/
+  static const HistBinningRegistry & instance(const std::string & filename);
+
+private:
+  enum class RuleType { uniform, edges, piecewise, rebin };
+  struct Rule {
+    std::string pattern;
+    RuleType type;
+    std::vector<double> values;
+    HistBinning binning; // fixed binning of uniform/edges/piecewise rules
+  };
+  std::vector<Rule> fRules;
+};
+
+//____________________________________________________________________________________________________
+// Books a TH1F into the hist directory "dirname" like uhh2::Hists::book, with the binning given for
+// "<dirname>/<name>" in the registry of the config item "hist_binning_file", else with default_binning
+TH1F * book_binned(uhh2::Context & ctx, const std::string & dirname, const std::string & name, const char *title, const HistBinning & default_binning);
+
+}}
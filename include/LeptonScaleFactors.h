@@ -16,6 +16,8 @@
 #include "UHH2/common/include/Utils.h"
 #include "UHH2/common/include/YearRunSwitchers.h"
 
+#include "UHH2/LegacyTopTagging/include/WeightLedgerSchema.h"
+
 
 namespace uhh2 { namespace ltt {
 
@@ -85,6 +87,7 @@ public:
     const boost::optional<bool> & dummy = boost::none
   );
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const std::string fSystDirectionConfigName = "SystDirection_ElectronReco";
   const bool fLowPtElectrons;
@@ -95,6 +98,7 @@ private:
   const uhh2::Event::Handle<std::vector<Electron>> fHandleElectrons;
   std::vector<uhh2::Event::Handle<float>> fWeightHandles;
   std::unique_ptr<YearSwitcher> fYearSwitcher;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -110,6 +114,7 @@ public:
     const boost::optional<bool> & dummy = boost::none
   );
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const std::string fSystDirectionConfigName = "SystDirection_ElectronId";
   ElectronId fElectronID;
@@ -120,6 +125,7 @@ private:
   const uhh2::Event::Handle<std::vector<Electron>> fHandleElectrons;
   std::vector<uhh2::Event::Handle<float>> fWeightHandles;
   std::unique_ptr<YearSwitcher> fYearSwitcher;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 
@@ -140,6 +146,7 @@ public:
     const boost::optional<bool> & dummy = boost::none
   );
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const std::string fSystDirectionConfigName = "SystDirection_MuonId";
   MuonId fMuonID;
@@ -150,6 +157,7 @@ private:
   const uhh2::Event::Handle<std::vector<Muon>> fHandleMuons;
   std::vector<uhh2::Event::Handle<float>> fWeightHandles;
   std::unique_ptr<YearSwitcher> fYearSwitcher;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -165,6 +173,7 @@ public:
     const boost::optional<bool> & dummy = boost::none
   );
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const std::string fSystDirectionConfigName = "SystDirection_MuonIso";
   MuonId fMuonID;
@@ -175,6 +184,7 @@ private:
   const uhh2::Event::Handle<std::vector<Muon>> fHandleMuons;
   std::vector<uhh2::Event::Handle<float>> fWeightHandles;
   std::unique_ptr<YearSwitcher> fYearSwitcher;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -202,6 +212,7 @@ public:
     const boost::optional<bool> & dummy = boost::none
   );
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const std::string fSystDirectionConfigName = "SystDirection_MuonTrigger";
   const boost::optional<bool> fUseMu50;
@@ -215,6 +226,7 @@ private:
   const uhh2::Event::Handle<std::vector<Muon>> fHandleMuons;
   std::vector<uhh2::Event::Handle<float>> fWeightHandles;
   std::unique_ptr<YearSwitcher> fYearSwitcher;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 }}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "UHH2/core/include/AnalysisModule.h"
+#include "UHH2/core/include/Event.h"
+
+#include <functional>
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Branches of the output AnalysisTree read by a downstream step of the analysis
+typedef struct {
+  std::string name;
+  std::vector<std::string> branches;
+} OutputConsumer;
+
+// Config keys (plus "additionalBranches") of the collections which UHH2 writes to the output tree by default
+const std::vector<std::string> kOutputCollectionKeys = {
+  "PrimaryVertexCollection",
+  "METName",
+  "GenMETName",
+  "ElectronCollection",
+  "MuonCollection",
+  "TauCollection",
+  "PhotonCollection",
+  "JetCollection",
+  "GenJetCollection",
+  "TopJetCollection",
+  "GenTopJetCollection",
+  "GenParticleCollection",
+  "PFParticleCollection",
+  "GenInfoName",
+};
+
+//____________________________________________________________________________________________________
+// Slims the output tree of a selection step:
+//
+//  - Collections not read by any of the given consumers are not written.
+//  - If "output_genparticles_datasets" is set (space-separated dataset name prefixes, e.g. "TTbar ST"), the
+//    genparticles are only written for MC datasets starting with one of them.
+//  - Members of the written Jet/TopJet collections can be dropped with add_jet_slimming() / add_topjet_slimming().
+//    The UHH2 classes have fixed members, so these are set to zero which is compressed to almost nothing.
+//
+// Trigger results and the branches declared by other modules are not touched. The member slimming happens in
+// process(), so this module needs to run last, right before the event is written.
+class OutputSlimmer: public uhh2::AnalysisModule {
+public:
+  OutputSlimmer(uhh2::Context & ctx, const std::vector<OutputConsumer> & consumers);
+  void add_jet_slimming(uhh2::Context & ctx, const std::string & collection, const std::function<void(Jet &)> & slimming);
+  void add_topjet_slimming(uhh2::Context & ctx, const std::string & collection, const std::function<void(TopJet &)> & slimming);
+  virtual bool process(uhh2::Event & event) override;
+private:
+  std::vector<std::string> fKeptBranches;
+  std::vector<std::pair<uhh2::Event::Handle<std::vector<Jet>>, std::function<void(Jet &)>>> fJetSlimmings;
+  std::vector<std::pair<uhh2::Event::Handle<std::vector<TopJet>>, std::function<void(TopJet &)>>> fTopJetSlimmings;
+};
+
+}}
@@ -155,6 +155,17 @@ class RoccoR{
 	void init(std::string filename);
 	void reset();
 	bool empty() const {return RC.empty();} 
+	int nSets() const {return nset;}
+	int nMembers(int s) const {return nmem[s];}
+
+	// Binary cache of the parsed parameter set (not part of the original RoccoR code):
+	// writeCache() serializes the current parameters together with a checksum of the text file they were parsed from;
+	// initFromCache() memory-maps such a blob and returns false (leaving the object empty) if it is missing, corrupt,
+	// written by an incompatible version, or stale with respect to the given text file.
+	static const unsigned int CACHE_VERSION;
+	static std::string cacheName(std::string filename);
+	void writeCache(std::string cachename, std::string filename) const;
+	bool initFromCache(std::string cachename, std::string filename);
 	const RocRes& getRes(int s=0, int m=0) const {return RC[s][m].RR;}
 	double getM(int T, int H, int F, int s=0, int m=0) const{return RC[s][m].CP[T][H][F].M;}
 	double getA(int T, int H, int F, int s=0, int m=0) const{return RC[s][m].CP[T][H][F].A;}
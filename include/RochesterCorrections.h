@@ -8,6 +8,8 @@
 
 #include "UHH2/LegacyTopTagging/include/RoccoR.h"
 
+#include "TRandom3.h"
+
 
 namespace uhh2 { namespace ltt {
 
@@ -17,16 +19,25 @@ https://twiki.cern.ch/twiki/bin/viewauth/CMS/RochcorMuon
 https://indico.cern.ch/event/981770/contributions/4135530/attachments/2157765/3639739/roccor.pdf
 
 Cite: EPJC V72, 10.2194 (2012) (arXiv:1208.3710)
+
+The parameters are read from the binary cache next to the text file (e.g. RoccoR2017UL.bin, created once with
+Analysis/Rochester/create_roccor_cache) if it is up to date, else the text file is parsed.
+
+All systematic variations (sets 1-5 incl. the 100 stat. replicas, see data/rochester/README.md) are written to the
+AnalysisTree as one flat vector per event: for each muon (in the order of event.muons), one entry per set/member
+in the order (s=1,m=0), ..., (s=1,m=99), (s=2,m=0), ..., each being the ratio of the varied to the nominal factor.
 */
 class RochesterCorrections: public uhh2::AnalysisModule {
 public:
   RochesterCorrections(uhh2::Context & ctx);
   virtual bool process(uhh2::Event & event) override;
+  unsigned int GetNVariations() const { return fVariations.size(); };
 private:
   const Year fYear;
   std::unique_ptr<RoccoR> rc;
-  int variation_set;
-  int variation_member;
+  std::vector<std::pair<int, int>> fVariations; // (set, member)
+  TRandom3 fRandom;
+  const uhh2::Event::Handle<std::vector<float>> fHandle_variations;
 };
 
 }}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "UHH2/core/include/Event.h"
+#include "UHH2/core/include/Hists.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TH1D.h"
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Weighted and unweighted number of events after each step of a SelectionScheduler; bin 1 holds the input events
+class CutflowHists: public uhh2::Hists {
+public:
+  CutflowHists(uhh2::Context & ctx, const std::string & dirname, const std::vector<std::string> & step_names);
+  virtual void fill(const uhh2::Event & event) override {};
+  void fill(const unsigned int bin, const double weight);
+private:
+  TH1D *h_weighted;
+  TH1D *h_unweighted;
+};
+
+//____________________________________________________________________________________________________
+// Runs a chain of selection steps. Each step is a function returning false if the event is rejected and declares
+// which earlier steps it needs (i.e. whose modules produce or modify something it reads). The declaration order
+// needs to be a valid order of the steps.
+//
+// During the first "warmup_events" events, the steps run in declaration order while their mean cost and pass rate
+// are measured. If "adaptive" is true, the steps are then reordered greedily: among all steps whose needs already
+// ran, the one with the largest rejection rate per cost comes first. Since an event passes only if all steps pass
+// and steps only move past steps they do not depend on, the selected events are identical. Steps which change
+// event.weight implicitly depend on the previous such step, so the weights are multiplied in the same order and
+// are identical as well. Everything inside a step that depends on the order of the steps (e.g. histogram stages)
+// needs to be switched off in adaptive mode.
+//
+// The weighted and unweighted number of events passing each step is counted; with book_cutflow(), these are also
+// written as histograms, so no full histogram stages are needed just to count events. The bins are in declaration
+// order; in adaptive mode, each bin counts the events passing the step and all steps that actually ran before it.
+//
+// A report with the cutflow and the cost, pass rate, and (estimated) saved time of each step is printed at
+// destruction, together with the wall time of the event loop between the first and the last event. The latter is
+// read from the job logs by config/jobSplitter.py to measure the throughput of each sample class.
+class SelectionScheduler {
+public:
+  typedef std::function<bool(uhh2::Event &)> Step;
+
+  SelectionScheduler(const std::string & name, const bool adaptive, const unsigned long long warmup_events = 1000);
+  ~SelectionScheduler();
+  void add_step(const std::string & name, const std::vector<std::string> & needs, const Step & step, const bool changes_weight = false);
+  void book_cutflow(uhh2::Context & ctx, const std::string & dirname = "Cutflow"); // after all steps have been added
+  bool process(uhh2::Event & event);
+  std::string report() const;
+
+private:
+  struct StepInfo {
+    std::string name;
+    std::vector<unsigned int> needs;
+    Step step;
+    unsigned long long n_calls = 0;
+    unsigned long long n_passed = 0;
+    double seconds = 0.;
+    double sumw_passed = 0.;
+    double pass_rate() const { return n_calls ? (double)n_passed / n_calls : 1.; };
+    double mean_cost() const { return n_calls ? seconds / n_calls : 0.; };
+  };
+  void reorder();
+
+  const std::string fName;
+  const bool fAdaptive;
+  const unsigned long long fWarmupEvents;
+  std::vector<StepInfo> fSteps;
+  std::vector<unsigned int> fOrder;
+  int fLastWeightStep = -1;
+  unsigned long long fNEvents = 0;
+  double fSumwInput = 0.;
+  std::chrono::steady_clock::time_point fFirstEvent;
+  std::chrono::steady_clock::time_point fLastEvent;
+  std::unique_ptr<CutflowHists> fCutflow;
+};
+
+}}
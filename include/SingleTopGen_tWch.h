@@ -41,8 +41,31 @@ public:
    * not all contents is valid; most will return a 0 vector. The one thing guaranteed is that the
    * decaychannel will be e_notfound. If using throw_on_failure = false, it is thus a good idea
    * to check the decaychannel.
+   *
+   * By default, the genparticles are decoded with an index-based decoder which first builds the
+   * genparticle index -> position map and the mother -> daughters adjacency in one pass and then
+   * resolves all particles by index (linear in the number of genparticles). The original decoder,
+   * which looks up mothers/daughters by scanning the genparticles vector, is kept as Decoder::legacy
+   * for validation purposes (see SingleTopGen_tWchProducer).
+   */
+  enum class Decoder {
+    indexed,
+    legacy,
+  };
+
+  explicit SingleTopGen_tWch(const std::vector<GenParticle> & genparts, bool throw_on_failure = true, const Decoder decoder = Decoder::indexed);
+
+  /** Ambiguous topologies which the decoder had to resolve, stored as bit flags (only filled by Decoder::indexed)
    */
-  explicit SingleTopGen_tWch(const std::vector<GenParticle> & genparts, bool throw_on_failure = true);
+  enum E_Ambiguity{
+    e_amb_TopExtraDaughters = 1 << 0, // top has more than two daughters, e.g. due to an emitted photon splitting into leptons
+    e_amb_WTopNotFirstDaughters = 1 << 1, // W from top not found among daughter1/daughter2 of the top
+    e_amb_bTopNotFirstDaughters = 1 << 2, // same for b from top
+    e_amb_WTopCopies = 1 << 3, // W from top has intermediate copies before its decay
+    e_amb_WAssCopies = 1 << 4, // same for associated W
+    e_amb_MultipleGluonsAss = 1 << 5, // more than one final state gluon candidate; the last one is taken
+    e_amb_MultipleBottomsAss = 1 << 6, // more than one associated bottom candidate; the last one is taken
+  };
 
   enum E_DecayChannel{
     e_assele_topele,
@@ -103,8 +126,16 @@ public:
   bool HasAssociatedBottom() const;
   bool HasAssociatedGluon() const;
 
+  unsigned int Ambiguities() const;
+  bool IsAmbiguous() const;
+  bool IsAmbiguous(const E_Ambiguity ambiguity) const;
+
  private:
 
+  bool decode_indexed(const std::vector<GenParticle> & genparticles, bool throw_on_failure);
+  bool decode_legacy(const std::vector<GenParticle> & genparticles, bool throw_on_failure);
+  void set_decay_channel();
+
   GenParticle m_Top;
   GenParticle m_WTop;
   GenParticle m_bTop;
@@ -118,19 +149,31 @@ public:
   GenParticle m_gluonAss = GenParticle(); // make sure that this member variable is initialized
   GenParticle m_bAss = GenParticle(); // same
   bool m_has_bAss = false;
+  unsigned int m_ambiguities = 0;
 
   E_DecayChannel m_type;
 };
 
 
+/** \brief Writes SingleTopGen_tWch to the event
+ *
+ * If "validate_SingleTopGen_tWch" is set to true in the XML config, every event is additionally decoded
+ * with the legacy decoder and all accessors of both results are compared. Mismatches are printed
+ * together with the event number, and a summary is printed at the end of the job.
+ */
 class SingleTopGen_tWchProducer: public uhh2::AnalysisModule {
 public:
     explicit SingleTopGen_tWchProducer(uhh2::Context & ctx, const std::string & name = "singletopgen_twch", bool throw_on_failure = true);
     virtual bool process(uhh2::Event & event) override;
+    virtual ~SingleTopGen_tWchProducer();
 
 private:
     uhh2::Event::Handle<SingleTopGen_tWch> h_singletopgen_twch;
     bool throw_on_failure;
+    bool validate;
+    unsigned long long n_validated = 0;
+    unsigned long long n_mismatches = 0;
+    unsigned long long n_ambiguous = 0;
 };
 
 }}
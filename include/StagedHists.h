@@ -0,0 +1,29 @@
+#pragma once
+
+#include "UHH2/core/include/Hists.h"
+#include "UHH2/core/include/Event.h"
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Per-event quantities which several hist groups of the same AndHists stage need. They are computed once
+// per stage fill by AndHists and handed to all its StagedHists; null pointers mean "not available"
+struct StageQuantities {
+  double weight = 1.;
+  const FlavorParticle *primlep = nullptr;
+  const std::vector<TopJet> *ak8jets = nullptr; // pt-sorted
+  const std::vector<TopJet> *hotvrjets = nullptr; // pt-sorted
+};
+
+//____________________________________________________________________________________________________
+// Hists which can be filled from precomputed StageQuantities. The plain fill(event) is still available
+// for standalone usage and computes the quantities it needs on its own
+class StagedHists: public uhh2::Hists {
+public:
+  StagedHists(uhh2::Context & ctx, const std::string & dirname): uhh2::Hists(ctx, dirname) {};
+  virtual void fill(const uhh2::Event & event) override = 0;
+  virtual void fill(const uhh2::Event & event, const StageQuantities & quantities) = 0;
+};
+
+}}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "UHH2/core/include/AnalysisModule.h"
+#include "UHH2/core/include/Event.h"
+#include "UHH2/core/include/Hists.h"
+
+#include "UHH2/LegacyTopTagging/include/Constants.h"
+
+#include "TH1D.h"
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Fixed layout of the theory weight block: all parton shower weights of the UL samples (46 Pythia weights in
+// event.genInfo->weights(), index 0 being the nominal one) and the six muR/muF variations of the LHE scale weights
+// (event.genInfo->systweights(), relative to originalXWGTUP())
+enum class TheoryWeightSource {
+  PS,
+  LHE,
+};
+
+typedef struct {
+  std::string name;
+  TheoryWeightSource source;
+  unsigned int index;
+} TheoryWeightInfo;
+
+const std::vector<TheoryWeightInfo> kTheoryWeights = {
+  TheoryWeightInfo{"isr_sqrt2_up", TheoryWeightSource::PS, 2},
+  TheoryWeightInfo{"fsr_sqrt2_up", TheoryWeightSource::PS, 3},
+  TheoryWeightInfo{"isr_sqrt2_down", TheoryWeightSource::PS, 4},
+  TheoryWeightInfo{"fsr_sqrt2_down", TheoryWeightSource::PS, 5},
+  TheoryWeightInfo{"isr_2_up", TheoryWeightSource::PS, 6},
+  TheoryWeightInfo{"fsr_2_up", TheoryWeightSource::PS, 7},
+  TheoryWeightInfo{"isr_2_down", TheoryWeightSource::PS, 8},
+  TheoryWeightInfo{"fsr_2_down", TheoryWeightSource::PS, 9},
+  TheoryWeightInfo{"isr_4_up", TheoryWeightSource::PS, 10},
+  TheoryWeightInfo{"fsr_4_up", TheoryWeightSource::PS, 11},
+  TheoryWeightInfo{"isr_4_down", TheoryWeightSource::PS, 12},
+  TheoryWeightInfo{"fsr_4_down", TheoryWeightSource::PS, 13},
+  TheoryWeightInfo{"fsr_g2gg_mur_down", TheoryWeightSource::PS, 14},
+  TheoryWeightInfo{"fsr_g2gg_mur_up", TheoryWeightSource::PS, 15},
+  TheoryWeightInfo{"fsr_g2qq_mur_down", TheoryWeightSource::PS, 16},
+  TheoryWeightInfo{"fsr_g2qq_mur_up", TheoryWeightSource::PS, 17},
+  TheoryWeightInfo{"fsr_q2qg_mur_down", TheoryWeightSource::PS, 18},
+  TheoryWeightInfo{"fsr_q2qg_mur_up", TheoryWeightSource::PS, 19},
+  TheoryWeightInfo{"fsr_x2xg_mur_down", TheoryWeightSource::PS, 20},
+  TheoryWeightInfo{"fsr_x2xg_mur_up", TheoryWeightSource::PS, 21},
+  TheoryWeightInfo{"fsr_g2gg_cns_down", TheoryWeightSource::PS, 22},
+  TheoryWeightInfo{"fsr_g2gg_cns_up", TheoryWeightSource::PS, 23},
+  TheoryWeightInfo{"fsr_g2qq_cns_down", TheoryWeightSource::PS, 24},
+  TheoryWeightInfo{"fsr_g2qq_cns_up", TheoryWeightSource::PS, 25},
+  TheoryWeightInfo{"fsr_q2qg_cns_down", TheoryWeightSource::PS, 26},
+  TheoryWeightInfo{"fsr_q2qg_cns_up", TheoryWeightSource::PS, 27},
+  TheoryWeightInfo{"fsr_x2xg_cns_down", TheoryWeightSource::PS, 28},
+  TheoryWeightInfo{"fsr_x2xg_cns_up", TheoryWeightSource::PS, 29},
+  TheoryWeightInfo{"isr_g2gg_mur_down", TheoryWeightSource::PS, 30},
+  TheoryWeightInfo{"isr_g2gg_mur_up", TheoryWeightSource::PS, 31},
+  TheoryWeightInfo{"isr_g2qq_mur_down", TheoryWeightSource::PS, 32},
+  TheoryWeightInfo{"isr_g2qq_mur_up", TheoryWeightSource::PS, 33},
+  TheoryWeightInfo{"isr_q2qg_mur_down", TheoryWeightSource::PS, 34},
+  TheoryWeightInfo{"isr_q2qg_mur_up", TheoryWeightSource::PS, 35},
+  TheoryWeightInfo{"isr_x2xg_mur_down", TheoryWeightSource::PS, 36},
+  TheoryWeightInfo{"isr_x2xg_mur_up", TheoryWeightSource::PS, 37},
+  TheoryWeightInfo{"isr_g2gg_cns_down", TheoryWeightSource::PS, 38},
+  TheoryWeightInfo{"isr_g2gg_cns_up", TheoryWeightSource::PS, 39},
+  TheoryWeightInfo{"isr_g2qq_cns_down", TheoryWeightSource::PS, 40},
+  TheoryWeightInfo{"isr_g2qq_cns_up", TheoryWeightSource::PS, 41},
+  TheoryWeightInfo{"isr_q2qg_cns_down", TheoryWeightSource::PS, 42},
+  TheoryWeightInfo{"isr_q2qg_cns_up", TheoryWeightSource::PS, 43},
+  TheoryWeightInfo{"isr_x2xg_cns_down", TheoryWeightSource::PS, 44},
+  TheoryWeightInfo{"isr_x2xg_cns_up", TheoryWeightSource::PS, 45},
+  TheoryWeightInfo{"murmuf_noneup", TheoryWeightSource::LHE, 1},
+  TheoryWeightInfo{"murmuf_nonedown", TheoryWeightSource::LHE, 2},
+  TheoryWeightInfo{"murmuf_upnone", TheoryWeightSource::LHE, 3},
+  TheoryWeightInfo{"murmuf_upup", TheoryWeightSource::LHE, 4},
+  TheoryWeightInfo{"murmuf_downnone", TheoryWeightSource::LHE, 6},
+  TheoryWeightInfo{"murmuf_downdown", TheoryWeightSource::LHE, 8},
+};
+
+//____________________________________________________________________________________________________
+// Sums of generator weights needed to normalize the theory weights: bin 1 ("nominal") holds the sum of the nominal
+// generator weights, bin i+2 the sum of the generator weights times theory weight i of kTheoryWeights
+class TheoryWeightSumHists: public uhh2::Hists {
+public:
+  TheoryWeightSumHists(uhh2::Context & ctx, const std::string & dirname);
+  virtual void fill(const uhh2::Event & event) override {};
+  void fill(const double gen_weight, const std::vector<float> & theory_weights);
+private:
+  TH1D *h_sumw;
+};
+
+//____________________________________________________________________________________________________
+// Writes all parton shower and muR/muF weights (ratios to the nominal generator weight, in the order of
+// kTheoryWeights) to one vector<float> branch per event, so that all of these systematics can be obtained from the
+// nominal job instead of one SFrame run per variation. Nothing is applied to event.weight. Samples without the
+// respective weights get 1 for all of them.
+//
+// The per-sample normalization is done offline with the sums of weights stored in the hist directory "dirname":
+//   normalized weight i = weight i * sumw(nominal) / sumw(i)
+// These sums need to be filled before any selection, i.e. call this module at the very beginning of process(). If the
+// module runs on already skimmed ntuples, the sums of the job which ran on the unskimmed ones need to be used; pass an
+// empty dirname there so that no sums are booked at all.
+class TheoryWeightBlock: public uhh2::AnalysisModule {
+public:
+  TheoryWeightBlock(uhh2::Context & ctx, const std::string & branch_name = kHandleName_TheoryWeights, const std::string & dirname = "TheoryWeightSums");
+  virtual bool process(uhh2::Event & event) override;
+private:
+  const bool fIsMC;
+  const uhh2::Event::Handle<std::vector<float>> fHandle_weights;
+  std::unique_ptr<TheoryWeightSumHists> fHists;
+  unsigned int fMaxIndexPS = 0;
+  unsigned int fMaxIndexLHE = 0;
+  bool fWarnedPS = false;
+  bool fWarnedLHE = false;
+};
+
+}}
@@ -13,6 +13,7 @@
 
 #include "UHH2/LegacyTopTagging/include/Constants.h"
 #include "UHH2/LegacyTopTagging/include/SingleTopGen_tWch.h"
+#include "UHH2/LegacyTopTagging/include/WeightLedgerSchema.h"
 
 
 namespace uhh2 { namespace ltt {
@@ -128,15 +129,45 @@ private:
 const TopJet * nextTopJet(const Particle & p, const std::vector<TopJet> & topjets);
 
 //____________________________________________________________________________________________________
+// Primary lepton and the quantities derived from it and the final MET. Computed once per event by
+// LeptonContextProducer after the lepton selection and the MET corrections, then read by PTWSelection, NoLeptonInJet
+// and MainOutputSetter
+struct LeptonContext {
+  FlavorParticle primlep;
+  Channel channel = Channel::notValid;
+  bool highpt = false; // pt regime of the primary lepton; decides about lepton ID and trigger
+  double ptw = -1.;
+  double mtw = -1.;
+  std::vector<Particle> muons; // kinematics of all muons/electrons of the event, for lepton-jet cleaning
+  std::vector<Particle> electrons;
+};
+
+//____________________________________________________________________________________________________
+class LeptonContextProducer: public uhh2::AnalysisModule {
+public:
+  LeptonContextProducer(uhh2::Context & ctx, const double _muon_highpt_pt_min, const double _electron_highpt_pt_min);
+  virtual bool process(uhh2::Event & event) override;
+private:
+  const double muon_highpt_pt_min;
+  const double electron_highpt_pt_min;
+  const uhh2::Event::Handle<FlavorParticle> h_primlep;
+  const uhh2::Event::Handle<LeptonContext> h_context;
+};
+
+//____________________________________________________________________________________________________
+// If constructed with the Context (and without lepton IDs), the lepton kinematics are taken from the LeptonContext
+// handle if it has been set for this event
 class NoLeptonInJet {
 public:
   explicit NoLeptonInJet(const std::string & _lepton, const double _dr, const boost::optional<ElectronId> & _ele_id = boost::none, const boost::optional<MuonId> & _muo_id = boost::none);
+  NoLeptonInJet(uhh2::Context & ctx, const std::string & _lepton, const double _dr);
   bool operator()(const Jet & jet, const uhh2::Event & event) const;
 private:
   const std::string lepton;
   const double dr;
   const boost::optional<ElectronId> ele_id;
   const boost::optional<MuonId> muo_id;
+  const boost::optional<uhh2::Event::Handle<LeptonContext>> h_context;
 };
 
 //____________________________________________________________________________________________________
@@ -159,19 +190,45 @@ private:
   const double ptw_min;
   const double ptw_max;
   const uhh2::Event::Handle<FlavorParticle> h_primlep;
+  const uhh2::Event::Handle<LeptonContext> h_context;
+};
+
+//____________________________________________________________________________________________________
+// Closest paired PUPPI jet to the primary lepton and the lepton's deltaR and pTrel w.r.t. it. Computed once per
+// event by LeptonJetProximityHandleSetter, then read by TwoDSelection and MainOutputSetter
+struct LeptonJetProximity {
+  int nextjet_index = -1; // position in the kHandleName_pairedPUPPIjets collection; -1 if there is no jet
+  double dr = -1.;
+  double ptrel = -1.;
 };
 
 //____________________________________________________________________________________________________
+class LeptonJetProximityHandleSetter: public uhh2::AnalysisModule {
+public:
+  LeptonJetProximityHandleSetter(uhh2::Context & ctx);
+  virtual bool process(uhh2::Event & event) override;
+private:
+  const uhh2::Event::Handle<FlavorParticle> h_primlep;
+  const uhh2::Event::Handle<std::vector<Jet>> h_jets;
+  const uhh2::Event::Handle<LeptonJetProximity> h_proximity;
+  std::vector<double> fEta; // jet eta/phi buffers, reused across events
+  std::vector<double> fPhi;
+};
+
+//____________________________________________________________________________________________________
+// Uses the LeptonJetProximity handle if it has been set for this event, else computes nextJet/pTrel itself
 class TwoDSelection: public uhh2::Selection {
 public:
   TwoDSelection(uhh2::Context & ctx, const double _ptrel_min, const double _dr_min, const bool _circular = false);
   virtual bool passes(const uhh2::Event & event) override;
+  Band band(const uhh2::Event & event) { return passes(event) ? Band::MAIN : Band::QCD; };
 private:
   const double ptrel_min;
   const double dr_min;
   const bool circular;
   const uhh2::Event::Handle<FlavorParticle> h_primlep;
   const uhh2::Event::Handle<std::vector<Jet>> h_jets;
+  const uhh2::Event::Handle<LeptonJetProximity> h_proximity;
 };
 
 //____________________________________________________________________________________________________
@@ -311,6 +368,8 @@ private:
   const uhh2::Event::Handle<TopJet> h_probejet_ak8;
   const uhh2::Event::Handle<FlavorParticle> h_primlep;
   const uhh2::Event::Handle<std::vector<Jet>> h_jets;
+  const uhh2::Event::Handle<LeptonJetProximity> h_proximity;
+  const uhh2::Event::Handle<LeptonContext> h_context;
   std::vector<uhh2::Event::Handle<float>> h_mainoutput;
   uhh2::Event::Handle<int> h_probejet_hotvr_nsub_integer;
 };
@@ -338,6 +397,7 @@ class PrefiringWeights: public uhh2::AnalysisModule {
 public:
   PrefiringWeights(uhh2::Context & ctx, const bool apply = true);
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const Year fYear;
   uhh2::Event::Handle<float> h_weight_nominal;
@@ -352,6 +412,7 @@ private:
     down,
   };
   PrefireVariation applied_variation;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -360,6 +421,7 @@ class TopPtReweighting: public uhh2::AnalysisModule {
 public:
   TopPtReweighting(uhh2::Context & ctx, const bool apply = true);
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   uhh2::Event::Handle<float> h_weight_nominal;
   uhh2::Event::Handle<float> h_weight_a_up;
@@ -386,6 +448,7 @@ private:
   const float fB = -0.0005;
   const float fB_up = fB*1.5;
   const float fB_down = fB*0.5;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -413,6 +476,7 @@ class VJetsReweighting: public uhh2::AnalysisModule {
  public:
   explicit VJetsReweighting(uhh2::Context & ctx, const std::string& weight_name="weight_vjets");
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 
  private:
   std::unordered_map<std::string, std::unique_ptr<TH1F>> histos;
@@ -434,6 +498,7 @@ class VJetsReweighting: public uhh2::AnalysisModule {
   const uhh2::Event::Handle<float> h_weight_QCD_EWK;
   const uhh2::Event::Handle<float> h_weight_QCD_NLO;
   const uhh2::Event::Handle<float> h_weight_QCD_NNLO;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -441,6 +506,7 @@ class WeightTrickery: public uhh2::AnalysisModule {
 public:
   WeightTrickery(uhh2::Context & ctx, const std::string & handle_name_GENtW, const bool doing_PDF_variations = false, const bool apply = true);
   virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSlot & ledger_slot() const { return fLedgerSlot; };
 private:
   const bool fDoingPDFVariations;
   const bool fApply;
@@ -464,6 +530,7 @@ private:
   bool is_tW_nfhd_syst;
   bool is_tW_nfhd_DS;
   bool is_tW_nfhd_PDF;
+  WeightLedgerSlot fLedgerSlot;
 };
 
 //____________________________________________________________________________________________________
@@ -501,6 +568,39 @@ inline void sort_by_deepjet_from_matches(std::vector<Jet> & jets, const uhh2::Ev
   std::sort(jets.begin(), jets.end(), [&event, &handle_chs_jets](const Jet & j1, const Jet & j2){return getCHSmatch(j1, event, handle_chs_jets)->btag_DeepJet() > getCHSmatch(j2, event, handle_chs_jets)->btag_DeepJet();});
 }
 
+//____________________________________________________________________________________________________
+// Decisions of all b-tagging algorithms (DeepCSV, DeepJet) and working points for one jet, packed into a bitfield,
+// together with the jet's hadron flavor. MatchPuppiToCHSAndSetBTagHandles evaluates them once per paired CHS jet and
+// stores them as std::vector<BTagDecision> (same order as the jet collection) in the handles
+// kHandleName_pairedCHSjets+kHandleSuffix_BTagDecisions and kHandleName_pairedCHSjets_hemi+kHandleSuffix_BTagDecisions
+class BTagDecision {
+public:
+  BTagDecision() {};
+  BTagDecision(const Jet & jet, const uhh2::Event & event);
+  bool passes(const BTag::algo & algo, const BTag::wp & wp) const { return fBits & (1 << bit(algo, wp)); };
+  int hadronFlavor() const { return fHadronFlavor; };
+  static unsigned int bit(const BTag::algo & algo, const BTag::wp & wp);
+private:
+  uint8_t fBits = 0;
+  int fHadronFlavor = 0;
+};
+
+//____________________________________________________________________________________________________
+// JetId reading the decision from the BTagDecision cache of the given jet collection. Works for jets which are elements
+// of that collection as stored in the event (e.g. when iterating over event.get(handle), as BTagMCEfficiencyHists does);
+// for any other jet, or if the cache has not been set, it falls back to evaluating BTag(algo, wp)
+class CachedBTag {
+public:
+  CachedBTag(uhh2::Context & ctx, const BTag::algo & algo, const BTag::wp & wp, const std::string & handle_name_jets);
+  bool operator()(const Jet & jet, const uhh2::Event & event) const;
+private:
+  const BTag::algo fAlgo;
+  const BTag::wp fWP;
+  const BTag fBTagID;
+  const uhh2::Event::Handle<std::vector<Jet>> fHandle_jets;
+  const uhh2::Event::Handle<std::vector<BTagDecision>> fHandle_decisions;
+};
+
 //____________________________________________________________________________________________________
 class MatchPuppiToCHSAndSetBTagHandles: public uhh2::AnalysisModule {
 public:
@@ -513,10 +613,10 @@ private:
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_pairedCHSjets;
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_forwardPUPPIjets;
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_uncleanedPUPPIjets;
+  const BTag::algo fBTagAlgo;
   const BTag::wp fBTagWP;
-  const JetId fBTagID_loose;
-  const JetId fBTagID_medium;
-  const JetId fBTagID_tight;
+  const uhh2::Event::Handle<std::vector<BTagDecision>> fHandle_pairedCHSjets_BTagDecisions;
+  const uhh2::Event::Handle<std::vector<BTagDecision>> fHandle_pairedCHSjets_hemi_BTagDecisions;
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_bJets;
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_bJets_loose;
   const uhh2::Event::Handle<std::vector<Jet>> fHandle_bJets_medium;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "UHH2/core/include/AnalysisModule.h"
+#include "UHH2/core/include/Event.h"
+
+#include "UHH2/LegacyTopTagging/include/Constants.h"
+#include "UHH2/LegacyTopTagging/include/WeightLedgerSchema.h"
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// Collects all variations of all registered event weight factors into one contiguous vector<float> branch. The
+// factors are read from the float handles their modules set anyway, so this also works for the modules of
+// UHH2/common; each of the weight modules of this analysis describes its own slot via ledger_slot().
+//
+// The schema (see WeightLedgerSchema) is written as metadata "<branch_name>_schema" and printed at construction.
+// If "write_legacy_weight_branches" is false, the individual float branches of all slots are not written anymore.
+//
+// Needs to be constructed after the weight modules and called after all of them ran, i.e. right before the event
+// is written. Factors whose module did not run for the event are stored as 1.
+class WeightLedger: public uhh2::AnalysisModule {
+public:
+  WeightLedger(uhh2::Context & ctx, const std::vector<WeightLedgerSlot> & slots, const std::string & branch_name = kHandleName_WeightLedger);
+  virtual bool process(uhh2::Event & event) override;
+  const WeightLedgerSchema & schema() const { return fSchema; };
+private:
+  const WeightLedgerSchema fSchema;
+  std::vector<uhh2::Event::Handle<float>> fHandles; // one per ledger entry
+  const uhh2::Event::Handle<std::vector<float>> fHandle_ledger;
+};
+
+// Slots for weight modules from UHH2/common; the handle names need to match the ones used there
+WeightLedgerSlot pileup_ledger_slot(uhh2::Context & ctx);
+WeightLedgerSlot murmuf_ledger_slot(uhh2::Context & ctx);
+WeightLedgerSlot ps_ledger_slot(uhh2::Context & ctx);
+
+}}
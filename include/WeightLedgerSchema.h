@@ -0,0 +1,65 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+// One event weight factor in the weight ledger: its variations (e.g. "nominal", "up", "down") and the index of the
+// variation which was multiplied into the event weight by the producing module (-1 if none). When filling the
+// ledger, variation i is read from the float handle handle_names.at(i); the handle names are not part of the schema
+struct WeightLedgerSlot {
+  std::string name;
+  std::vector<std::string> variations;
+  std::vector<std::string> handle_names;
+  int applied = -1;
+  int index_of(const std::string & variation) const; // -1 if there is no such variation
+};
+
+//____________________________________________________________________________________________________
+// Layout of the weight ledger, i.e. the per-event float vector holding all variations of all slots back to back.
+// It is stored as metadata of the output in the form
+//
+//   <slot>:<applied index>:<variation 0>,<variation 1>,...;<slot>:...
+//
+// Free of UHH2 dependencies so that it can be used by the offline tools, e.g. to reconstruct event weights with
+// other variations of some factors without rerunning SFrame:
+//
+//   const WeightLedgerSchema schema = WeightLedgerSchema::parse(schema_string);
+//   const auto rw = schema.reweighting({{"prefire", "up"}, {"toppt", "none"}});
+//   const double new_weight = weight * rw(ledger.data()); // per event
+class WeightLedgerSchema {
+public:
+  WeightLedgerSchema() {};
+  WeightLedgerSchema(const std::vector<WeightLedgerSlot> & slots);
+  static WeightLedgerSchema parse(const std::string & schema);
+  std::string to_string() const;
+
+  unsigned int size() const { return fSize; };
+  const std::vector<WeightLedgerSlot> & slots() const { return fSlots; };
+  unsigned int offset(const std::string & slot) const;
+  unsigned int index(const std::string & slot, const std::string & variation) const;
+
+  // Factor by which the stored event weight changes if, for each given slot, the chosen variation is applied
+  // instead of the one applied during the SFrame run; the variation "none" removes the factor completely
+  class Reweighting {
+  public:
+    double operator()(const float *ledger) const;
+  private:
+    friend class WeightLedgerSchema;
+    std::vector<std::pair<int, int>> fFactors; // (numerator, denominator) ledger indices, -1 means 1
+  };
+  Reweighting reweighting(const std::map<std::string, std::string> & choices) const;
+
+private:
+  const WeightLedgerSlot & slot(const std::string & name) const;
+  std::vector<WeightLedgerSlot> fSlots;
+  std::vector<unsigned int> fOffsets;
+  unsigned int fSize = 0;
+};
+
+}}
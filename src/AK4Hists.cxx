@@ -15,7 +15,7 @@ using namespace ltt;
 namespace uhh2 { namespace ltt {
 
 AK4Hists::AK4Hists(Context & ctx, const string & dirname, const unsigned int default_nbins):
-  Hists(ctx, dirname),
+  StagedHists(ctx, dirname),
   fHandle_PUPPIjets(ctx.get_handle<vector<Jet>>("jets")),
   fHandle_CHSjets(ctx.get_handle<vector<Jet>>(kCollectionName_AK4CHS)),
   fHandle_pairedPUPPIjets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets)),
@@ -104,13 +104,18 @@ AK4Hists::AK4Hists(Context & ctx, const string & dirname, const unsigned int def
 
 void AK4Hists::fill(const Event & event) {
 
-  const double w = event.weight;
-  FlavorParticle primlep = FlavorParticle();
-  bool valid_primlep(false);
-  if(event.is_valid(fHandle_PrimaryLepton)) {
-    primlep = event.get(fHandle_PrimaryLepton);
-    valid_primlep = true;
-  }
+  StageQuantities quantities;
+  quantities.weight = event.weight;
+  if(event.is_valid(fHandle_PrimaryLepton)) quantities.primlep = &event.get(fHandle_PrimaryLepton);
+  fill(event, quantities);
+}
+
+
+void AK4Hists::fill(const Event & event, const StageQuantities & quantities) {
+
+  const double w = quantities.weight;
+  const bool valid_primlep = quantities.primlep != nullptr;
+  const FlavorParticle primlep = valid_primlep ? *quantities.primlep : FlavorParticle();
   bool matching_done(false);
   vector<Jet> puppijets = event.get(fHandle_PUPPIjets);
   sort_by_pt<Jet>(puppijets);
@@ -1,4 +1,6 @@
+#include "UHH2/core/include/Utils.h"
 #include "UHH2/common/include/LuminosityHists.h"
+#include "UHH2/common/include/Utils.h"
 
 #include "UHH2/LegacyTopTagging/include/AndHists.h"
 #include "UHH2/LegacyTopTagging/include/AK8Hists.h"
@@ -13,34 +15,119 @@ using namespace uhh2;
 using namespace ltt;
 
 
+namespace {
+
+// Splits a comma-separated config value into its (whitespace-trimmed) non-empty entries
+vector<string> split_list(const string & value) {
+
+  vector<string> result;
+  string::size_type begin = 0;
+  while(begin <= value.size()) {
+    string::size_type end = value.find(',', begin);
+    if(end == string::npos) end = value.size();
+    const string::size_type first = value.find_first_not_of(" \t", begin);
+    const string::size_type last = value.find_last_not_of(" \t", end == 0 ? 0 : end - 1);
+    if(first != string::npos && first < end && last >= first) result.push_back(value.substr(first, last - first + 1));
+    begin = end + 1;
+  }
+  return result;
+}
+
+// Empty pattern list matches everything; a pattern ending with '*' matches all names with that prefix
+bool matches_any(const string & name, const vector<string> & patterns) {
+
+  if(patterns.empty()) return true;
+  for(const string & pattern : patterns) {
+    if(pattern.back() == '*') {
+      if(name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) return true;
+    }
+    else if(name == pattern) return true;
+  }
+  return false;
+}
+
+}
+
+
 namespace uhh2 { namespace ltt {
 
+//____________________________________________________________________________________________________
 AndHists::AndHists(Context & ctx, const string & dirname, const bool b_topjethists, const bool b_ak4hists):
-  Hists(ctx, dirname), m_dirname(dirname) {
-
-  hists_vector.push_back(new LuminosityHists(ctx, dirname + "_Lumi"));
-  hists_vector.push_back(new ltt::CommonHists(ctx, dirname + "_Common"));
+  Hists(ctx, dirname),
+  m_dirname(dirname),
+  m_enabled(matches_any(dirname, split_list(ctx.get("AndHists_stages", "")))),
+  m_allowed_groups(split_list(ctx.get("AndHists_groups", ""))),
+  fHandle_PrimaryLepton(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton))
+{
+  add_group("Lumi", [&ctx, dirname](){ return new LuminosityHists(ctx, dirname + "_Lumi"); }, false);
+  add_group("Common", [&ctx, dirname](){ return new ltt::CommonHists(ctx, dirname + "_Common"); }, true);
   if(b_topjethists) {
-    hists_vector.push_back(new ltt::AK8Hists(ctx, dirname + "_AK8", kCollectionName_AK8_rec, kCollectionName_AK8_gen));
-    hists_vector.push_back(new ltt::HOTVRHists(ctx, dirname + "_HOTVR"));
+    fHandle_AK8jets = ctx.get_handle<vector<TopJet>>(kCollectionName_AK8_rec);
+    fHandle_HOTVRjets = ctx.get_handle<vector<TopJet>>("topjets");
+    add_group("AK8", [&ctx, dirname](){ return new ltt::AK8Hists(ctx, dirname + "_AK8", kCollectionName_AK8_rec, kCollectionName_AK8_gen); }, true);
+    add_group("HOTVR", [&ctx, dirname](){ return new ltt::HOTVRHists(ctx, dirname + "_HOTVR"); }, true);
   }
   if(b_ak4hists) {
-    hists_vector.push_back(new ltt::AK4Hists(ctx, dirname + "_AK4"));
+    add_group("AK4", [&ctx, dirname](){ return new ltt::AK4Hists(ctx, dirname + "_AK4"); }, true);
   }
 }
 
 
+//____________________________________________________________________________________________________
+void AndHists::add_group(const string & group, const function<Hists*()> & factory, const bool staged) {
+
+  if(!m_enabled || !matches_any(group, m_allowed_groups)) return;
+  if(group == "AK8") m_need_ak8jets = true;
+  else if(group == "HOTVR") m_need_hotvrjets = true;
+  m_groups.push_back(HistGroup());
+  m_groups.back().name = group;
+  m_groups.back().hists.reset(factory());
+  m_groups.back().use_quantities = staged;
+  if(staged) m_groups.back().staged = dynamic_cast<StagedHists*>(m_groups.back().hists.get());
+}
+
+
+//____________________________________________________________________________________________________
 void AndHists::fill(const Event & event) {
 
-  for(Hists *hist : hists_vector) {
-    hist->fill(event);
+  if(m_groups.empty()) return;
+
+  StageQuantities quantities;
+  quantities.weight = event.weight;
+  if(event.is_valid(fHandle_PrimaryLepton)) quantities.primlep = &event.get(fHandle_PrimaryLepton);
+  if(m_need_ak8jets) {
+    m_ak8jets = event.get(fHandle_AK8jets);
+    sort_by_pt(m_ak8jets);
+    quantities.ak8jets = &m_ak8jets;
+  }
+  if(m_need_hotvrjets) {
+    m_hotvrjets = event.get(fHandle_HOTVRjets);
+    sort_by_pt(m_hotvrjets);
+    quantities.hotvrjets = &m_hotvrjets;
+  }
+
+  for(HistGroup & group : m_groups) {
+    if(group.staged) group.staged->fill(event, quantities);
+    else group.hists->fill(event);
   }
 }
 
 
+//____________________________________________________________________________________________________
 void AndHists::add_hist(Hists *hist) {
 
-  hists_vector.push_back(hist);
+  // Already booked by the caller, so not subject to the group allowlist; only the stage allowlist applies
+  unique_ptr<Hists> owned(hist);
+  if(!m_enabled) return;
+  m_groups.push_back(HistGroup());
+  m_groups.back().hists = move(owned);
+}
+
+
+//____________________________________________________________________________________________________
+void AndHists::add_hist(const string & group, const function<Hists*()> & factory) {
+
+  add_group(group, factory, false);
 }
 
 }}
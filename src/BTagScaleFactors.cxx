@@ -0,0 +1,154 @@
+#include "UHH2/LegacyTopTagging/include/BTagScaleFactors.h"
+#include "UHH2/LegacyTopTagging/include/Utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include <TFile.h>
+#include <TH2.h>
+
+using namespace std;
+using namespace uhh2;
+using namespace ltt;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+BTagMCEfficiencyMap::BTagMCEfficiencyMap(const string & file_path) {
+  TFile file(file_path.c_str(), "READ");
+  if(file.IsZombie()) throw runtime_error("BTagMCEfficiencyMap: Cannot open "+file_path);
+  const vector<string> flavor_names = { "B", "C", "UDSG" };
+  for(unsigned int f = 0; f < flavor_names.size(); f++) {
+    const TH2 *passing = (TH2*)file.Get(("BTagMCEffFlav"+flavor_names.at(f)+"Passing").c_str());
+    const TH2 *total = (TH2*)file.Get(("BTagMCEffFlav"+flavor_names.at(f)+"Total").c_str());
+    if(passing == nullptr || total == nullptr) throw runtime_error("BTagMCEfficiencyMap: BTagMCEffFlav"+flavor_names.at(f)+"Passing/Total not found in "+file_path);
+    const int n_pt = total->GetNbinsX();
+    const int n_eta = total->GetNbinsY();
+    FlavorMap & flavor_map = fMaps.at(f);
+    for(int i = 1; i <= n_pt + 1; i++) flavor_map.pt_edges.push_back(total->GetXaxis()->GetBinLowEdge(i));
+    for(int i = 1; i <= n_eta + 1; i++) flavor_map.eta_edges.push_back(total->GetYaxis()->GetBinLowEdge(i));
+    flavor_map.abs_eta = flavor_map.eta_edges.front() >= 0;
+    flavor_map.efficiencies.resize(n_pt * n_eta);
+    for(int i_pt = 0; i_pt < n_pt; i_pt++) {
+      for(int i_eta = 0; i_eta < n_eta; i_eta++) {
+        const double n_total = total->GetBinContent(i_pt + 1, i_eta + 1);
+        flavor_map.efficiencies.at(i_pt * n_eta + i_eta) = n_total > 0 ? passing->GetBinContent(i_pt + 1, i_eta + 1) / n_total : 0.;
+      }
+    }
+  }
+}
+
+double BTagMCEfficiencyMap::efficiency(const Flavor flavor, const double pt, const double eta) const {
+  // Values outside the histogram range are taken from the first/last bin
+  const auto find_bin = [](const vector<double> & edges, const double x) -> int {
+    const int bin = upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+    return max(0, min(bin, (int)edges.size() - 2));
+  };
+  const FlavorMap & flavor_map = fMaps.at(flavor);
+  const int i_pt = find_bin(flavor_map.pt_edges, pt);
+  const int i_eta = find_bin(flavor_map.eta_edges, flavor_map.abs_eta ? fabs(eta) : eta);
+  return flavor_map.efficiencies.at(i_pt * (flavor_map.eta_edges.size() - 1) + i_eta);
+}
+
+BTagMCEfficiencyMap::Flavor BTagMCEfficiencyMap::flavor(const Jet & jet) {
+  const int hadron_flavor = abs(jet.hadronFlavor());
+  if(hadron_flavor == 5) return Flavor::b;
+  else if(hadron_flavor == 4) return Flavor::c;
+  else return Flavor::udsg;
+}
+
+//____________________________________________________________________________________________________
+BTagFixedWPScaleFactors::BTagFixedWPScaleFactors(Context & ctx, const BTag::algo & algo, const BTag::wp & wp, const string & handle_name_jets, const string & measType_bc, const string & measType_udsg, const string & xml_key_of_eff_file, const string & weight_postfix):
+  fIsMC(ctx.get("dataset_type") == "MC"),
+  fBTagID(CachedBTag(ctx, algo, wp, handle_name_jets)),
+  fHandle_jets(ctx.get_handle<vector<Jet>>(handle_name_jets)),
+  fHandle_weights(ctx.declare_event_output<vector<float>>("weight_btag_fixedwp"+weight_postfix))
+{
+  fWeights.resize(kBTagSFVariations.size(), 1.);
+  const string syst_direction = ctx.get("SystDirection_BTaggingFixedWP", "nominal");
+  bool found_variation = syst_direction == "nominal";
+  fLedgerSlot.name = "btag"+weight_postfix;
+  for(unsigned int i = 0; i < kBTagSFVariations.size(); i++) {
+    const BTagSFVariationInfo & info = kBTagSFVariations.at(i);
+    if(info.affects_bc) fVariations_bc.push_back(i);
+    if(info.affects_light) fVariations_light.push_back(i);
+    if(info.name == syst_direction) {
+      fAppliedVariation = i;
+      found_variation = true;
+    }
+    const string handle_name = "weight_btag_"+info.name+weight_postfix;
+    fHandles_weight.push_back(ctx.declare_event_output<float>(handle_name));
+    fLedgerSlot.variations.push_back(info.name);
+    fLedgerSlot.handle_names.push_back(handle_name);
+  }
+  if(!found_variation) throw invalid_argument("BTagFixedWPScaleFactors: Unknown SystDirection_BTaggingFixedWP '"+syst_direction+"'");
+  fLedgerSlot.applied = fAppliedVariation;
+  if(!fIsMC) return;
+
+  fEfficiencies.reset(new BTagMCEfficiencyMap(ctx.get(xml_key_of_eff_file)));
+
+  string tagger_name;
+  string file_name;
+  if(algo == BTag::DEEPJET) {
+    tagger_name = "DeepJet";
+    file_name = "wp_deepJet_v1.csv";
+  }
+  else if(algo == BTag::DEEPCSV) {
+    tagger_name = "DeepCSV";
+    file_name = "wp_deepCSV_v1.csv";
+  }
+  else throw invalid_argument("BTagFixedWPScaleFactors: Only DeepJet and DeepCSV are supported");
+  BTagEntry::OperatingPoint op;
+  if(wp == BTag::WP_LOOSE) op = BTagEntry::OP_LOOSE;
+  else if(wp == BTag::WP_MEDIUM) op = BTagEntry::OP_MEDIUM;
+  else if(wp == BTag::WP_TIGHT) op = BTagEntry::OP_TIGHT;
+  else throw invalid_argument("BTagFixedWPScaleFactors: Invalid working point");
+
+  const string file_path = (string)getenv("CMSSW_BASE")+"/src/UHH2/"+kBasePathToULBTagSFs+kYears.at(extract_year(ctx)).name+"/"+file_name;
+  set<string> other_sys_types;
+  for(const BTagSFVariationInfo & info : kBTagSFVariations) {
+    if(info.sysType != "central") other_sys_types.insert(info.sysType);
+  }
+  const BTagCalibration calibration(tagger_name, file_path);
+  fReader.reset(new BTagCalibrationReader(op, "central", vector<string>(other_sys_types.begin(), other_sys_types.end())));
+  fReader->load(calibration, BTagEntry::FLAV_B, measType_bc);
+  fReader->load(calibration, BTagEntry::FLAV_C, measType_bc);
+  fReader->load(calibration, BTagEntry::FLAV_UDSG, measType_udsg);
+}
+
+bool BTagFixedWPScaleFactors::process(Event & event) {
+  fill(fWeights.begin(), fWeights.end(), 1.);
+  if(fIsMC) {
+    for(const Jet & jet : event.get(fHandle_jets)) {
+      const BTagMCEfficiencyMap::Flavor flavor = BTagMCEfficiencyMap::flavor(jet);
+      const BTagEntry::JetFlavor calib_flavor = flavor == BTagMCEfficiencyMap::b ? BTagEntry::FLAV_B : (flavor == BTagMCEfficiencyMap::c ? BTagEntry::FLAV_C : BTagEntry::FLAV_UDSG);
+      const double eff = fEfficiencies->efficiency(flavor, jet.pt(), jet.eta());
+      const bool tagged = fBTagID(jet, event);
+      // Ratio of data and MC probabilities for this jet to be (un)tagged
+      const auto factor = [&](const string & sys_type) -> double {
+        const double sf = fReader->eval_auto_bounds(sys_type, calib_flavor, jet.eta(), jet.pt());
+        if(tagged) return sf;
+        else if(eff < 1.) return (1. - sf * eff) / (1. - eff);
+        else return 1.;
+      };
+      const double central = factor("central");
+      const vector<unsigned int> & own_variations = flavor == BTagMCEfficiencyMap::udsg ? fVariations_light : fVariations_bc;
+      unsigned int next_own = 0;
+      for(unsigned int i = 0; i < fWeights.size(); i++) {
+        if(next_own < own_variations.size() && own_variations.at(next_own) == i) {
+          fWeights.at(i) *= factor(kBTagSFVariations.at(i).sysType);
+          next_own++;
+        }
+        else fWeights.at(i) *= central;
+      }
+    }
+    event.weight *= fWeights.at(fAppliedVariation);
+  }
+  for(unsigned int i = 0; i < fWeights.size(); i++) event.set(fHandles_weight.at(i), fWeights.at(i));
+  event.set(fHandle_weights, vector<float>(fWeights.begin(), fWeights.end()));
+  return true;
+}
+
+}}
@@ -14,7 +14,7 @@ using namespace ltt;
 namespace uhh2 { namespace ltt {
 
 CommonHists::CommonHists(Context & ctx, const string & dirname, const unsigned int default_nbins):
-  Hists(ctx, dirname),
+  StagedHists(ctx, dirname),
   h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
   h_pu_weight_up(ctx.get_handle<float>("weight_pu_up")),
   h_pu_weight_down(ctx.get_handle<float>("weight_pu_down")),
@@ -64,7 +64,16 @@ CommonHists::CommonHists(Context & ctx, const string & dirname, const unsigned i
 
 void CommonHists::fill(const Event & event) {
 
-  const double w = event.weight;
+  StageQuantities quantities;
+  quantities.weight = event.weight;
+  if(event.is_valid(h_primlep)) quantities.primlep = &event.get(h_primlep);
+  fill(event, quantities);
+}
+
+
+void CommonHists::fill(const Event & event, const StageQuantities & quantities) {
+
+  const double w = quantities.weight;
 
   hist_count->Fill(0.5, w);
   if(w > 0) hist_weights_log10->Fill(log10(w), 1);
@@ -88,16 +97,17 @@ void CommonHists::fill(const Event & event) {
     hist_electrons_pt->Fill(elec.v4().pt(), w);
   }
 
-  if(event.is_valid(h_primlep)) {
-    const FlavorParticle & primlep = event.get(h_primlep);
+  if(quantities.primlep) {
+    const FlavorParticle & primlep = *quantities.primlep;
     hist_primlep_pt->Fill(primlep.v4().Pt(), w);
     hist_ptw->Fill((event.met->v4() + primlep.v4()).Pt(), w);
     hist_mtw->Fill(mTW(primlep, *event.met), w);
     hist_primlep_eta->Fill(primlep.v4().Eta(), w);
     hist_primlep_phi->Fill(primlep.v4().Phi(), w);
     if(event.jets->size() > 0) {
-      double drjet = deltaR(primlep.v4(), nextJet(primlep, *event.jets)->v4());
-      double ptrel = pTrel(primlep, nextJet(primlep, *event.jets));
+      const Jet *nextjet = nextJet(primlep, *event.jets);
+      double drjet = deltaR(primlep.v4(), nextjet->v4());
+      double ptrel = pTrel(primlep, nextjet);
       hist_primlep_drjet->Fill(drjet, w);
       hist_primlep_ptrel->Fill(ptrel, w);
       hist_twodselection->Fill(drjet, ptrel, w);
@@ -112,7 +122,7 @@ void CommonHists::fill(const Event & event) {
     hist_ak4jets_eta->Fill(jet.v4().Eta(), w);
     hist_ak4jets_phi->Fill(jet.v4().Phi(), w);
     hist_ak4jets_mass->Fill(jet.v4().M(), w);
-    if(event.is_valid(h_primlep)) hist_ak4jets_drlepton->Fill(deltaR(jet.v4(), event.get(h_primlep).v4()), w);
+    if(quantities.primlep) hist_ak4jets_drlepton->Fill(deltaR(jet.v4(), quantities.primlep->v4()), w);
     hist_ak4jets_deepCSV->Fill(jet.btag_DeepCSV(), w);
     hist_ak4jets_deepJet->Fill(jet.btag_DeepJet(), w);
   }
@@ -0,0 +1,204 @@
+#include "UHH2/LegacyTopTagging/include/GoodLumiIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+namespace uhh2 { namespace ltt {
+
+namespace {
+const char kMagic[8] = { 'L', 'T', 'T', 'G', 'L', 'I', '0', '2' }; // last two characters: format version
+}
+
+//____________________________________________________________________________________________________
+GoodLumiIndex::GoodLumiIndex(const Ranges & ranges) {
+
+  uint64_t n_bits(0);
+  for(const auto & run_ranges : ranges) {
+    if(run_ranges.second.empty()) continue;
+    uint32_t first = run_ranges.second.front().first;
+    uint32_t last = run_ranges.second.front().second;
+    for(const auto & range : run_ranges.second) {
+      if(range.first > range.second) throw invalid_argument("GoodLumiIndex: invalid lumi range in run "+to_string(run_ranges.first));
+      first = min(first, range.first);
+      last = max(last, range.second);
+    }
+    RunEntry entry;
+    entry.run = run_ranges.first;
+    entry.first_lumi = first;
+    entry.n_lumis = last - first + 1;
+    vector<bool> good(entry.n_lumis, false);
+    for(const auto & range : run_ranges.second) {
+      fill(good.begin() + (range.first - first), good.begin() + (range.second - first) + 1, true);
+    }
+    entry.all_good = all_of(good.begin(), good.end(), [](const bool g){ return g; });
+    entry.bit_offset = entry.all_good ? 0 : n_bits;
+    if(!entry.all_good) {
+      fBits.resize((n_bits + entry.n_lumis + 63) / 64, 0);
+      for(uint32_t l = 0; l < entry.n_lumis; l++) {
+        if(good.at(l)) fBits[(n_bits + l) >> 6] |= uint64_t(1) << ((n_bits + l) & 63);
+      }
+      n_bits += entry.n_lumis;
+    }
+    fRuns.push_back(entry);
+  }
+  build_run_table();
+}
+
+void GoodLumiIndex::build_run_table() {
+
+  fRunTable.clear();
+  if(fRuns.empty()) return;
+  fMinRun = fRuns.front().run;
+  fRunTable.assign(fRuns.back().run - fMinRun + 1, -1);
+  for(unsigned int i = 0; i < fRuns.size(); i++) fRunTable.at(fRuns.at(i).run - fMinRun) = i;
+}
+
+//____________________________________________________________________________________________________
+// Golden JSON format: {"273150": [[61, 64], [66, 75]], "273158": [[1, 1279]], ...}
+GoodLumiIndex GoodLumiIndex::from_json(const string & json) {
+
+  size_t pos(0);
+  const auto fail = [&pos](const string & what) {
+    throw invalid_argument("GoodLumiIndex::from_json(): expected "+what+" at position "+to_string(pos));
+  };
+  const auto skip = [&json, &pos]() {
+    while(pos < json.size() && isspace(json[pos])) ++pos;
+  };
+  const auto expect = [&](const char c) {
+    skip();
+    if(pos >= json.size() || json[pos] != c) fail(string("'")+c+"'");
+    ++pos;
+  };
+  const auto peek = [&](const char c) {
+    skip();
+    return pos < json.size() && json[pos] == c;
+  };
+  const auto number = [&]() {
+    skip();
+    const size_t begin = pos;
+    while(pos < json.size() && isdigit(json[pos])) ++pos;
+    if(pos == begin) fail("number");
+    return (uint32_t)stoul(json.substr(begin, pos - begin));
+  };
+
+  Ranges ranges;
+  expect('{');
+  while(!peek('}')) {
+    if(!ranges.empty()) expect(',');
+    expect('"');
+    const uint32_t run = number();
+    expect('"');
+    expect(':');
+    expect('[');
+    auto & run_ranges = ranges[run];
+    while(!peek(']')) {
+      if(!run_ranges.empty()) expect(',');
+      expect('[');
+      const uint32_t first = number();
+      expect(',');
+      const uint32_t last = number();
+      expect(']');
+      run_ranges.push_back({first, last});
+    }
+    expect(']');
+  }
+  expect('}');
+  return GoodLumiIndex(ranges);
+}
+
+GoodLumiIndex GoodLumiIndex::from_pairs(const vector<pair<uint32_t, uint32_t>> & run_lumis) {
+
+  Ranges ranges;
+  for(const auto & run_lumi : run_lumis) ranges[run_lumi.first].push_back({run_lumi.second, run_lumi.second});
+  return GoodLumiIndex(ranges);
+}
+
+//____________________________________________________________________________________________________
+GoodLumiIndex GoodLumiIndex::load(const string & file_path) {
+
+  ifstream file(file_path, ios::binary);
+  if(!file) throw runtime_error("GoodLumiIndex::load(): cannot open '"+file_path+"'");
+  char magic[sizeof(kMagic)];
+  uint64_t n_runs(0), n_words(0);
+  file.read(magic, sizeof(magic));
+  if(!file || !equal(magic, magic + sizeof(magic) - 2, kMagic)) throw runtime_error("GoodLumiIndex::load(): '"+file_path+"' is not a good-lumi index file");
+  if(!equal(magic, magic + sizeof(magic), kMagic)) throw runtime_error("GoodLumiIndex::load(): '"+file_path+"' has an outdated format, delete it to rebuild it");
+  GoodLumiIndex index;
+  uint64_t path_length(0);
+  file.read((char*)&path_length, sizeof(path_length));
+  if(!file || path_length > 4096) throw runtime_error("GoodLumiIndex::load(): '"+file_path+"' is truncated");
+  index.fSource.path.resize(path_length);
+  file.read(&index.fSource.path[0], path_length);
+  file.read((char*)&index.fSource.size, sizeof(index.fSource.size));
+  file.read((char*)&index.fSource.mtime, sizeof(index.fSource.mtime));
+  file.read((char*)&n_runs, sizeof(n_runs));
+  index.fRuns.resize(n_runs);
+  file.read((char*)index.fRuns.data(), n_runs * sizeof(RunEntry));
+  file.read((char*)&n_words, sizeof(n_words));
+  index.fBits.resize(n_words);
+  file.read((char*)index.fBits.data(), n_words * sizeof(uint64_t));
+  if(!file) throw runtime_error("GoodLumiIndex::load(): '"+file_path+"' is truncated");
+  index.build_run_table();
+  return index;
+}
+
+// Writes to a temporary file first and renames it, so that parallel jobs never read a partially written file
+void GoodLumiIndex::save(const string & file_path) const {
+
+  const string tmp_path = file_path+".tmp"+to_string(getpid());
+  {
+    ofstream file(tmp_path, ios::binary);
+    const uint64_t n_runs = fRuns.size();
+    const uint64_t n_words = fBits.size();
+    file.write(kMagic, sizeof(kMagic));
+    const uint64_t path_length = fSource.path.size();
+    file.write((const char*)&path_length, sizeof(path_length));
+    file.write(fSource.path.data(), path_length);
+    file.write((const char*)&fSource.size, sizeof(fSource.size));
+    file.write((const char*)&fSource.mtime, sizeof(fSource.mtime));
+    file.write((const char*)&n_runs, sizeof(n_runs));
+    file.write((const char*)fRuns.data(), n_runs * sizeof(RunEntry));
+    file.write((const char*)&n_words, sizeof(n_words));
+    file.write((const char*)fBits.data(), n_words * sizeof(uint64_t));
+    if(!file) throw runtime_error("GoodLumiIndex::save(): cannot write '"+tmp_path+"'");
+  }
+  if(rename(tmp_path.c_str(), file_path.c_str()) != 0) throw runtime_error("GoodLumiIndex::save(): cannot rename '"+tmp_path+"' to '"+file_path+"'");
+}
+
+//____________________________________________________________________________________________________
+GoodLumiIndex::Source GoodLumiIndex::source_of(const string & file_path) {
+
+  struct stat st;
+  if(stat(file_path.c_str(), &st) != 0) throw runtime_error("GoodLumiIndex::source_of(): cannot access '"+file_path+"'");
+  Source source;
+  source.path = file_path;
+  source.size = st.st_size;
+  source.mtime = st.st_mtime;
+  return source;
+}
+
+//____________________________________________________________________________________________________
+unsigned int GoodLumiIndex::n_partial_runs() const {
+
+  return count_if(fRuns.begin(), fRuns.end(), [](const RunEntry & entry){ return !entry.all_good; });
+}
+
+unsigned long long GoodLumiIndex::n_good_lumis() const {
+
+  unsigned long long result(0);
+  for(const RunEntry & entry : fRuns) {
+    if(entry.all_good) result += entry.n_lumis;
+  }
+  for(const uint64_t word : fBits) result += __builtin_popcountll(word);
+  return result;
+}
+
+}}
@@ -0,0 +1,91 @@
+#include "UHH2/LegacyTopTagging/include/GoodLumiSelection.h"
+
+#include "UHH2/core/include/Utils.h"
+#include "UHH2/common/include/LumiSelection.h"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace uhh2;
+
+
+namespace uhh2 { namespace ltt {
+
+namespace {
+
+bool ends_with(const string & s, const string & suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+GoodLumiIndex build_good_lumi_index(const string & lumi_file) {
+  if(ends_with(lumi_file, ".json") || ends_with(lumi_file, ".txt")) {
+    ifstream file(lumi_file);
+    if(!file) throw runtime_error("GoodLumiSelection: cannot open '"+lumi_file+"'");
+    stringstream json;
+    json << file.rdbuf();
+    return GoodLumiIndex::from_json(json.str());
+  }
+  // same tree as read by LumiSelection
+  unique_ptr<TFile> file(TFile::Open(lumi_file.c_str(), "READ"));
+  if(!file || file->IsZombie()) throw runtime_error("GoodLumiSelection: cannot open '"+lumi_file+"'");
+  TTree *tree = (TTree*)file->Get("AnalysisTree");
+  if(!tree) throw runtime_error("GoodLumiSelection: no tree 'AnalysisTree' in '"+lumi_file+"'");
+  int run(0), lumi(0);
+  tree->SetBranchStatus("*", 0);
+  tree->SetBranchStatus("run", 1);
+  tree->SetBranchStatus("luminosityBlock", 1);
+  tree->SetBranchAddress("run", &run);
+  tree->SetBranchAddress("luminosityBlock", &lumi);
+  vector<pair<uint32_t, uint32_t>> run_lumis;
+  run_lumis.reserve(tree->GetEntries());
+  for(Long64_t i = 0; i < tree->GetEntries(); i++) {
+    tree->GetEntry(i);
+    run_lumis.push_back({(uint32_t)run, (uint32_t)lumi});
+  }
+  return GoodLumiIndex::from_pairs(run_lumis);
+}
+
+}
+
+//____________________________________________________________________________________________________
+GoodLumiSelection::GoodLumiSelection(Context & ctx) {
+
+  const string lumi_file = ctx.get("lumi_file");
+  const string index_file = ctx.get("good_lumi_index_file", "");
+  const GoodLumiIndex::Source source = GoodLumiIndex::source_of(lumi_file);
+  bool loaded = false;
+  if(!index_file.empty() && ifstream(index_file).good()) {
+    fIndex = GoodLumiIndex::load(index_file);
+    loaded = fIndex.source() == source;
+    if(loaded) cout << "GoodLumiSelection: loaded good-lumi index from " << index_file << endl;
+    else cout << "GoodLumiSelection: good-lumi index " << index_file << " was built from " << fIndex.source().path << " (" << fIndex.source().size << " bytes, mtime " << fIndex.source().mtime << "), not from the current " << lumi_file << "; rebuilding it" << endl;
+  }
+  if(!loaded) {
+    fIndex = build_good_lumi_index(lumi_file);
+    fIndex.set_source(source);
+    cout << "GoodLumiSelection: built good-lumi index from " << lumi_file << endl;
+    if(!index_file.empty()) fIndex.save(index_file);
+  }
+  cout << "GoodLumiSelection: " << fIndex.n_good_lumis() << " good lumi sections in " << fIndex.n_runs() << " runs (" << fIndex.n_partial_runs() << " runs not fully good)" << endl;
+
+  if(string2bool(ctx.get("validate_good_lumi_index", "false"))) {
+    cout << "GoodLumiSelection: validating against LumiSelection for every event" << endl;
+    fValidation.reset(new LumiSelection(ctx));
+  }
+}
+
+bool GoodLumiSelection::passes(const Event & event) {
+
+  if(!event.isRealData) return true;
+  const bool result = fIndex.contains(event.run, event.luminosityBlock);
+  if(fValidation && fValidation->passes(event) != result) {
+    throw runtime_error("GoodLumiSelection: disagreement with LumiSelection for run "+to_string(event.run)+", lumi section "+to_string(event.luminosityBlock));
+  }
+  return result;
+}
+
+}}
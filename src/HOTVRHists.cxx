@@ -2,6 +2,7 @@
 
 #include "UHH2/LegacyTopTagging/include/HOTVRHists.h"
 #include "UHH2/LegacyTopTagging/include/Utils.h"
+#include "UHH2/LegacyTopTagging/include/HistBinning.h"
 
 #include "TH1F.h"
 #include "TH2F.h"
@@ -14,7 +15,7 @@ using namespace ltt;
 namespace uhh2 { namespace ltt {
 
 HOTVRHists::HOTVRHists(Context & ctx, const string & dirname, const string & coll_rec, const string & coll_gen, const string & handle_name_tag, const bool doResponseHists_, const unsigned int default_nbins):
-  Hists(ctx, dirname),
+  StagedHists(ctx, dirname),
   doResponseHists(doResponseHists_)
 {
 
@@ -63,12 +64,12 @@ HOTVRHists::HOTVRHists(Context & ctx, const string & dirname, const string & col
   if(doResponseHists) {
     for(unsigned int i = 0; i <= fDRbins; i++) {
       const string dr_string = (string)"dr"+to_string(i/10)+"p"+to_string(i-(i/10)*10); // e.g. i=8 will be converted to "dr0p8" and i=12 will be converted to "dr1p2"
-      hist_response_gen.push_back(book<TH1F>(((string)"response_gen_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
-      hist_response_corr.push_back(book<TH1F>(((string)"response_corr_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
-      hist_response_raw.push_back(book<TH1F>(((string)"response_raw_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
-      hist_response_eta2p5_gen.push_back(book<TH1F>(((string)"response_eta2p5_gen_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
-      hist_response_eta2p5_corr.push_back(book<TH1F>(((string)"response_eta2p5_corr_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
-      hist_response_eta2p5_raw.push_back(book<TH1F>(((string)"response_eta2p5_raw_"+dr_string).c_str(), "#it{p}_{T}^{gen} [GeV]", 2000, 0, 2000));
+      hist_response_gen.push_back(book_binned(ctx, dirname, "response_gen_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
+      hist_response_corr.push_back(book_binned(ctx, dirname, "response_corr_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
+      hist_response_raw.push_back(book_binned(ctx, dirname, "response_raw_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
+      hist_response_eta2p5_gen.push_back(book_binned(ctx, dirname, "response_eta2p5_gen_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
+      hist_response_eta2p5_corr.push_back(book_binned(ctx, dirname, "response_eta2p5_corr_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
+      hist_response_eta2p5_raw.push_back(book_binned(ctx, dirname, "response_eta2p5_raw_"+dr_string, "#it{p}_{T}^{gen} [GeV]", HistBinning(2000, 0, 2000)));
     }
   }
 }
@@ -76,16 +77,23 @@ HOTVRHists::HOTVRHists(Context & ctx, const string & dirname, const string & col
 
 void HOTVRHists::fill(const Event & event) {
 
-  const double w = event.weight;
-  FlavorParticle primlep = FlavorParticle();
-  bool valid_primlep(false);
-  if(event.is_valid(h_primlep)) {
-    primlep = event.get(h_primlep);
-    valid_primlep = true;
-  }
-
+  StageQuantities quantities;
+  quantities.weight = event.weight;
+  if(event.is_valid(h_primlep)) quantities.primlep = &event.get(h_primlep);
   vector<TopJet> hotvrjets = event.get(h_hotvrjets);
   sort_by_pt(hotvrjets);
+  quantities.hotvrjets = &hotvrjets;
+  fill(event, quantities);
+}
+
+
+void HOTVRHists::fill(const Event & event, const StageQuantities & quantities) {
+
+  const double w = quantities.weight;
+  const bool valid_primlep = quantities.primlep != nullptr;
+  const FlavorParticle primlep = valid_primlep ? *quantities.primlep : FlavorParticle();
+
+  const vector<TopJet> & hotvrjets = *quantities.hotvrjets;
 
   hist_number->Fill(hotvrjets.size(), w);
 
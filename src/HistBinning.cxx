@@ -0,0 +1,166 @@
+#include "UHH2/core/include/AnalysisModule.h"
+
+#include "UHH2/LegacyTopTagging/include/HistBinning.h"
+
+#include "TH1F.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fnmatch.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+HistBinning::HistBinning(const unsigned int nbins, const double xmin, const double xmax): fUniform(true) {
+
+  if(nbins == 0 || !(xmax > xmin)) throw invalid_argument("HistBinning: need nbins > 0 and xmax > xmin");
+  fEdges.reserve(nbins + 1);
+  for(unsigned int i = 0; i < nbins; i++) fEdges.push_back(xmin + i * (xmax - xmin) / nbins);
+  fEdges.push_back(xmax);
+}
+
+
+//____________________________________________________________________________________________________
+HistBinning::HistBinning(const vector<double> & edges): fEdges(edges) {
+
+  if(fEdges.size() < 2) throw invalid_argument("HistBinning: need at least two bin edges");
+  for(unsigned int i = 1; i < fEdges.size(); i++) {
+    if(!(fEdges.at(i) > fEdges.at(i-1))) throw invalid_argument("HistBinning: bin edges need to be strictly increasing");
+  }
+}
+
+
+//____________________________________________________________________________________________________
+bool HistBinning::is_coarsening_of(const HistBinning & finer) const {
+
+  const vector<double> & fine = finer.edge_vector();
+  unsigned int j = 0;
+  for(const double edge : fEdges) {
+    const double tolerance = 1e-6 * max(1., fabs(edge));
+    while(j < fine.size() && fine.at(j) < edge - tolerance) j++;
+    if(j == fine.size() || fabs(fine.at(j) - edge) > tolerance) return false;
+  }
+  return true;
+}
+
+
+//____________________________________________________________________________________________________
+HistBinning HistBinning::coarsened(const unsigned int factor) const {
+
+  if(factor == 0 || nbins() % factor != 0) throw invalid_argument("HistBinning::coarsened(): "+to_string(nbins())+" bins cannot be merged in groups of "+to_string(factor));
+  if(fUniform) return HistBinning(nbins() / factor, xmin(), xmax());
+  vector<double> edges;
+  for(unsigned int i = 0; i < fEdges.size(); i += factor) edges.push_back(fEdges.at(i));
+  return HistBinning(edges);
+}
+
+
+//____________________________________________________________________________________________________
+HistBinningRegistry::HistBinningRegistry(const string & filename) {
+
+  ifstream file(filename);
+  if(!file.is_open()) throw runtime_error("HistBinningRegistry: cannot open "+filename);
+
+  string line;
+  unsigned int line_number = 0;
+  while(getline(file, line)) {
+    line_number++;
+    istringstream stream(line);
+    Rule rule;
+    string type;
+    if(!(stream >> rule.pattern) || rule.pattern.front() == '#') continue;
+    const string where = filename+":"+to_string(line_number)+": ";
+    if(!(stream >> type)) throw runtime_error(where+"missing binning type");
+    double value;
+    while(stream >> value) rule.values.push_back(value);
+    if(!stream.eof()) throw runtime_error(where+"cannot parse bin specification");
+
+    const vector<double> & v = rule.values;
+    try {
+      if(type == "uniform") {
+        if(v.size() != 3) throw runtime_error(where+"'uniform' expects <nbins> <xmin> <xmax>");
+        rule.type = RuleType::uniform;
+        rule.binning = HistBinning((unsigned int)v.at(0), v.at(1), v.at(2));
+      }
+      else if(type == "edges") {
+        rule.type = RuleType::edges;
+        rule.binning = HistBinning(v);
+      }
+      else if(type == "piecewise") {
+        if(v.size() < 3 || v.size() % 2 == 0) throw runtime_error(where+"'piecewise' expects <x0> <width0> <x1> ... <xN>");
+        rule.type = RuleType::piecewise;
+        vector<double> edges = { v.at(0) };
+        for(unsigned int i = 1; i + 1 < v.size(); i += 2) {
+          const double width = v.at(i);
+          const double upper = v.at(i+1);
+          if(!(width > 0)) throw runtime_error(where+"bin widths need to be positive");
+          const unsigned int n = lround((upper - edges.back()) / width);
+          const double lower = edges.back();
+          for(unsigned int k = 1; k < n; k++) edges.push_back(lower + k * width);
+          edges.push_back(upper);
+        }
+        rule.binning = HistBinning(edges);
+      }
+      else if(type == "rebin") {
+        if(v.size() != 1 || v.at(0) < 1) throw runtime_error(where+"'rebin' expects a positive <factor>");
+        rule.type = RuleType::rebin;
+      }
+      else throw runtime_error(where+"unknown binning type '"+type+"'");
+    }
+    catch(const invalid_argument & e) {
+      throw runtime_error(where+e.what());
+    }
+    fRules.push_back(rule);
+  }
+}
+
+
+//____________________________________________________________________________________________________
+HistBinning HistBinningRegistry::get(const string & name, const HistBinning & default_binning) const {
+
+  for(const Rule & rule : fRules) {
+    if(fnmatch(rule.pattern.c_str(), name.c_str(), 0) != 0) continue;
+    if(rule.type == RuleType::rebin) return default_binning.coarsened((unsigned int)rule.values.at(0));
+    return rule.binning;
+  }
+  return default_binning;
+}
+
+
+//____________________________________________________________________________________________________
+const HistBinningRegistry & HistBinningRegistry::instance(const string & filename) {
+
+  static map<string, unique_ptr<HistBinningRegistry>> registries;
+  unique_ptr<HistBinningRegistry> & registry = registries[filename];
+  if(!registry) {
+    if(filename.empty()) registry.reset(new HistBinningRegistry());
+    else {
+      string path = filename;
+      const char *cmssw_base = getenv("CMSSW_BASE");
+      if(path.front() != '/' && cmssw_base != nullptr) path = (string)cmssw_base+"/src/UHH2/LegacyTopTagging/"+path;
+      registry.reset(new HistBinningRegistry(path));
+    }
+  }
+  return *registry;
+}
+
+
+//____________________________________________________________________________________________________
+TH1F * book_binned(uhh2::Context & ctx, const string & dirname, const string & name, const char *title, const HistBinning & default_binning) {
+
+  const HistBinning binning = HistBinningRegistry::instance(ctx.get("hist_binning_file", "")).get(dirname+"/"+name, default_binning);
+  TH1F *hist = binning.is_uniform() ? new TH1F(name.c_str(), title, binning.nbins(), binning.xmin(), binning.xmax()) : new TH1F(name.c_str(), title, binning.nbins(), binning.edges());
+  hist->SetDirectory(0);
+  ctx.put(dirname, hist);
+  return hist;
+}
+
+}}
@@ -10,6 +10,20 @@ using namespace ltt;
 
 namespace uhh2 { namespace ltt {
 
+namespace {
+
+// Handle names as used by MCElecScaleFactor / MCMuonScaleFactor
+WeightLedgerSlot lepton_sf_ledger_slot(const string & name, const string & syst_direction) {
+  WeightLedgerSlot slot;
+  slot.name = name;
+  slot.variations = { "nominal", "up", "down" };
+  slot.handle_names = { "weight_"+name, "weight_"+name+"_up", "weight_"+name+"_down" };
+  slot.applied = slot.index_of(syst_direction);
+  return slot;
+}
+
+}
+
 //____________________________________________________________________________________________________
 ElectronRecoScaleFactors::ElectronRecoScaleFactors(
   Context & ctx,
@@ -27,6 +41,7 @@ ElectronRecoScaleFactors::ElectronRecoScaleFactors(
   fHandleElectrons(ctx.get_handle<vector<Electron>>(fHandleName))
 {
   const string syst_direction = ctx.get(fSystDirectionConfigName, "nominal");
+  fLedgerSlot = lepton_sf_ledger_slot("sfelec_"+fWeightPostfix, syst_direction);
   if(fDummy) { // These handle names must match the ones from the MCElecScaleFactor class!
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfelec_"+fWeightPostfix));
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfelec_"+fWeightPostfix+"_up"));
@@ -121,6 +136,7 @@ ElectronIdScaleFactors::ElectronIdScaleFactors(
   fHandleElectrons(ctx.get_handle<vector<Electron>>(fHandleName))
 {
   const string syst_direction = ctx.get(fSystDirectionConfigName, "nominal");
+  fLedgerSlot = lepton_sf_ledger_slot("sfelec_"+fWeightPostfix, syst_direction);
   if(fDummy) { // These handle names must match the ones from the MCElecScaleFactor class!
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfelec_"+fWeightPostfix));
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfelec_"+fWeightPostfix+"_up"));
@@ -273,6 +289,7 @@ MuonIdScaleFactors::MuonIdScaleFactors(
   fHandleMuons(ctx.get_handle<vector<Muon>>(fHandleName))
 {
   const string syst_direction = ctx.get(fSystDirectionConfigName, "nominal");
+  fLedgerSlot = lepton_sf_ledger_slot("sfmu_"+fWeightPostfix, syst_direction);
   if(fDummy) { // These handle names must match the ones from the MCMuonScaleFactor class!
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix));
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix+"_up"));
@@ -401,6 +418,7 @@ MuonIsoScaleFactors::MuonIsoScaleFactors(
   fHandleMuons(ctx.get_handle<vector<Muon>>(fHandleName))
 {
   const string syst_direction = ctx.get(fSystDirectionConfigName, "nominal");
+  fLedgerSlot = lepton_sf_ledger_slot("sfmu_"+fWeightPostfix, syst_direction);
   if(fDummy) { // These handle names must match the ones from the MCMuonScaleFactor class!
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix));
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix+"_up"));
@@ -542,6 +560,7 @@ MuonTriggerScaleFactors::MuonTriggerScaleFactors(
   fHandleMuons(ctx.get_handle<vector<Muon>>(fHandleName))
 {
   const string syst_direction = ctx.get(fSystDirectionConfigName, "nominal");
+  fLedgerSlot = lepton_sf_ledger_slot("sfmu_"+fWeightPostfix, syst_direction);
   if(fDummy) { // These handle names must match the ones from the MCMuonScaleFactor class!
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix));
     fWeightHandles.push_back(ctx.declare_event_output<float>((string)"weight_sfmu_"+fWeightPostfix+"_up"));
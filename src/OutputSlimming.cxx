@@ -0,0 +1,74 @@
+#include "UHH2/LegacyTopTagging/include/OutputSlimming.h"
+
+#include "UHH2/core/include/Utils.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace uhh2;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+OutputSlimmer::OutputSlimmer(Context & ctx, const vector<OutputConsumer> & consumers) {
+
+  vector<string> written;
+  for(const string & key : kOutputCollectionKeys) {
+    if(ctx.has(key) && !ctx.get(key).empty()) written.push_back(ctx.get(key));
+  }
+  stringstream additional_branches(ctx.get("additionalBranches", ""));
+  string branch;
+  while(additional_branches >> branch) written.push_back(branch);
+
+  set<string> needed;
+  for(const OutputConsumer & consumer : consumers) needed.insert(consumer.branches.begin(), consumer.branches.end());
+
+  const bool is_mc = ctx.get("dataset_type") == "MC";
+  const string genparticles = ctx.get("GenParticleCollection", "");
+  const string datasets = ctx.get("output_genparticles_datasets", "");
+  bool keep_genparticles = !is_mc || datasets.empty();
+  stringstream genparticles_datasets(datasets);
+  string dataset;
+  while(genparticles_datasets >> dataset) {
+    if(ctx.get("dataset_version").find(dataset) == 0) keep_genparticles = true;
+  }
+
+  for(const string & name : written) {
+    const bool keep = needed.count(name) && (name != genparticles || keep_genparticles);
+    if(keep) fKeptBranches.push_back(name);
+    else {
+      ctx.undeclare_event_output(name);
+      cout << "OutputSlimmer: not writing '" << name << "'" << endl;
+    }
+  }
+}
+
+void OutputSlimmer::add_jet_slimming(Context & ctx, const string & collection, const function<void(Jet &)> & slimming) {
+
+  if(find(fKeptBranches.begin(), fKeptBranches.end(), collection) == fKeptBranches.end()) return;
+  fJetSlimmings.push_back({ctx.get_handle<vector<Jet>>(collection), slimming});
+}
+
+void OutputSlimmer::add_topjet_slimming(Context & ctx, const string & collection, const function<void(TopJet &)> & slimming) {
+
+  if(find(fKeptBranches.begin(), fKeptBranches.end(), collection) == fKeptBranches.end()) return;
+  fTopJetSlimmings.push_back({ctx.get_handle<vector<TopJet>>(collection), slimming});
+}
+
+bool OutputSlimmer::process(Event & event) {
+
+  for(const auto & s : fJetSlimmings) {
+    if(!event.is_valid(s.first)) continue;
+    for(Jet & jet : event.get(s.first)) s.second(jet);
+  }
+  for(const auto & s : fTopJetSlimmings) {
+    if(!event.is_valid(s.first)) continue;
+    for(TopJet & topjet : event.get(s.first)) s.second(topjet);
+  }
+  return true;
+}
+
+}}
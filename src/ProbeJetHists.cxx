@@ -2,6 +2,7 @@
 
 #include "UHH2/LegacyTopTagging/include/ProbeJetHists.h"
 #include "UHH2/LegacyTopTagging/include/Utils.h"
+#include "UHH2/LegacyTopTagging/include/HistBinning.h"
 
 #include "TH1F.h"
 
@@ -38,16 +39,16 @@ AK8ProbeJetHists::AK8ProbeJetHists(Context & ctx, const string & dirname, const
           const string & pass_cat_string = pass_cat.second;
           vector<TH1F*> hists;
           const string & prefix = pt_bin_string+"_"+jet_cat_string+"_"+wp_string+"_"+pass_cat_string+"_";
-          hists.push_back(book<TH1F>((prefix+"pt").c_str(), "Probe jet #it{p}_{T} [GeV]", 1000, 0, 1000));
-          hists.push_back(book<TH1F>((prefix+"drlepton").c_str(), "#Delta#it{R}(probe jet, lepton)", 1000, 0, 5));
-          hists.push_back(book<TH1F>((prefix+"eta").c_str(), "Probe jet #eta", 1000, -5.0, 5.0));
-          hists.push_back(book<TH1F>((prefix+"phi").c_str(), "Probe jet #phi [rad]", 1000, -M_PI, M_PI));
-          hists.push_back(book<TH1F>((prefix+"mass").c_str(), "Probe jet #it{m}_{jet} [GeV]", 1000, 0, 500));
-          hists.push_back(book<TH1F>((prefix+"mSD").c_str(), "Probe jet #it{m}_{SD} [GeV]", 1000, 0, 500));
-          hists.push_back(book<TH1F>((prefix+"tau32").c_str(), "Probe jet #tau_{3}/#tau_{2}", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"tau21").c_str(), "Probe jet #tau_{2}/#tau_{1}", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"maxDeepCSV").c_str(), "Max. #it{O}_{DeepCSV}^{prob(b)+prob(bb)} of probe subjets", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"nsub").c_str(), "Number of probe subjets", 11, -0.5, 10.5));
+          hists.push_back(book_binned(ctx, dirname, prefix+"pt", "Probe jet #it{p}_{T} [GeV]", HistBinning(1000, 0, 1000)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"drlepton", "#Delta#it{R}(probe jet, lepton)", HistBinning(1000, 0, 5)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"eta", "Probe jet #eta", HistBinning(1000, -5.0, 5.0)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"phi", "Probe jet #phi [rad]", HistBinning(1000, -M_PI, M_PI)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"mass", "Probe jet #it{m}_{jet} [GeV]", HistBinning(1000, 0, 500)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"mSD", "Probe jet #it{m}_{SD} [GeV]", HistBinning(1000, 0, 500)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"tau32", "Probe jet #tau_{3}/#tau_{2}", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"tau21", "Probe jet #tau_{2}/#tau_{1}", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"maxDeepCSV", "Max. #it{O}_{DeepCSV}^{prob(b)+prob(bb)} of probe subjets", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"nsub", "Number of probe subjets", HistBinning(11, -0.5, 10.5)));
           hists_map[pt_bin][jet_cat.first][wp.first][pass_cat.first] = hists;
         }
       }
@@ -155,16 +156,16 @@ HOTVRProbeJetHists::HOTVRProbeJetHists(Context & ctx, const string & dirname, co
           const string & pass_cat_string = pass_cat.second;
           vector<TH1F*> hists;
           const string & prefix = pt_bin_string+"_"+jet_cat_string+"_"+wp_string+"_"+pass_cat_string+"_";
-          hists.push_back(book<TH1F>((prefix+"pt").c_str(), "Probe jet #it{p}_{T} [GeV]", 1000, 0, 1000));
-          hists.push_back(book<TH1F>((prefix+"drlepton").c_str(), "#Delta#it{R}(probe jet, lepton)", 1000, 0, 5));
-          hists.push_back(book<TH1F>((prefix+"eta").c_str(), "Probe jet #eta", 1000, -5.0, 5.0));
-          hists.push_back(book<TH1F>((prefix+"phi").c_str(), "Probe jet #phi [rad]", 1000, -M_PI, M_PI));
-          hists.push_back(book<TH1F>((prefix+"mass").c_str(), "Probe jet #it{m}_{jet} [GeV]", 1000, 0, 500));
-          hists.push_back(book<TH1F>((prefix+"mpair").c_str(), "Min. #it{m}_{ij} [GeV] of leading three probe subjets", 1000, 0, 250));
-          hists.push_back(book<TH1F>((prefix+"tau32").c_str(), "Probe jet #tau_{3}/#tau_{2}", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"tau21").c_str(), "Probe jet #tau_{2}/#tau_{1}", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"fpt1").c_str(), "#it{p}_{T} fraction of leading probe subjet", 1000, 0, 1));
-          hists.push_back(book<TH1F>((prefix+"nsub").c_str(), "Number of probe subjets", 11, -0.5, 10.5));
+          hists.push_back(book_binned(ctx, dirname, prefix+"pt", "Probe jet #it{p}_{T} [GeV]", HistBinning(1000, 0, 1000)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"drlepton", "#Delta#it{R}(probe jet, lepton)", HistBinning(1000, 0, 5)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"eta", "Probe jet #eta", HistBinning(1000, -5.0, 5.0)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"phi", "Probe jet #phi [rad]", HistBinning(1000, -M_PI, M_PI)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"mass", "Probe jet #it{m}_{jet} [GeV]", HistBinning(1000, 0, 500)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"mpair", "Min. #it{m}_{ij} [GeV] of leading three probe subjets", HistBinning(1000, 0, 250)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"tau32", "Probe jet #tau_{3}/#tau_{2}", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"tau21", "Probe jet #tau_{2}/#tau_{1}", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"fpt1", "#it{p}_{T} fraction of leading probe subjet", HistBinning(1000, 0, 1)));
+          hists.push_back(book_binned(ctx, dirname, prefix+"nsub", "Number of probe subjets", HistBinning(11, -0.5, 10.5)));
           hists_map[pt_bin][jet_cat.first][wp.first][pass_cat.first] = hists;
         }
       }
@@ -4,6 +4,14 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "UHH2/LegacyTopTagging/include/RoccoR.h"
 
 const double CrystalBall::pi = 3.14159;
@@ -334,4 +342,215 @@ double RoccoR::kScaleAndSmearMCerror(int Q, double pt, double eta, double phi, i
     return error([this, Q, pt, eta, phi, n, u, w](int s, int m) {return kScaleAndSmearMC(Q, pt, eta, phi, n, u, w, s, m);});
 }
 
+//____________________________________________________________________________________________________
+// Binary cache (not part of the original RoccoR code)
+
+namespace {
+
+    const char CACHE_MAGIC[8] = {'R','o','c','c','o','R','B','C'};
+
+    struct CacheHeader{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t source_size;
+	uint64_t source_hash;
+	uint64_t payload_size;
+	uint64_t payload_hash;
+    };
+
+    // FNV-1a, 64 bit
+    uint64_t fnv1a(const char* data, size_t size){
+	uint64_t h = 14695981039346656037ULL;
+	for(size_t i=0; i<size; ++i){
+	    h ^= (unsigned char)data[i];
+	    h *= 1099511628211ULL;
+	}
+	return h;
+    }
+
+    bool hashTextFile(const std::string& filename, uint64_t& size, uint64_t& hash){
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if(in.fail()) return false;
+	std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	size = content.size();
+	hash = fnv1a(content.data(), content.size());
+	return true;
+    }
+
+    struct CacheWriter{
+	std::string buf;
+	template <typename T> void put(T x){ buf.append(reinterpret_cast<const char*>(&x), sizeof(T)); }
+	template <typename T> void putVec(const std::vector<T>& v){
+	    put<uint64_t>(v.size());
+	    buf.append(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+	}
+    };
+
+    struct CacheReader{
+	const char* p;
+	const char* end;
+	bool ok;
+	CacheReader(const char* begin, size_t size):p(begin),end(begin+size),ok(true){}
+	template <typename T> T get(){
+	    T x = T();
+	    if(!ok || (size_t)(end-p) < sizeof(T)) { ok=false; return x; }
+	    std::memcpy(&x, p, sizeof(T));
+	    p += sizeof(T);
+	    return x;
+	}
+	template <typename T> void getVec(std::vector<T>& v){
+	    uint64_t n = get<uint64_t>();
+	    if(!ok || (size_t)(end-p)/sizeof(T) < n) { ok=false; return; }
+	    v.resize(n);
+	    std::memcpy(v.data(), p, n*sizeof(T));
+	    p += n*sizeof(T);
+	}
+    };
+
+}
+
+const unsigned int RoccoR::CACHE_VERSION = 1;
+
+// RoccoR2017UL.txt -> RoccoR2017UL.bin
+std::string RoccoR::cacheName(std::string filename){
+    const size_t pos = filename.rfind(".txt");
+    if(pos != std::string::npos && pos == filename.size()-4) filename.resize(pos);
+    return filename + ".bin";
+}
+
+void RoccoR::writeCache(std::string cachename, std::string filename) const{
+    if(empty()) throw std::runtime_error("RoccoR::writeCache called on empty RoccoR object");
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.reserved = 0;
+    if(!hashTextFile(filename, header.source_size, header.source_hash)) throw std::invalid_argument("RoccoR::writeCache could not open file " + filename);
+
+    CacheWriter w;
+    w.put<int32_t>(NETA);
+    w.put<int32_t>(NPHI);
+    w.put<double>(DPHI);
+    w.putVec(etabin);
+    w.put<int32_t>(nset);
+    w.putVec(nmem);
+    w.putVec(tvar);
+    for(const auto &rcs: RC){
+	for(const auto &rcm: rcs){
+	    const RocRes &rr = rcm.RR;
+	    w.put<int32_t>(rr.NETA);
+	    w.put<int32_t>(rr.NTRK);
+	    w.put<int32_t>(rr.NMIN);
+	    w.put<uint64_t>(rr.resol.size());
+	    for(const auto &r: rr.resol){
+		w.put<double>(r.eta);
+		for(auto i:{0,1}) w.put<double>(r.kRes[i]);
+		for(auto i:{0,1}) w.putVec(r.nTrk[i]);
+		for(auto i:{0,1,2}) w.putVec(r.rsPar[i]);
+		w.put<uint64_t>(r.cb.size());
+		for(const auto &cb: r.cb){
+		    w.put<double>(cb.m);
+		    w.put<double>(cb.s);
+		    w.put<double>(cb.a);
+		    w.put<double>(cb.n);
+		}
+	    }
+	    for(TYPE T:{MC,DT}){
+		w.put<uint64_t>(rcm.CP[T].size());
+		for(const auto &cpeta: rcm.CP[T]) w.putVec(cpeta);
+	    }
+	}
+    }
+    header.payload_size = w.buf.size();
+    header.payload_hash = fnv1a(w.buf.data(), w.buf.size());
+
+    // write to a temporary file first so that concurrent readers never see a half-written cache
+    const std::string tmpname = cachename + ".tmp";
+    std::ofstream out(tmpname.c_str(), std::ios::binary | std::ios::trunc);
+    if(out.fail()) throw std::invalid_argument("RoccoR::writeCache could not open file " + tmpname);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(w.buf.data(), w.buf.size());
+    out.close();
+    if(out.fail() || std::rename(tmpname.c_str(), cachename.c_str()) != 0) throw std::runtime_error("RoccoR::writeCache could not write file " + cachename);
+}
+
+bool RoccoR::initFromCache(std::string cachename, std::string filename){
+    reset();
+
+    const int fd = open(cachename.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) { close(fd); return false; }
+    const size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return false;
+    const char *data = static_cast<const char*>(map);
+
+    bool ok = true;
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    uint64_t source_size(0), source_hash(0);
+    if(std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ok = false;
+    else if(header.version != CACHE_VERSION) ok = false;
+    else if(header.payload_size != size - sizeof(header)) ok = false;
+    else if(!hashTextFile(filename, source_size, source_hash)) ok = false;
+    else if(header.source_size != source_size || header.source_hash != source_hash) ok = false; // stale
+    else if(header.payload_hash != fnv1a(data + sizeof(header), header.payload_size)) ok = false; // corrupt
+
+    if(ok){
+	CacheReader r(data + sizeof(header), header.payload_size);
+	NETA = r.get<int32_t>();
+	NPHI = r.get<int32_t>();
+	DPHI = r.get<double>();
+	r.getVec(etabin);
+	nset = r.get<int32_t>();
+	r.getVec(nmem);
+	r.getVec(tvar);
+	ok = r.ok && nset >= 0 && (int)nmem.size() == nset && (int)tvar.size() == nset;
+	if(ok) RC.resize(nset);
+	for(int s=0; ok && s<nset; ++s){
+	    RC[s].resize(nmem[s]);
+	    for(auto &rcm: RC[s]){
+		RocRes &rr = rcm.RR;
+		rr.NETA = r.get<int32_t>();
+		rr.NTRK = r.get<int32_t>();
+		rr.NMIN = r.get<int32_t>();
+		const uint64_t nres = r.get<uint64_t>();
+		if(!r.ok || nres != (uint64_t)rr.NETA) { ok = false; break; }
+		rr.resol.resize(nres);
+		for(auto &res: rr.resol){
+		    res.eta = r.get<double>();
+		    for(auto i:{0,1}) res.kRes[i] = r.get<double>();
+		    for(auto i:{0,1}) r.getVec(res.nTrk[i]);
+		    for(auto i:{0,1,2}) r.getVec(res.rsPar[i]);
+		    const uint64_t ncb = r.get<uint64_t>();
+		    if(!r.ok || ncb != (uint64_t)rr.NTRK) { ok = false; break; }
+		    res.cb.resize(ncb);
+		    for(auto &cb: res.cb){
+			cb.m = r.get<double>();
+			cb.s = r.get<double>();
+			cb.a = r.get<double>();
+			cb.n = r.get<double>();
+			cb.init();
+		    }
+		}
+		for(TYPE T:{MC,DT}){
+		    const uint64_t ncp = r.get<uint64_t>();
+		    if(!r.ok || ncp != (uint64_t)NETA) { ok = false; break; }
+		    rcm.CP[T].resize(ncp);
+		    for(auto &cpeta: rcm.CP[T]) r.getVec(cpeta);
+		}
+		ok = ok && r.ok;
+		if(!ok) break;
+	    }
+	}
+	ok = ok && r.ok && r.p == r.end;
+    }
+
+    munmap(map, size);
+    if(!ok) reset();
+    return ok;
+}
+
 #endif
@@ -1,7 +1,5 @@
 #include "UHH2/LegacyTopTagging/include/RochesterCorrections.h"
 
-#include "TRandom3.h"
-
 using namespace std;
 using namespace uhh2;
 using namespace ltt;
@@ -10,7 +8,8 @@ using namespace ltt;
 namespace uhh2 { namespace ltt {
 
 RochesterCorrections::RochesterCorrections(Context & ctx):
-  fYear(extract_year(ctx))
+  fYear(extract_year(ctx)),
+  fHandle_variations(ctx.declare_event_output<vector<float>>("rochester_variations"))
 {
   cout << "Hello World from RochesterCorrections!" << endl;
 
@@ -45,11 +44,21 @@ RochesterCorrections::RochesterCorrections(Context & ctx):
     break;
   }
   rc.reset(new RoccoR());
-  rc->init(filename);
+  const string cachename = RoccoR::cacheName(filename);
+  if(rc->initFromCache(cachename, filename)) {
+    cout << "RochesterCorrections: Loaded parameters from binary cache " << cachename << endl;
+  }
+  else {
+    cout << "RochesterCorrections: Binary cache " << cachename << " missing or stale, parsing text file instead" << endl;
+    rc->init(filename);
+  }
 
-  cout << "Caveat: Systematic variations not implemented yet" << endl;
-  variation_set = 0;
-  variation_member = 0;
+  for(int s = 1; s < rc->nSets(); s++) {
+    for(int m = 0; m < rc->nMembers(s); m++) {
+      fVariations.emplace_back(s, m);
+    }
+  }
+  cout << "RochesterCorrections: Writing " << fVariations.size() << " systematic variations per muon" << endl;
 }
 
 bool RochesterCorrections::process(Event & event) {
@@ -60,30 +69,45 @@ bool RochesterCorrections::process(Event & event) {
       if(abs(gp.pdgId()) == 13) gen_muons.push_back(gp);
     }
   }
+  vector<float> variations;
+  variations.reserve(event.muons->size() * fVariations.size());
   for(Muon & reco_muon : *event.muons) {
-    double sf(1.);
+    const int charge = (int)reco_muon.charge();
+    const double pt = reco_muon.v4().pt();
+    const double eta = reco_muon.v4().eta();
+    const double phi = reco_muon.v4().phi();
+    // Same random number / gen match for nominal and all variations (see data/rochester/README.md)
+    function<double(int, int)> get_sf;
     if(event.isRealData) {
-      sf = rc->kScaleDT((int)reco_muon.charge(), reco_muon.v4().pt(), reco_muon.v4().eta(), reco_muon.v4().phi(), variation_set, variation_member);
+      get_sf = [&](int s, int m) { return rc->kScaleDT(charge, pt, eta, phi, s, m); };
     }
     else {
       const GenParticle *closest_gen_muon = closestParticle(reco_muon, gen_muons);
       // scaling method:
       if(closest_gen_muon != nullptr && deltaR(reco_muon, *closest_gen_muon) < 0.1 && closest_gen_muon->v4().pt() > 15.) { // deltaR and pt threshold are educated guesses done by myself
-        sf = rc->kSpreadMC((int)reco_muon.charge(), reco_muon.v4().pt(), reco_muon.v4().eta(), reco_muon.v4().phi(), closest_gen_muon->v4().pt(), variation_set, variation_member);
+        const double gen_pt = closest_gen_muon->v4().pt();
+        get_sf = [&, gen_pt](int s, int m) { return rc->kSpreadMC(charge, pt, eta, phi, gen_pt, s, m); };
       }
       // stochastic method:
       else {
         // Use random number generator with eta-dependent seed for reproducibility
-        TRandom3 *random = new TRandom3((int)(fabs(reco_muon.v4().eta()*1000))); // TRandom3 is the same generator as used for gRandom
-        sf = rc->kSmearMC((int)reco_muon.charge(), reco_muon.v4().pt(), reco_muon.v4().eta(), reco_muon.v4().phi(), reco_muon.innerTrack_trackerLayersWithMeasurement(), random->Rndm(), variation_set, variation_member);
+        fRandom.SetSeed((int)(fabs(eta*1000))); // TRandom3 is the same generator as used for gRandom
+        const double u = fRandom.Rndm();
+        const int n_layers = reco_muon.innerTrack_trackerLayersWithMeasurement();
+        get_sf = [&, u, n_layers](int s, int m) { return rc->kSmearMC(charge, pt, eta, phi, n_layers, u, s, m); };
       }
     }
+    const double sf = get_sf(0, 0);
+    for(const auto & v : fVariations) {
+      variations.push_back(get_sf(v.first, v.second) / sf);
+    }
     const LorentzVector muon_v4_before = reco_muon.v4();
     const LorentzVector muon_v4_after = muon_v4_before * sf;
     reco_muon.set_v4(muon_v4_after);
     // Change of use of unused "ptRatio" member: Use it as a kind of "JEC_factor_raw"
     reco_muon.set_ptRatio(-muon_v4_before.pt() / muon_v4_after.pt());
   }
+  event.set(fHandle_variations, variations);
   return true;
 }
 
@@ -0,0 +1,152 @@
+#include "UHH2/LegacyTopTagging/include/SelectionScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace uhh2;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+CutflowHists::CutflowHists(Context & ctx, const string & dirname, const vector<string> & step_names): Hists(ctx, dirname) {
+
+  const unsigned int nbins = step_names.size() + 1;
+  h_weighted = book<TH1D>("cutflow_weighted", "Cutflow (weighted)", nbins, 0.5, nbins + 0.5);
+  h_unweighted = book<TH1D>("cutflow_unweighted", "Cutflow (unweighted)", nbins, 0.5, nbins + 0.5);
+  for(TH1D *h : { h_weighted, h_unweighted }) {
+    h->GetXaxis()->SetBinLabel(1, "input");
+    for(unsigned int i = 0; i < step_names.size(); i++) h->GetXaxis()->SetBinLabel(i + 2, step_names.at(i).c_str());
+  }
+}
+
+void CutflowHists::fill(const unsigned int bin, const double weight) {
+
+  h_weighted->Fill(bin, weight);
+  h_unweighted->Fill(bin);
+}
+
+//____________________________________________________________________________________________________
+SelectionScheduler::SelectionScheduler(const string & name, const bool adaptive, const unsigned long long warmup_events):
+  fName(name),
+  fAdaptive(adaptive),
+  fWarmupEvents(warmup_events)
+{}
+
+SelectionScheduler::~SelectionScheduler() {
+
+  if(fNEvents) cout << report();
+}
+
+void SelectionScheduler::add_step(const string & name, const vector<string> & needs, const Step & step, const bool changes_weight) {
+
+  if(fNEvents) throw logic_error("SelectionScheduler::add_step(): cannot add steps after the first event");
+  StepInfo info;
+  info.name = name;
+  info.step = step;
+  for(const string & need : needs) {
+    const auto it = find_if(fSteps.begin(), fSteps.end(), [&need](const StepInfo & s){ return s.name == need; });
+    if(it == fSteps.end()) throw invalid_argument("SelectionScheduler::add_step(): step '"+name+"' needs unknown step '"+need+"' (needs to be added before)");
+    info.needs.push_back(it - fSteps.begin());
+  }
+  if(changes_weight) {
+    if(fLastWeightStep >= 0) info.needs.push_back(fLastWeightStep);
+    fLastWeightStep = fSteps.size();
+  }
+  fOrder.push_back(fSteps.size());
+  fSteps.push_back(info);
+}
+
+void SelectionScheduler::book_cutflow(Context & ctx, const string & dirname) {
+
+  vector<string> step_names;
+  for(const StepInfo & s : fSteps) step_names.push_back(s.name);
+  fCutflow.reset(new CutflowHists(ctx, dirname, step_names));
+}
+
+bool SelectionScheduler::process(Event & event) {
+
+  if(fAdaptive && fNEvents == fWarmupEvents) reorder();
+  fLastEvent = chrono::steady_clock::now();
+  if(fNEvents == 0) fFirstEvent = fLastEvent;
+  ++fNEvents;
+  fSumwInput += event.weight;
+  if(fCutflow) fCutflow->fill(1, event.weight);
+  for(const unsigned int i : fOrder) {
+    StepInfo & s = fSteps[i];
+    const auto start = chrono::steady_clock::now();
+    const bool passed = s.step(event);
+    s.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    ++s.n_calls;
+    if(!passed) return false;
+    ++s.n_passed;
+    s.sumw_passed += event.weight;
+    if(fCutflow) fCutflow->fill(i + 2, event.weight);
+  }
+  return true;
+}
+
+//____________________________________________________________________________________________________
+// Greedy ordering by rejection rate per cost. Steps never reached during the warm-up have no measurement and keep
+// their relative position at the end
+void SelectionScheduler::reorder() {
+
+  vector<bool> done(fSteps.size(), false);
+  vector<unsigned int> order;
+  while(order.size() < fSteps.size()) {
+    int best = -1;
+    double best_rank = -1.;
+    for(unsigned int i = 0; i < fSteps.size(); i++) {
+      if(done[i]) continue;
+      if(!all_of(fSteps[i].needs.begin(), fSteps[i].needs.end(), [&done](const unsigned int n){ return done[n]; })) continue;
+      const StepInfo & s = fSteps[i];
+      const double rank = s.n_calls ? (1. - s.pass_rate()) / max(s.mean_cost(), 1e-9) : 0.;
+      if(rank > best_rank) {
+        best = i;
+        best_rank = rank;
+      }
+    }
+    done[best] = true;
+    order.push_back(best);
+  }
+  if(order != fOrder) {
+    cout << fName << ": reordered selection steps after " << fNEvents << " events:";
+    for(const unsigned int i : order) cout << " " << fSteps[i].name;
+    cout << endl;
+  }
+  fOrder = order;
+}
+
+//____________________________________________________________________________________________________
+// The number of calls each step would have had in declaration order is estimated from the measured pass rates,
+// i.e. assuming uncorrelated steps
+string SelectionScheduler::report() const {
+
+  stringstream result;
+  result << fName << ": selection steps after " << fNEvents << " events (" << (fAdaptive ? "adaptive" : "fixed") << " order)" << endl;
+  result << "  " << left << setw(20) << "step" << right << setw(12) << "calls" << setw(12) << "pass rate" << setw(14) << "cost [us]" << setw(14) << "saved [s]"
+    << setw(12) << "passed" << setw(16) << "passed (w)" << endl;
+  result << "  " << left << setw(20) << "input" << right << setw(64) << fNEvents << setw(16) << setprecision(6) << fSumwInput << endl;
+  double reach(fNEvents), total_saved(0.);
+  for(const StepInfo & s : fSteps) {
+    const double saved = (reach - s.n_calls) * s.mean_cost();
+    total_saved += saved;
+    reach *= s.pass_rate();
+    result << "  " << left << setw(20) << s.name << right << setw(12) << s.n_calls << setw(12) << fixed << setprecision(4) << s.pass_rate()
+      << setw(14) << setprecision(2) << s.mean_cost() * 1e6 << setw(14) << setprecision(3) << saved
+      << setw(12) << s.n_passed << setw(16) << defaultfloat << setprecision(6) << s.sumw_passed << endl;
+  }
+  result << "  total saved time w.r.t. declaration order: " << fixed << setprecision(3) << total_saved << " s" << endl;
+  const double wall_time = chrono::duration<double>(fLastEvent - fFirstEvent).count();
+  result << "  event loop: " << fNEvents << " events in " << setprecision(3) << wall_time << " s wall time";
+  if(wall_time > 0.) result << " (" << setprecision(1) << (fNEvents - 1) / wall_time << " events/s)";
+  result << endl;
+  return result.str();
+}
+
+}}
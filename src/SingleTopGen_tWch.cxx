@@ -2,15 +2,213 @@
 // edited by Christopher Matthies, 02/2018
 
 #include "UHH2/LegacyTopTagging/include/SingleTopGen_tWch.h"
-// #include "UHH2/core/include/Utils.h"
+#include "UHH2/core/include/Utils.h"
 
 using namespace std;
 using namespace uhh2;
 using namespace ltt;
 
+namespace {
+
+// Maps GenParticle::index() to the genparticle (first occurrence in the vector, same as GenParticle::mother()/daughter())
+// and holds for each genparticle all genparticles which list it as mother1 or mother2, in the order of the vector.
+// Built in one pass, such that all later lookups are O(1) instead of a scan over the whole vector.
+class GenParticleIndex {
+public:
+  explicit GenParticleIndex(const vector<GenParticle> & genparticles);
+  const GenParticle * get(const unsigned int index) const;
+  const vector<const GenParticle*> & daughters(const GenParticle & gp) const;
+private:
+  int position(const unsigned int index) const;
+  const vector<GenParticle> & fGenParticles;
+  vector<int> fPositions;
+  vector<vector<const GenParticle*>> fDaughters;
+  const vector<const GenParticle*> fEmpty;
+};
+
+GenParticleIndex::GenParticleIndex(const vector<GenParticle> & genparticles): fGenParticles(genparticles) {
+  unsigned int max_index(0);
+  for(const GenParticle & gp : genparticles) {
+    if(gp.index() >= 0) max_index = max(max_index, (unsigned int)gp.index()); // negative indices cannot be looked up
+  }
+  fPositions.assign(max_index+1, -1);
+  for(unsigned int i = 0; i < genparticles.size(); ++i) {
+    if(genparticles[i].index() < 0) continue;
+    int & pos = fPositions[genparticles[i].index()];
+    if(pos < 0) pos = i;
+  }
+  fDaughters.resize(genparticles.size());
+  for(const GenParticle & gp : genparticles) {
+    const int pos1 = position(gp.mother1());
+    const int pos2 = position(gp.mother2());
+    if(pos1 >= 0) fDaughters[pos1].push_back(&gp);
+    if(pos2 >= 0 && pos2 != pos1) fDaughters[pos2].push_back(&gp);
+  }
+}
+
+int GenParticleIndex::position(const unsigned int index) const {
+  return index < fPositions.size() ? fPositions[index] : -1;
+}
+
+const GenParticle * GenParticleIndex::get(const unsigned int index) const {
+  const int pos = position(index);
+  return pos < 0 ? nullptr : &fGenParticles[pos];
+}
+
+const vector<const GenParticle*> & GenParticleIndex::daughters(const GenParticle & gp) const {
+  const int pos = position(gp.index());
+  return pos < 0 ? fEmpty : fDaughters[pos];
+}
+
+bool is_b_like(const GenParticle & gp) {
+  return abs(gp.pdgId()) == 5 || abs(gp.pdgId()) == 3 || abs(gp.pdgId()) == 1;
+}
+
+}
+
+
 namespace uhh2 { namespace ltt {
 
-SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, bool throw_on_failure): m_type(e_notfound) {
+SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, bool throw_on_failure, const Decoder decoder): m_type(e_notfound) {
+
+  const bool success = decoder == Decoder::legacy ? decode_legacy(genparticles, throw_on_failure) : decode_indexed(genparticles, throw_on_failure);
+  if(success) set_decay_channel();
+}
+
+
+bool SingleTopGen_tWch::decode_indexed(const vector<GenParticle> & genparticles, bool throw_on_failure) {
+
+  const GenParticleIndex gpindex(genparticles);
+
+  int n_top = 0;
+  int n_WAss = 0;
+  int n_gluonAss = 0;
+  int n_bAss = 0;
+
+  // Same logic and same order of checks as in decode_legacy(), but every mother/daughter lookup is done by index
+  for(const GenParticle & genp : genparticles) {
+    if (genp.index() == 0){ // find the initial state particles
+      m_initial1 = genp;
+    }
+    else if (genp.index() == 1){
+      m_initial2 = genp;
+    }
+    else if (abs(genp.pdgId()) == 6){
+      const vector<const GenParticle*> & top_daughters = gpindex.daughters(genp);
+      if(top_daughters.size() > 2) m_ambiguities |= e_amb_TopExtraDaughters;
+      const GenParticle *w = gpindex.get(genp.daughter1());
+      const GenParticle *b = gpindex.get(genp.daughter2());
+      if(!w || !b) {
+        if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has not ==2 daughters");
+        return false;
+      }
+      if (abs(w->pdgId()) != 24) {
+        std::swap(w, b);
+      }
+      // see decode_legacy() for why the W and b daughters might have to be searched among all particles with the top as mother
+      if(abs(w->pdgId()) != 24) {
+        for(const GenParticle *gp : top_daughters) {
+          if(abs(gp->pdgId()) == 24) {
+            w = gp;
+            m_ambiguities |= e_amb_WTopNotFirstDaughters;
+            break;
+          }
+        }
+      }
+      if (abs(w->pdgId()) != 24) {
+        if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has no W daughter");
+        return false;
+      }
+      if(!is_b_like(*b)) {
+        for(const GenParticle *gp : top_daughters) {
+          if(is_b_like(*gp)) {
+            b = gp;
+            m_ambiguities |= e_amb_bTopNotFirstDaughters;
+            break;
+          }
+        }
+      }
+      if(!is_b_like(*b)) {
+        if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has no b daughter");
+        return false;
+      }
+
+      const GenParticle *wd1 = gpindex.get(w->daughter1());
+      const GenParticle *wd2 = gpindex.get(w->daughter2());
+      while(wd1 && !wd2) { // skip intermediate copies of the W
+        w = wd1;
+        wd1 = gpindex.get(w->daughter1());
+        wd2 = gpindex.get(w->daughter2());
+        m_ambiguities |= e_amb_WTopCopies;
+      }
+      if(!wd1 || !wd2) {
+        if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WTop has no daughters");
+        return false;
+      }
+
+      m_Top = genp;
+      m_WTop = *w;
+      m_bTop = *b;
+      m_WTopDecay1 = *wd1;
+      m_WTopDecay2 = *wd2;
+      ++n_top;
+    }
+    else if (abs(genp.pdgId()) == 24){
+      const GenParticle *m1 = gpindex.get(genp.mother1());
+      const GenParticle *m2 = gpindex.get(genp.mother2());
+      if (!(m1 && m2 && m1->index() + m2->index() == 1)) { // not the associated W
+        continue;
+      }
+
+      const GenParticle *WAss = &genp;
+      const GenParticle *wassd1 = gpindex.get(WAss->daughter1());
+      const GenParticle *wassd2 = gpindex.get(WAss->daughter2());
+      while(wassd1 && !wassd2) { // skip intermediate copies of the W
+        WAss = wassd1;
+        wassd1 = gpindex.get(WAss->daughter1());
+        wassd2 = gpindex.get(WAss->daughter2());
+        m_ambiguities |= e_amb_WAssCopies;
+      }
+      if(!wassd1 || !wassd2) {
+        if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WAss has no daughters");
+        return false;
+      }
+
+      m_WAss = *WAss;
+      m_WAssDecay1 = *wassd1;
+      m_WAssDecay2 = *wassd2;
+      ++n_WAss;
+    }
+    else if (genp.pdgId() == 21 && genp.index() > 1){
+      m_gluonAss = genp;
+      if(++n_gluonAss > 1) m_ambiguities |= e_amb_MultipleGluonsAss;
+    }
+    else if (abs(genp.pdgId()) == 5) {
+      const GenParticle *m1 = gpindex.get(genp.mother1());
+      const GenParticle *m2 = gpindex.get(genp.mother2());
+      if(m1 && m2 && m1->index() < 2 && m2->index() < 2) {
+        m_bAss = genp;
+        m_has_bAss = true;
+        if(++n_bAss > 1) m_ambiguities |= e_amb_MultipleBottomsAss;
+      }
+    }
+  }
+
+  if(n_top != 1){
+    if(throw_on_failure)  throw runtime_error("SingleTopGen_tWch: did not find exactly one (anti)top in the event");
+    return false;
+  }
+
+  if(n_WAss != 1){
+    if(throw_on_failure)  throw runtime_error("SingleTopGen_tWch: did not find exactly one associated (!) W in the event");
+    return false;
+  }
+
+  return true;
+}
+
+
+bool SingleTopGen_tWch::decode_legacy(const vector<GenParticle> & genparticles, bool throw_on_failure) {
 
   int n_top = 0;
   int n_WAss = 0;
@@ -32,7 +230,7 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
       auto b = genp.daughter(&genparticles, 2);
       if(!w || !b) {
         if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has not ==2 daughters");
-        return;
+        return false;
       }
       if (abs(w->pdgId()) != 24) {
         std::swap(w, b);
@@ -56,7 +254,7 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
       }
       if (abs(w->pdgId()) != 24) {
         if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has no W daughter");
-        return;
+        return false;
       }
 
       // NOTE: here, we could skip over intermediate W bosons. However,
@@ -78,7 +276,7 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
       }
       if (abs(b->pdgId()) != 5 && abs(b->pdgId()) != 3   && abs(b->pdgId()) != 1) {
         if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: top has no b daughter");
-        return;
+        return false;
       }
       // now get WTop daughters:
 
@@ -100,13 +298,13 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
 
         else{
           if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WTop has no daughters");
-          return;
+          return false;
         }
 
       }
       if(!wd1 || !wd2){
         if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WTop has not ==2 daughters");
-        return;
+        return false;
       }
 
       // now that we collected everything, fill the member variables.
@@ -147,14 +345,14 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
 	}
 	else{
 	  if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WAss has no daughters");
-	  return;
+	  return false;
 	}
 
       }
 
       if(!wassd1 || !wassd2){
 	if(throw_on_failure) throw runtime_error("SingleTopGen_tWch: WAss has not ==2 daughters");
-	return;
+	return false;
       }
 
       // fill member variables
@@ -183,15 +381,19 @@ SingleTopGen_tWch::SingleTopGen_tWch(const vector<GenParticle> & genparticles, b
 
   if(n_top != 1){
     if(throw_on_failure)  throw runtime_error("SingleTopGen_tWch: did not find exactly one (anti)top in the event");
-    return;
+    return false;
   }
 
   if(n_WAss != 1){
     if(throw_on_failure)  throw runtime_error("SingleTopGen_tWch: did not find exactly one associated (!) W in the event");
-    return;
+    return false;
   }
 
+  return true;
+}
+
 
+void SingleTopGen_tWch::set_decay_channel() {
 
   // calculate decay channel by counting the number of charged leptons
   // in the WTop and WAss daughters:
@@ -368,6 +570,20 @@ bool SingleTopGen_tWch::HasAssociatedGluon() const{
 
 
 
+unsigned int SingleTopGen_tWch::Ambiguities() const{
+  return m_ambiguities;
+}
+
+bool SingleTopGen_tWch::IsAmbiguous() const{
+  return m_ambiguities != 0;
+}
+
+bool SingleTopGen_tWch::IsAmbiguous(const E_Ambiguity ambiguity) const{
+  return m_ambiguities & ambiguity;
+}
+
+
+
 bool SingleTopGen_tWch::IsTopHadronicDecay() const{
   return abs(m_WTopDecay1.pdgId()) <= 5;
 }
@@ -422,13 +638,72 @@ bool SingleTopGen_tWch::IsSemiLeptonic(const bool consider_taus) const{
 }
 
 
+namespace {
+
+bool same_genparticle(const GenParticle & a, const GenParticle & b) {
+  return a.index() == b.index() && a.pdgId() == b.pdgId() && a.status() == b.status() && a.v4() == b.v4();
+}
+
+// Returns a list of all accessors which differ between the two decoders (empty if identical)
+string compare_decoders(const SingleTopGen_tWch & a, const SingleTopGen_tWch & b) {
+  string diff;
+  const vector<pair<string, GenParticle (SingleTopGen_tWch::*)() const>> particles = {
+    {"Top", &SingleTopGen_tWch::Top},
+    {"WTop", &SingleTopGen_tWch::WTop},
+    {"bTop", &SingleTopGen_tWch::bTop},
+    {"WTopDecay1", &SingleTopGen_tWch::WTopDecay1},
+    {"WTopDecay2", &SingleTopGen_tWch::WTopDecay2},
+    {"WAss", &SingleTopGen_tWch::WAss},
+    {"WAssDecay1", &SingleTopGen_tWch::WAssDecay1},
+    {"WAssDecay2", &SingleTopGen_tWch::WAssDecay2},
+    {"Initial1", &SingleTopGen_tWch::Initial1},
+    {"Initial2", &SingleTopGen_tWch::Initial2},
+    {"gluonAss", &SingleTopGen_tWch::gluonAss},
+    {"bAss", &SingleTopGen_tWch::bAss},
+  };
+  for(const auto & p : particles) {
+    if(!same_genparticle((a.*p.second)(), (b.*p.second)())) diff += " "+p.first;
+  }
+  if(a.HasAssociatedBottom() != b.HasAssociatedBottom()) diff += " HasAssociatedBottom";
+  if(a.DecayChannel() != b.DecayChannel()) diff += " DecayChannel";
+  return diff;
+}
+
+}
+
+
 SingleTopGen_tWchProducer::SingleTopGen_tWchProducer(uhh2::Context & ctx, const std::string & name, bool throw_on_failure_): throw_on_failure(throw_on_failure_){
   h_singletopgen_twch = ctx.get_handle<SingleTopGen_tWch>(name);
+  validate = string2bool(ctx.get("validate_SingleTopGen_tWch", "false"));
+  if(validate) cout << "SingleTopGen_tWchProducer: Validating indexed decoder against legacy decoder for every event" << endl;
 }
 
 bool SingleTopGen_tWchProducer::process(Event & event){
-  event.set(h_singletopgen_twch, SingleTopGen_tWch(*event.genparticles, throw_on_failure));
+  if(!validate) {
+    event.set(h_singletopgen_twch, SingleTopGen_tWch(*event.genparticles, throw_on_failure));
+    return true;
+  }
+
+  // Let both decoders run without throwing and compare; if requested, throw afterwards with the message of the indexed decoder
+  ++n_validated;
+  const SingleTopGen_tWch indexed(*event.genparticles, false, SingleTopGen_tWch::Decoder::indexed);
+  const SingleTopGen_tWch legacy(*event.genparticles, false, SingleTopGen_tWch::Decoder::legacy);
+  const string diff = compare_decoders(indexed, legacy);
+  if(!diff.empty()) {
+    ++n_mismatches;
+    cout << "SingleTopGen_tWchProducer: Decoder mismatch in run " << event.run << ", lumi block " << event.luminosityBlock << ", event " << event.event << ":" << diff << endl;
+  }
+  if(indexed.IsAmbiguous()) ++n_ambiguous;
+  if(throw_on_failure && indexed.DecayChannel() == SingleTopGen_tWch::e_notfound) {
+    SingleTopGen_tWch(*event.genparticles, true);
+  }
+  event.set(h_singletopgen_twch, indexed);
   return true;
 }
 
+SingleTopGen_tWchProducer::~SingleTopGen_tWchProducer(){
+  if(!validate) return;
+  cout << "SingleTopGen_tWchProducer: Validated " << n_validated << " events, " << n_mismatches << " mismatches between indexed and legacy decoder, " << n_ambiguous << " events with ambiguous topologies" << endl;
+}
+
 }}
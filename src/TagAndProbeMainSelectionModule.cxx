@@ -18,6 +18,7 @@
 
 #include "UHH2/LegacyTopTagging/include/AK8Hists.h"
 #include "UHH2/LegacyTopTagging/include/AndHists.h"
+#include "UHH2/LegacyTopTagging/include/BTagScaleFactors.h"
 #include "UHH2/LegacyTopTagging/include/Constants.h"
 #include "UHH2/LegacyTopTagging/include/HOTVRHists.h"
 #include "UHH2/LegacyTopTagging/include/LeptonScaleFactors.h"
@@ -26,6 +27,9 @@
 #include "UHH2/LegacyTopTagging/include/TopJetCorrections.h"
 #include "UHH2/LegacyTopTagging/include/TriggerSelection.h"
 #include "UHH2/LegacyTopTagging/include/Utils.h"
+#include "UHH2/LegacyTopTagging/include/WeightLedger.h"
+#include "UHH2/LegacyTopTagging/include/TheoryWeights.h"
+#include "UHH2/LegacyTopTagging/include/SelectionScheduler.h"
 
 
 using namespace std;
@@ -104,22 +108,24 @@ private:
   unique_ptr<Selection> slct_elec_lowpt;
   unique_ptr<Selection> slct_elec_highpt;
 
-  unique_ptr<AnalysisModule> sf_muon_id_highpt;
-  unique_ptr<AnalysisModule> sf_muon_id_lowpt;
-  unique_ptr<AnalysisModule> sf_muon_id_dummy;
-  unique_ptr<AnalysisModule> sf_elec_id_highpt;
-  unique_ptr<AnalysisModule> sf_elec_id_lowpt;
-  unique_ptr<AnalysisModule> sf_elec_id_dummy;
-  unique_ptr<AnalysisModule> sf_elec_reco;
-  unique_ptr<AnalysisModule> sf_elec_reco_dummy;
+  unique_ptr<ltt::MuonIdScaleFactors> sf_muon_id_highpt;
+  unique_ptr<ltt::MuonIdScaleFactors> sf_muon_id_lowpt;
+  unique_ptr<ltt::MuonIdScaleFactors> sf_muon_id_dummy;
+  unique_ptr<ltt::ElectronIdScaleFactors> sf_elec_id_highpt;
+  unique_ptr<ltt::ElectronIdScaleFactors> sf_elec_id_lowpt;
+  unique_ptr<ltt::ElectronIdScaleFactors> sf_elec_id_dummy;
+  unique_ptr<ltt::ElectronRecoScaleFactors> sf_elec_reco;
+  unique_ptr<ltt::ElectronRecoScaleFactors> sf_elec_reco_dummy;
 
   unique_ptr<AnalysisModule> primlep;
+  unique_ptr<AnalysisModule> lepton_context;
   unique_ptr<AnalysisModule> scale_variation;
   unique_ptr<AnalysisModule> ps_variation;
+  unique_ptr<AnalysisModule> theory_weights;
   unique_ptr<AnalysisModule> sf_lumi;
   unique_ptr<AnalysisModule> sf_pileup;
-  unique_ptr<AnalysisModule> sf_prefire;
-  unique_ptr<AnalysisModule> weight_trickery;
+  unique_ptr<ltt::PrefiringWeights> sf_prefire;
+  unique_ptr<ltt::WeightTrickery> weight_trickery;
 
   unique_ptr<ltt::JetMETCorrections> jetmet_corrections_puppi;
   unique_ptr<AnalysisModule> cleaner_ak4puppi;
@@ -148,18 +154,19 @@ private:
 
   unique_ptr<ltt::HEM2018Selection> slct_hem2018;
 
-  unique_ptr<AnalysisModule> sf_toppt;
+  unique_ptr<ltt::TopPtReweighting> sf_toppt;
 
-  unique_ptr<AnalysisModule> sf_vjets;
+  unique_ptr<ltt::VJetsReweighting> sf_vjets;
 
   unique_ptr<Selection> slct_trigger_highpt;
   unique_ptr<Selection> slct_trigger_lowpt;
 
-  unique_ptr<AnalysisModule> sf_muon_trigger_highpt;
-  unique_ptr<AnalysisModule> sf_muon_trigger_lowpt;
-  unique_ptr<AnalysisModule> sf_muon_trigger_dummy;
+  unique_ptr<ltt::MuonTriggerScaleFactors> sf_muon_trigger_highpt;
+  unique_ptr<ltt::MuonTriggerScaleFactors> sf_muon_trigger_lowpt;
+  unique_ptr<ltt::MuonTriggerScaleFactors> sf_muon_trigger_dummy;
 
-  unique_ptr<Selection> slct_twod;
+  unique_ptr<AnalysisModule> lepton_jet_proximity;
+  unique_ptr<ltt::TwoDSelection> slct_twod;
 
   unique_ptr<Selection> slct_btag;
   const map<Band, string> xml_key_of_btag_eff_file = {
@@ -168,7 +175,7 @@ private:
   };
   map<Band, bool> run_btag_sf;
   map<Band, unique_ptr<Hists>> hist_btag_eff;
-  map<Band, unique_ptr<AnalysisModule>> sf_btagging;
+  map<Band, unique_ptr<ltt::BTagFixedWPScaleFactors>> sf_btagging;
 
   unique_ptr<ltt::AndHists> hist_before2d;
   map<Band, unique_ptr<ltt::AndHists>> hist_presel;
@@ -179,11 +186,18 @@ private:
   unique_ptr<AnalysisModule> merge_scenarios_hotvr;
   unique_ptr<AnalysisModule> merge_scenarios_ak8;
   unique_ptr<AnalysisModule> main_output;
+  unique_ptr<AnalysisModule> weight_ledger;
 
   Event::Handle<float> fHandle_weight;
   Event::Handle<int> fHandle_band;
   Event::Handle<int> fHandle_year;
   Event::Handle<string> fHandle_dataset;
+
+  unique_ptr<ltt::SelectionScheduler> selection;
+  bool fLowPt = false; // state shared between the steps of the selection for the current event
+  bool fHasHOTVRJet = false;
+  bool fHasAK8Jet = false;
+  Band fBand = Band::MAIN;
 };
 
 
@@ -225,11 +239,13 @@ TagAndProbeMainSelectionModule::TagAndProbeMainSelectionModule(Context & ctx):
   sf_elec_reco_dummy.reset(new ltt::ElectronRecoScaleFactors(ctx, boost::none, boost::none, boost::none, boost::none, true));
 
   primlep.reset(new PrimaryLepton(ctx));
+  lepton_context.reset(new ltt::LeptonContextProducer(ctx, muon_highpt_pt_min, electron_highpt_pt_min));
   scale_variation.reset(new MCScaleVariation(ctx));
   // ps_variation.reset(new ltt::PartonShowerVariation(ctx));
   bool has_ps_weights = true;
   if(fDatasetVersion.find("QCD") == 0) has_ps_weights = false;
   ps_variation.reset(new PSWeights(ctx, true, !has_ps_weights));
+  theory_weights.reset(new ltt::TheoryWeightBlock(ctx, kHandleName_TheoryWeights, "")); // input is skimmed, the sums are filled in the preselection
   sf_lumi.reset(new MCLumiWeight(ctx));
   sf_pileup.reset(new MCPileupReweight(ctx, ctx.get("SystDirection_Pileup", "nominal")));
   sf_prefire.reset(new ltt::PrefiringWeights(ctx));
@@ -246,8 +262,8 @@ TagAndProbeMainSelectionModule::TagAndProbeMainSelectionModule(Context & ctx):
   jetmet_corrections_chs.reset(new ltt::JetMETCorrections(kCollectionName_AK4CHS, boost::none, puppi_met ? (boost::optional<std::string>)kCollectionName_METCHS : boost::none));
   jetmet_corrections_chs->init(ctx);
 
-  const TopJetId hotvrID = AndId<TopJet>(JetPFID(JetPFID::WP_TIGHT_PUPPI), PtEtaCut(hotvr_pt_min, hotvr_eta_max), ltt::NoLeptonInJet("all", hotvr_dr_lep_min));
-  const TopJetId ak8ID = AndId<TopJet>(JetPFID(JetPFID::WP_TIGHT_PUPPI), PtEtaCut(ak8_pt_min, ak8_eta_max), ltt::NoLeptonInJet("all", ak8_dr_lep_min));
+  const TopJetId hotvrID = AndId<TopJet>(JetPFID(JetPFID::WP_TIGHT_PUPPI), PtEtaCut(hotvr_pt_min, hotvr_eta_max), ltt::NoLeptonInJet(ctx, "all", hotvr_dr_lep_min));
+  const TopJetId ak8ID = AndId<TopJet>(JetPFID(JetPFID::WP_TIGHT_PUPPI), PtEtaCut(ak8_pt_min, ak8_eta_max), ltt::NoLeptonInJet(ctx, "all", ak8_dr_lep_min));
 
   corrections_hotvr.reset(new ltt::TopJetCorrections());
   corrections_hotvr->switch_topjet_corrections(false);
@@ -288,14 +304,15 @@ TagAndProbeMainSelectionModule::TagAndProbeMainSelectionModule(Context & ctx):
   sf_muon_trigger_lowpt.reset(new ltt::MuonTriggerScaleFactors(ctx, false, false)); // --"--
   sf_muon_trigger_dummy.reset(new ltt::MuonTriggerScaleFactors(ctx, boost::none, boost::none, boost::none, boost::none, boost::none, true));
 
+  lepton_jet_proximity.reset(new ltt::LeptonJetProximityHandleSetter(ctx));
   slct_twod.reset(new ltt::TwoDSelection(ctx, ak4_ptrel_max, ak4_dr_lep_min, true));
 
-  const JetId btagID = BTag(btagAlgo, btagWP);
+  const JetId btagID = ltt::CachedBTag(ctx, btagAlgo, btagWP, kHandleName_pairedCHSjets_hemi);
   slct_btag.reset(new NJetSelection(1, -1, boost::none, ctx.get_handle<vector<Jet>>(kHandleName_bJets_hemi)));
   for(const auto & band : kRelevantBands) {
     run_btag_sf[band] = ctx.has(xml_key_of_btag_eff_file.at(band));
     hist_btag_eff[band].reset(new BTagMCEfficiencyHists(ctx, "BTagMCEff_"+kBands.at(band).name, btagID, kHandleName_pairedCHSjets_hemi));
-    if(run_btag_sf.at(band)) sf_btagging[band].reset(new MCBTagScaleFactor(ctx, btagAlgo, btagWP, kHandleName_pairedCHSjets_hemi, "mujets", "incl", xml_key_of_btag_eff_file.at(band)));
+    if(run_btag_sf.at(band)) sf_btagging[band].reset(new ltt::BTagFixedWPScaleFactors(ctx, btagAlgo, btagWP, kHandleName_pairedCHSjets_hemi, "mujets", "incl", xml_key_of_btag_eff_file.at(band)));
   }
 
   hist_before2d.reset(new ltt::AndHists(ctx, "Before2D", true, true));
@@ -310,10 +327,202 @@ TagAndProbeMainSelectionModule::TagAndProbeMainSelectionModule(Context & ctx):
   merge_scenarios_ak8.reset(new ltt::MergeScenarioHandleSetter(ctx, ProbeJetAlgo::isAK8, kHandleName_SingleTopGen_tWch));
   main_output.reset(new ltt::MainOutputSetter(ctx));
 
+  // Needs to be constructed after all weight modules. Lepton SF modules for low/high pt and dummies share their handles
+  vector<ltt::WeightLedgerSlot> ledger_slots = {
+    ltt::pileup_ledger_slot(ctx),
+    ltt::murmuf_ledger_slot(ctx),
+    ltt::ps_ledger_slot(ctx),
+    sf_prefire->ledger_slot(),
+    weight_trickery->ledger_slot(),
+    sf_toppt->ledger_slot(),
+    sf_vjets->ledger_slot(),
+    sf_muon_id_highpt->ledger_slot(),
+    sf_muon_trigger_highpt->ledger_slot(),
+    sf_elec_id_highpt->ledger_slot(),
+    sf_elec_reco->ledger_slot(),
+  };
+  for(const auto & band : kRelevantBands) { // b-tagging SF modules of all bands share their handles
+    if(run_btag_sf.at(band)) {
+      ledger_slots.push_back(sf_btagging.at(band)->ledger_slot());
+      break;
+    }
+  }
+  weight_ledger.reset(new ltt::WeightLedger(ctx, ledger_slots));
+
   fHandle_weight = ctx.declare_event_output<float>("weight");
   fHandle_band = ctx.declare_event_output<int>("band");
   fHandle_year = ctx.declare_event_output<int>("year");
   fHandle_dataset = ctx.declare_event_output<string>("dataset");
+
+  // The event loop as a sequence of named steps; each step returns false if the event is rejected. The selection
+  // writes a cutflow (weighted and unweighted) to the "Cutflow" directory and prints it at the end of the job
+  selection.reset(new ltt::SelectionScheduler("TagAndProbeMainSelectionModule", false));
+  selection->add_step("input", {}, [this](Event & event) {
+    if(debug) cout << "Initial stuff after preselection" << endl;
+    if(event.is_valid(fHandle_bool_reco_sel) && event.get(fHandle_bool_reco_sel) == false) return false; // reject (tW) events which only pass gen level selections during preselection from HighPtSingleTop
+    if(fChannel == Channel::isMuo) {
+      if(event.muons->size() != 1) return false;
+    }
+    else if(fChannel == Channel::isEle) {
+      if(event.electrons->size() != 1) return false;
+    }
+    if(is_tW) {
+      prod_SingleTopGen_tWch->process(event); // needed for WeightTrickery and setting correct merge scenario for tW
+    }
+    return true;
+  });
+  selection->add_step("lepton", {"input"}, [this](Event & event) {
+    if(fChannel == Channel::isMuo) {
+      const Muon *muon = &event.muons->at(0);
+      if(muon->pt() < muon_highpt_pt_min) {
+        if(!slct_muon_lowpt->passes(event)) return false;
+        sf_muon_id_lowpt->process(event);
+        fLowPt = true;
+      }
+      else {
+        if(!slct_muon_highpt->passes(event)) return false;
+        sf_muon_id_highpt->process(event);
+        fLowPt = false;
+      }
+      sf_elec_id_dummy->process(event);
+      sf_elec_reco_dummy->process(event);
+    }
+    else if(fChannel == Channel::isEle) {
+      const Electron *electron = &event.electrons->at(0);
+      const float abseta_sc = fabs(electron->supercluster_eta());
+      if(abseta_sc > 1.4442 && abseta_sc < 1.566) return false; // gap between ECAL barrel and endcap
+      if(electron->pt() < electron_highpt_pt_min) {
+        if(!slct_elec_lowpt->passes(event)) return false;
+        sf_elec_id_lowpt->process(event);
+        fLowPt = true;
+      }
+      else {
+        if(!slct_elec_highpt->passes(event)) return false;
+        sf_elec_id_highpt->process(event);
+        fLowPt = false;
+      }
+      sf_elec_reco->process(event);
+      sf_muon_id_dummy->process(event);
+    }
+    primlep->process(event);
+    return true;
+  }, true);
+  selection->add_step("event_weights", {"lepton"}, [this](Event & event) {
+    scale_variation->process(event);
+    ps_variation->process(event);
+    sf_lumi->process(event);
+    sf_pileup->process(event);
+    sf_prefire->process(event);
+    weight_trickery->process(event);
+    return true;
+  }, true);
+  selection->add_step("jetmet", {"lepton"}, [this](Event & event) {
+    if(debug) cout << "JetMET corrections, pt sorting, and PUPPI-CHS matching" << endl;
+    jetmet_corrections_puppi->process(event);
+    cleaner_ak4puppi->process(event);
+    jetmet_corrections_chs->process(event);
+    lepton_context->process(event); // leptons and MET are final from here on; used by lepton-jet cleaning, pTW selection, and main output
+
+    corrections_hotvr->process(event); // needs to come already here because of subsequent object pt sorter
+    cleaner_hotvr->process(event);
+    corrections_ak8->process(event);
+    cleaner_ak8->process(event);
+
+    object_pt_sorter->process(event); // needs to come after jet corrections but before PUPPI-CHS matching
+    puppichs_matching->process(event);
+    return true;
+  });
+  selection->add_step("met", {"jetmet"}, [this](Event & event) {
+    if(debug) cout << "MET selection and MET filters" << endl;
+    if(!slct_met->passes(event)) return false;
+    if(!slct_metfilter->passes(event)) return false;
+    return true;
+  });
+  selection->add_step("probejet", {"jetmet"}, [this](Event & event) {
+    // if(debug) cout << "At least one large-R jet (HOTVR or AK8)" << endl;
+    // if(!slct_1largejet->passes(event)) return false;
+    if(debug) cout << "Check whether event has probe jets or not" << endl;
+    fHasHOTVRJet = slct_1hotvr->passes(event);
+    fHasAK8Jet = slct_1ak8->passes(event);
+    return fHasHOTVRJet || fHasAK8Jet;
+  });
+  selection->add_step("ak4jet", {"jetmet"}, [this](Event & event) {
+    if(debug) cout << "Select at least one AK4 jet" << endl;
+    if(!slct_1ak4jet->passes(event)) return false; // Require at least one AK4 jet for computational reasons (dR(lepton, jet) etc.); this rejects only \mathcal{O}(0.01\%) of events in real data (tested in pre-UL 2017 muo, RunB)
+    lepton_jet_proximity->process(event); // nearest AK4 jet, dR and pTrel of the lepton; used by 2D selection and main output
+    return true;
+  });
+  selection->add_step("ptw", {"jetmet"}, [this](Event & event) {
+    if(debug) cout << "Leptonic W boson pT selection" << endl;
+    return slct_ptw->passes(event);
+  });
+  selection->add_step("hem2018", {"jetmet", "event_weights"}, [this](Event & event) {
+    if(debug) cout << "2018 HEM15/16 issue selection" << endl;
+    if(slct_hem2018->passes(event)) {
+      if(event.isRealData) return false;
+      else event.weight *= (1. - slct_hem2018->GetAffectedLumiFraction());
+    }
+    return true;
+  }, true);
+  selection->add_step("theory_corrections", {"input"}, [this](Event & event) {
+    if(debug) cout << "Apply top-pt reweighting for ttbar events" << endl;
+    sf_toppt->process(event);
+
+    if(debug) cout << "Apply (N)NLO QCD/EWK corrections to V+jets samples" << endl;
+    sf_vjets->process(event);
+    return true;
+  }, true);
+  selection->add_step("trigger", {"lepton"}, [this](Event & event) {
+    if(debug) cout << "Trigger selection" << endl;
+    const bool passes_trigger = fLowPt ? slct_trigger_lowpt->passes(event) : slct_trigger_highpt->passes(event);
+    if(!passes_trigger) return false;
+    if(fChannel == Channel::isMuo) {
+      if(fLowPt) sf_muon_trigger_lowpt->process(event);
+      else sf_muon_trigger_highpt->process(event);
+      // sf_elec_trigger_dummy->process(event);
+    }
+    else if(fChannel == Channel::isEle) {
+      // sf_elec_trigger->process(event); // need to differentiate between 2017 Run B and Run C-F
+      sf_muon_trigger_dummy->process(event);
+    }
+    return true;
+  }, true);
+  selection->add_step("twod", {"ak4jet"}, [this](Event & event) {
+    if(debug) cout << "Booleans for further selections" << endl;
+    fBand = slct_twod->band(event);
+    if(fBand == Band::QCD && is_syst) return false;
+    return true;
+  });
+  selection->add_step("btag", {"twod", "trigger"}, [this](Event & event) {
+    hist_btag_eff[fBand]->fill(event);
+
+    const bool passes_btag = slct_btag->passes(event);
+    if(!passes_btag) return false;
+    if(run_btag_sf[fBand]) sf_btagging[fBand]->process(event);
+    return true;
+  }, true);
+  selection->add_step("output", {"btag", "probejet", "met", "ptw"}, [this](Event & event) {
+    hist_before2d->fill(event);
+    hist_presel[fBand]->fill(event);
+
+    if(debug) cout << "Find out decay channel and identify generated hadronic top quark (only valid for top-MC)" << endl;
+    decay_channel_and_hadronic_top->process(event);
+
+    if(debug) cout << "Set probe jet handles and find out merge scenario" << endl;
+    if(fHasHOTVRJet) probejet_hotvr->process(event);
+    if(fHasAK8Jet) probejet_ak8->process(event);
+
+    // Following modules need to be outside of the previous if statements! MergeScenario for event w/o probe jet will be "isBackground"
+    merge_scenarios_hotvr->process(event);
+    merge_scenarios_ak8->process(event);
+
+    if(debug) cout << "Write main output to AnalysisTree" << endl;
+    main_output->process(event);
+
+    weight_ledger->process(event);
+    return true;
+  });
+  selection->book_cutflow(ctx);
 }
 
 
@@ -332,149 +541,12 @@ bool TagAndProbeMainSelectionModule::process(Event & event) {
     cout << endl;
   }
 
-  if(debug) cout << "Initial stuff after preselection" << endl;
-  if(event.is_valid(fHandle_bool_reco_sel) && event.get(fHandle_bool_reco_sel) == false) return false; // reject (tW) events which only pass gen level selections during preselection from HighPtSingleTop
-  if(fChannel == Channel::isMuo) {
-    if(event.muons->size() != 1) return false;
-  }
-  else if(fChannel == Channel::isEle) {
-    if(event.electrons->size() != 1) return false;
-  }
-  if(is_tW) {
-    prod_SingleTopGen_tWch->process(event); // needed for WeightTrickery and setting correct merge scenario for tW
-  }
-
-  bool lowpt(false);
-  if(fChannel == Channel::isMuo) {
-    const Muon *muon = &event.muons->at(0);
-    if(muon->pt() < muon_highpt_pt_min) {
-      if(!slct_muon_lowpt->passes(event)) return false;
-      sf_muon_id_lowpt->process(event);
-      lowpt = true;
-    }
-    else {
-      if(!slct_muon_highpt->passes(event)) return false;
-      sf_muon_id_highpt->process(event);
-      lowpt = false;
-    }
-    sf_elec_id_dummy->process(event);
-    sf_elec_reco_dummy->process(event);
-  }
-  else if(fChannel == Channel::isEle) {
-    const Electron *electron = &event.electrons->at(0);
-    const float abseta_sc = fabs(electron->supercluster_eta());
-    if(abseta_sc > 1.4442 && abseta_sc < 1.566) return false; // gap between ECAL barrel and endcap
-    if(electron->pt() < electron_highpt_pt_min) {
-      if(!slct_elec_lowpt->passes(event)) return false;
-      sf_elec_id_lowpt->process(event);
-      lowpt = true;
-    }
-    else {
-      if(!slct_elec_highpt->passes(event)) return false;
-      sf_elec_id_highpt->process(event);
-      lowpt = false;
-    }
-    sf_elec_reco->process(event);
-    sf_muon_id_dummy->process(event);
-  }
-  primlep->process(event);
-  scale_variation->process(event);
-  ps_variation->process(event);
-  sf_lumi->process(event);
-  sf_pileup->process(event);
-  sf_prefire->process(event);
-  weight_trickery->process(event);
-
-  if(debug) cout << "JetMET corrections, pt sorting, and PUPPI-CHS matching" << endl;
-  jetmet_corrections_puppi->process(event);
-  cleaner_ak4puppi->process(event);
-  jetmet_corrections_chs->process(event);
-
-  corrections_hotvr->process(event); // needs to come already here because of subsequent object pt sorter
-  cleaner_hotvr->process(event);
-  corrections_ak8->process(event);
-  cleaner_ak8->process(event);
-
-  object_pt_sorter->process(event); // needs to come after jet corrections but before PUPPI-CHS matching
-  puppichs_matching->process(event);
-
-  if(debug) cout << "MET selection and MET filters" << endl;
-  if(!slct_met->passes(event)) return false;
-  if(!slct_metfilter->passes(event)) return false;
-
-  // if(debug) cout << "At least one large-R jet (HOTVR or AK8)" << endl;
-  // if(!slct_1largejet->passes(event)) return false;
-  if(debug) cout << "Check whether event has probe jets or not" << endl;
-  const bool has_hotvr_jet = slct_1hotvr->passes(event);
-  const bool has_ak8_jet = slct_1ak8->passes(event);
-  if(!(has_hotvr_jet || has_ak8_jet)) return false;
-
-  if(debug) cout << "Select at least one AK4 jet" << endl;
-  if(!slct_1ak4jet->passes(event)) return false; // Require at least one AK4 jet for computational reasons (dR(lepton, jet) etc.); this rejects only \mathcal{O}(0.01\%) of events in real data (tested in pre-UL 2017 muo, RunB)
-
-  if(debug) cout << "Leptonic W boson pT selection" << endl;
-  if(!slct_ptw->passes(event)) return false;
-
-  if(debug) cout << "2018 HEM15/16 issue selection" << endl;
-  if(slct_hem2018->passes(event)) {
-    if(event.isRealData) return false;
-    else event.weight *= (1. - slct_hem2018->GetAffectedLumiFraction());
-  }
-
-  if(debug) cout << "Apply top-pt reweighting for ttbar events" << endl;
-  sf_toppt->process(event);
-
-  if(debug) cout << "Apply (N)NLO QCD/EWK corrections to V+jets samples" << endl;
-  sf_vjets->process(event);
-
-  if(debug) cout << "Trigger selection" << endl;
-  const bool passes_trigger = lowpt ? slct_trigger_lowpt->passes(event) : slct_trigger_highpt->passes(event);
-  if(!passes_trigger) return false;
-  if(fChannel == Channel::isMuo) {
-    if(lowpt) sf_muon_trigger_lowpt->process(event);
-    else sf_muon_trigger_highpt->process(event);
-    // sf_elec_trigger_dummy->process(event);
-  }
-  else if(fChannel == Channel::isEle) {
-    // sf_elec_trigger->process(event); // need to differentiate between 2017 Run B and Run C-F
-    sf_muon_trigger_dummy->process(event);
-  }
-
-  if(debug) cout << "Booleans for further selections" << endl;
-  const bool passes_twod = slct_twod->passes(event);
-  Band band;
-  if(passes_twod) band = Band::MAIN;
-  else {
-    if(is_syst) return false;
-    band = Band::QCD;
-  }
-
-  hist_btag_eff[band]->fill(event);
-
-  const bool passes_btag = slct_btag->passes(event);
-  if(!passes_btag) return false;
-  if(run_btag_sf[band]) sf_btagging[band]->process(event);
-
-  hist_before2d->fill(event);
-  hist_presel[band]->fill(event);
-
-  if(debug) cout << "Find out decay channel and identify generated hadronic top quark (only valid for top-MC)" << endl;
-  decay_channel_and_hadronic_top->process(event);
-
-  if(debug) cout << "Set probe jet handles and find out merge scenario" << endl;
-  if(has_hotvr_jet) probejet_hotvr->process(event);
-  if(has_ak8_jet) probejet_ak8->process(event);
-
-  // Following modules need to be outside of the previous if statements! MergeScenario for event w/o probe jet will be "isBackground"
-  merge_scenarios_hotvr->process(event);
-  merge_scenarios_ak8->process(event);
-
-  if(debug) cout << "Write main output to AnalysisTree" << endl;
-  main_output->process(event);
+  theory_weights->process(event);
+  if(!selection->process(event)) return false;
 
   if(debug) cout << "End of MainSelectionModule. Event passed" << endl;
   event.set(fHandle_weight, event.weight);
-  event.set(fHandle_band, kBands.at(band).index);
+  event.set(fHandle_band, kBands.at(fBand).index);
   event.set(fHandle_year, kYears.at(fYear).index);
   // event.set(fHandle_dataset, fDatasetVersion_without_year_suffix);
   event.set(fHandle_dataset, fDatasetVersion); // with year suffix
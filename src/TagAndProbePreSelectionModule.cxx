@@ -5,7 +5,6 @@
 #include "UHH2/core/include/Event.h"
 #include "UHH2/core/include/Utils.h"
 
-#include "UHH2/common/include/LumiSelection.h"
 #include "UHH2/common/include/MCWeight.h"
 #include "UHH2/common/include/CommonModules.h"
 #include "UHH2/common/include/MuonIds.h"
@@ -19,6 +18,10 @@
 #include "UHH2/LegacyTopTagging/include/AndHists.h"
 #include "UHH2/LegacyTopTagging/include/METXYCorrection.h"
 #include "UHH2/LegacyTopTagging/include/LeptonScaleFactors.h"
+#include "UHH2/LegacyTopTagging/include/TheoryWeights.h"
+#include "UHH2/LegacyTopTagging/include/GoodLumiSelection.h"
+#include "UHH2/LegacyTopTagging/include/SelectionScheduler.h"
+#include "UHH2/LegacyTopTagging/include/OutputSlimming.h"
 
 using namespace std;
 using namespace uhh2;
@@ -36,6 +39,7 @@ private:
   bool debug;
 
   // unique_ptr<AnalysisModule> weight_trickery;
+  unique_ptr<AnalysisModule> theory_weights;
 
   unique_ptr<Selection> slct_lumi;
   unique_ptr<AnalysisModule> sf_lumi;
@@ -58,6 +62,11 @@ private:
   unique_ptr<AndHists> hist_met;
   unique_ptr<AndHists> hist_ptw;
 
+  bool adaptive_ordering;
+  unique_ptr<SelectionScheduler> scheduler;
+
+  unique_ptr<OutputSlimmer> output_slimmer;
+
   // unique_ptr<Selection> slct_trigger;
 };
 
@@ -91,8 +100,9 @@ TagAndProbePreSelectionModule::TagAndProbePreSelectionModule(Context & ctx) {
   const MuonId muonID_tag = AndId<Muon>(PtEtaCut(55., 2.4), MuonID(muonIdSelector)); // in order to save disk space, I cut at 55 GeV already in presel!
 
   // weight_trickery.reset(new WeightTrickery(ctx));
+  theory_weights.reset(new TheoryWeightBlock(ctx));
 
-  slct_lumi.reset(new LumiSelection(ctx));
+  slct_lumi.reset(new GoodLumiSelection(ctx));
   sf_lumi.reset(new MCLumiWeight(ctx));
   sf_prefire.reset(new PrefiringWeights(ctx));
   // sf_muon.reset(new MuonScaleFactors(ctx));
@@ -128,6 +138,82 @@ TagAndProbePreSelectionModule::TagAndProbePreSelectionModule(Context & ctx) {
 
   // slct_trigger.reset(new LttTriggerSelection(ctx));
   // slct_trigger.reset(new TriggerSelection("asdf"));
+
+  // The steps after the lumi selection; in adaptive ordering, the cheap steps with high rejection rates (usually MET)
+  // are moved in front of the independent ones. The intermediate cutflow histograms lose their meaning then and are
+  // not filled
+  adaptive_ordering = string2bool(ctx.get("presel_adaptive_ordering", "false"));
+  scheduler.reset(new SelectionScheduler("TagAndProbePreSelectionModule", adaptive_ordering, stoull(ctx.get("presel_adaptive_ordering_warmup", "1000"))));
+  scheduler->add_step("common", {}, [this](Event & event) {
+    if(debug) cout << "CommonModules: jet, electron, muon id cleaning; jet-lepton cleaning; MET+PV filter; AK4+MET corrections; PU weights" << endl;
+    if(!common_modules->process(event)) return false;
+    if(!adaptive_ordering) hist_common->fill(event);
+    return true;
+  }, true);
+  scheduler->add_step("electron_veto", {"common"}, [this](Event & event) {
+    if(debug) cout << "Electron veto" << endl;
+    return slct_elec->passes(event); // veto vetoID electrons
+  });
+  scheduler->add_step("muon", {"common"}, [this](Event & event) {
+    if(debug) cout << "Muon selection" << endl;
+    if(!slct_muon->passes(event)) return false; // veto additional looseID muons
+    clnr_muon->process(event);
+    if(!slct_muon->passes(event)) return false; // require exactly one tightID muon
+    primlep->process(event);
+    // sf_muon->process(event);
+    sf_muon_id->process(event);
+    if(!adaptive_ordering) hist_muon->fill(event);
+    return true;
+  }, true);
+  scheduler->add_step("met", {"common"}, [this](Event & event) {
+    if(debug) cout << "MET XY correction" << endl;
+    met_xy_correction->process(event);
+    if(!adaptive_ordering) hist_met_xy_correction->fill(event);
+    if(debug) cout << "MET selection" << endl;
+    if(!slct_met->passes(event)) return false;
+    if(!adaptive_ordering) hist_met->fill(event);
+    return true;
+  });
+  scheduler->add_step("ptw", {"muon", "met"}, [this](Event & event) {
+    if(debug) cout << "PTW selection" << endl;
+    return slct_ptw->passes(event);
+  });
+  scheduler->book_cutflow(ctx);
+
+  if(string2bool(ctx.get("presel_output_slimming", "false"))) {
+    // collections read by TagAndProbeMainSelectionModule (also via CommonModules, JetMETCorrections, TopJetCorrections, etc.)
+    const OutputConsumer mainsel{"TagAndProbeMainSelectionModule", {
+      ctx.get("PrimaryVertexCollection", ""),
+      ctx.get("METName", ""),
+      ctx.get("ElectronCollection", ""),
+      ctx.get("MuonCollection", ""),
+      ctx.get("JetCollection", ""),
+      ctx.get("GenJetCollection", ""),
+      ctx.get("TopJetCollection", ""),
+      ctx.get("GenTopJetCollection", ""),
+      ctx.get("GenParticleCollection", ""),
+      ctx.get("GenInfoName", ""),
+      kCollectionName_AK4CHS,
+      kCollectionName_AK8_rec,
+      kCollectionName_AK8_gen,
+      kCollectionName_METCHS,
+    }};
+    output_slimmer.reset(new OutputSlimmer(ctx, {mainsel}));
+    // taggers not used anywhere in the analysis
+    const auto slim_ak4 = [](Jet & jet) {
+      jet.set_btag_combinedSecondaryVertex(0.f);
+      jet.set_btag_combinedSecondaryVertexMVA(0.f);
+    };
+    output_slimmer->add_jet_slimming(ctx, ctx.get("JetCollection", ""), slim_ak4);
+    output_slimmer->add_jet_slimming(ctx, kCollectionName_AK4CHS, slim_ak4);
+    output_slimmer->add_topjet_slimming(ctx, kCollectionName_AK8_rec, [](TopJet & topjet) {
+      topjet.set_btag_BoostedDoubleSecondaryVertexAK8(0.f);
+      topjet.set_btag_DeepBoosted_ZvsQCD(0.f);
+      topjet.set_btag_DeepBoosted_ZbbvsQCD(0.f);
+      topjet.set_btag_DeepBoosted_HbbvsQCD(0.f);
+      topjet.set_btag_DeepBoosted_H4qvsQCD(0.f);
+    });
+  }
 }
 
 
@@ -146,38 +232,20 @@ bool TagAndProbePreSelectionModule::process(Event & event) {
   // if(debug) cout << "MC weight magic" << endl;
   // weight_trickery->process(event);
 
+  if(debug) cout << "PS and muR/muF weight block (needs to see all events for the sums of weights)" << endl;
+  theory_weights->process(event);
+
   if(debug) cout << "Lumi selection (need to do this manually before CommonModules)" << endl; // else getting error for some data samples, e.g. "RunSwitcher cannot handle run number 275656 for year 2016"
   if(event.isRealData && !slct_lumi->passes(event)) return false;
   sf_lumi->process(event);
   sf_prefire->process(event);
   hist_nocuts->fill(event);
 
-  if(debug) cout << "CommonModules: jet, electron, muon id cleaning; jet-lepton cleaning; MET+PV filter; AK4+MET corrections; PU weights" << endl;
-  if(!common_modules->process(event)) return false;
-  hist_common->fill(event);
-
-  if(debug) cout << "Lepton selection" << endl;
-  if(!slct_elec->passes(event)) return false; // veto vetoID electrons
-  if(!slct_muon->passes(event)) return false; // veto additional looseID muons
-  clnr_muon->process(event);
-  if(!slct_muon->passes(event)) return false; // require exactly one tightID muon
-  primlep->process(event);
-  // sf_muon->process(event);
-  sf_muon_id->process(event);
-  hist_muon->fill(event);
-
-  if(debug) cout << "MET XY correction" << endl;
-  met_xy_correction->process(event);
-  hist_met_xy_correction->fill(event);
-
-  if(debug) cout << "MET selection" << endl;
-  if(!slct_met->passes(event)) return false;
-  hist_met->fill(event);
-
-  if(debug) cout << "PTW selection" << endl;
-  if(!slct_ptw->passes(event)) return false;
+  if(!scheduler->process(event)) return false;
   hist_ptw->fill(event);
 
+  if(output_slimmer) output_slimmer->process(event);
+
   if(debug) cout << "End of TagAndProbePreSelectionModule" << endl;
   return true;
 }
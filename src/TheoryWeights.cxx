@@ -0,0 +1,73 @@
+#include "UHH2/LegacyTopTagging/include/TheoryWeights.h"
+
+using namespace std;
+using namespace uhh2;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+TheoryWeightSumHists::TheoryWeightSumHists(Context & ctx, const string & dirname): Hists(ctx, dirname) {
+
+  const unsigned int nbins = kTheoryWeights.size() + 1;
+  h_sumw = book<TH1D>("sumw", "Sums of generator weights", nbins, 0.5, nbins + 0.5);
+  h_sumw->GetXaxis()->SetBinLabel(1, "nominal");
+  for(unsigned int i = 0; i < kTheoryWeights.size(); i++) {
+    h_sumw->GetXaxis()->SetBinLabel(i + 2, kTheoryWeights.at(i).name.c_str());
+  }
+}
+
+void TheoryWeightSumHists::fill(const double gen_weight, const vector<float> & theory_weights) {
+
+  h_sumw->Fill(1, gen_weight);
+  for(unsigned int i = 0; i < theory_weights.size(); i++) {
+    h_sumw->Fill(i + 2, gen_weight * theory_weights.at(i));
+  }
+}
+
+//____________________________________________________________________________________________________
+TheoryWeightBlock::TheoryWeightBlock(Context & ctx, const string & branch_name, const string & dirname):
+  fIsMC(ctx.get("dataset_type") == "MC"),
+  fHandle_weights(ctx.declare_event_output<vector<float>>(branch_name))
+{
+  if(fIsMC && !dirname.empty()) fHists.reset(new TheoryWeightSumHists(ctx, dirname));
+  for(const TheoryWeightInfo & info : kTheoryWeights) {
+    unsigned int & max_index = info.source == TheoryWeightSource::PS ? fMaxIndexPS : fMaxIndexLHE;
+    max_index = max(max_index, info.index);
+  }
+}
+
+bool TheoryWeightBlock::process(Event & event) {
+
+  vector<float> weights(kTheoryWeights.size(), 1.f);
+  if(!fIsMC) {
+    event.set(fHandle_weights, move(weights));
+    return true;
+  }
+
+  const vector<float> & ps_weights = event.genInfo->weights();
+  const vector<float> & lhe_weights = event.genInfo->systweights();
+  const double lhe_nominal = event.genInfo->originalXWGTUP();
+  const bool has_ps = ps_weights.size() > fMaxIndexPS && ps_weights.at(0) != 0.f;
+  const bool has_lhe = lhe_weights.size() > fMaxIndexLHE && lhe_nominal != 0.;
+  if(!has_ps && !fWarnedPS) {
+    cout << "TheoryWeightBlock::process(): Not all parton shower weights stored for this sample. Setting them to 1 for all events." << endl;
+    fWarnedPS = true;
+  }
+  if(!has_lhe && !fWarnedLHE) {
+    cout << "TheoryWeightBlock::process(): No muR/muF weights stored for this sample. Setting them to 1 for all events." << endl;
+    fWarnedLHE = true;
+  }
+
+  for(unsigned int i = 0; i < kTheoryWeights.size(); i++) {
+    const TheoryWeightInfo & info = kTheoryWeights.at(i);
+    if(info.source == TheoryWeightSource::PS && has_ps) weights.at(i) = ps_weights.at(info.index) / ps_weights.at(0);
+    else if(info.source == TheoryWeightSource::LHE && has_lhe) weights.at(i) = lhe_weights.at(info.index) / lhe_nominal;
+  }
+
+  if(fHists) fHists->fill(ps_weights.empty() ? 1. : ps_weights.at(0), weights);
+  event.set(fHandle_weights, move(weights));
+  return true;
+}
+
+}}
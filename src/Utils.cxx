@@ -1,4 +1,5 @@
 #include <iomanip>
+#include <limits>
 
 #include "UHH2/common/include/Utils.h"
 #include "UHH2/common/include/MCWeight.h"
@@ -188,13 +189,57 @@ const TopJet * nextTopJet(const Particle & p, const vector<TopJet> & topjets) {
   return closestParticle(p, topjets);
 }
 
+//____________________________________________________________________________________________________
+LeptonContextProducer::LeptonContextProducer(Context & ctx, const double _muon_highpt_pt_min, const double _electron_highpt_pt_min):
+  muon_highpt_pt_min(_muon_highpt_pt_min),
+  electron_highpt_pt_min(_electron_highpt_pt_min),
+  h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
+  h_context(ctx.get_handle<LeptonContext>(kHandleName_LeptonContext))
+{}
+
+bool LeptonContextProducer::process(Event & event) {
+  LeptonContext context;
+  context.primlep = event.get(h_primlep);
+  if(abs(context.primlep.pdgId()) == 13) {
+    context.channel = Channel::isMuo;
+    context.highpt = context.primlep.pt() >= muon_highpt_pt_min;
+  }
+  else if(abs(context.primlep.pdgId()) == 11) {
+    context.channel = Channel::isEle;
+    context.highpt = context.primlep.pt() >= electron_highpt_pt_min;
+  }
+  context.ptw = pTW(context.primlep, *event.met);
+  context.mtw = mTW(context.primlep, *event.met);
+  if(event.muons) context.muons.assign(event.muons->begin(), event.muons->end());
+  if(event.electrons) context.electrons.assign(event.electrons->begin(), event.electrons->end());
+  event.set(h_context, move(context));
+  return true;
+}
+
 //____________________________________________________________________________________________________
 // Copy of NoLeptonInJet from common/src/JetIds.cxx but reduced to only asking for deltaR
 NoLeptonInJet::NoLeptonInJet(const string & _lepton, const double _dr, const boost::optional<ElectronId> & _ele_id, const boost::optional<MuonId> & _muo_id):
   lepton(_lepton), dr(_dr), ele_id(_ele_id), muo_id(_muo_id) {}
 
+NoLeptonInJet::NoLeptonInJet(Context & ctx, const string & _lepton, const double _dr):
+  lepton(_lepton), dr(_dr), h_context(ctx.get_handle<LeptonContext>(kHandleName_LeptonContext)) {}
+
 bool NoLeptonInJet::operator()(const Jet & jet, const Event & event) const {
 
+  if(h_context && event.is_valid(*h_context)) {
+    const LeptonContext & context = event.get(*h_context);
+    if(lepton == "muon" || lepton == "all") {
+      for(const Particle & muo : context.muons) {
+        if(deltaR(jet, muo) < dr) return false;
+      }
+    }
+    if(lepton == "ele" || lepton == "all") {
+      for(const Particle & ele : context.electrons) {
+        if(deltaR(jet, ele) < dr) return false;
+      }
+    }
+    return true;
+  }
   const bool doMuons = event.muons && (lepton == "muon" || lepton == "all");
   const bool doElectrons = event.electrons && (lepton == "ele" || lepton == "all");
   if(doMuons) {
@@ -225,32 +270,86 @@ bool METSelection::passes(const Event & event) {
 }
 
 //____________________________________________________________________________________________________
-PTWSelection::PTWSelection(Context & ctx, const double _ptw_min, const double _ptw_max): ptw_min(_ptw_min), ptw_max(_ptw_max), h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)) {}
+PTWSelection::PTWSelection(Context & ctx, const double _ptw_min, const double _ptw_max):
+  ptw_min(_ptw_min),
+  ptw_max(_ptw_max),
+  h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
+  h_context(ctx.get_handle<LeptonContext>(kHandleName_LeptonContext))
+{}
 
 bool PTWSelection::passes(const Event & event) {
-  const FlavorParticle & primlep = event.get(h_primlep);
-  const float ptw = pTW(primlep, *event.met);
+  const float ptw = event.is_valid(h_context) ? event.get(h_context).ptw : pTW(event.get(h_primlep), *event.met);
   const bool passed_lower_limit = ptw > ptw_min;
   const bool passed_upper_limit = ptw < ptw_max;
   return passed_lower_limit && passed_upper_limit;
 }
 
+//____________________________________________________________________________________________________
+LeptonJetProximityHandleSetter::LeptonJetProximityHandleSetter(Context & ctx):
+  h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
+  h_jets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets)),
+  h_proximity(ctx.get_handle<LeptonJetProximity>(kHandleName_LeptonJetProximity))
+{}
+
+bool LeptonJetProximityHandleSetter::process(Event & event) {
+  LeptonJetProximity proximity;
+  const FlavorParticle & primlep = event.get(h_primlep);
+  const vector<Jet> & jets = event.get(h_jets);
+  // Same result as nextJet(), but the jet coordinates are extracted once into flat arrays and the
+  // minimum is searched on deltaR^2, so that only a single square root is needed per event
+  fEta.resize(jets.size());
+  fPhi.resize(jets.size());
+  for(unsigned int i = 0; i < jets.size(); i++) {
+    fEta[i] = jets[i].v4().eta();
+    fPhi[i] = jets[i].v4().phi();
+  }
+  const double lep_eta = primlep.v4().eta();
+  const double lep_phi = primlep.v4().phi();
+  double dr2_min = numeric_limits<double>::infinity();
+  for(unsigned int i = 0; i < jets.size(); i++) {
+    const double deta = fEta[i] - lep_eta;
+    double dphi = fabs(fPhi[i] - lep_phi);
+    if(dphi > M_PI) dphi = 2*M_PI - dphi;
+    const double dr2 = deta*deta + dphi*dphi;
+    if(dr2 < dr2_min) {
+      dr2_min = dr2;
+      proximity.nextjet_index = i;
+    }
+  }
+  if(proximity.nextjet_index >= 0) {
+    const Jet & nextjet = jets.at(proximity.nextjet_index);
+    proximity.dr = sqrt(dr2_min);
+    proximity.ptrel = pTrel(primlep, &nextjet);
+  }
+  event.set(h_proximity, proximity);
+  return true;
+}
+
 //____________________________________________________________________________________________________
 TwoDSelection::TwoDSelection(Context & ctx, const double _ptrel_min, const double _dr_min, const bool _circular):
   ptrel_min(_ptrel_min),
   dr_min(_dr_min),
   circular(_circular),
   h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
-  h_jets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets))
+  h_jets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets)),
+  h_proximity(ctx.get_handle<LeptonJetProximity>(kHandleName_LeptonJetProximity))
 {}
 
 bool TwoDSelection::passes(const Event & event) {
-  const FlavorParticle & primlep = event.get(h_primlep);
-  // throw runtime_error("fix TwoDSelection with new PUPPI CHS matching setup"); // DONE
-  const vector<Jet> & jets = event.get(h_jets);
-  const Jet *nextjet = nextJet(primlep, jets);
-  const float ptrel = pTrel(primlep, nextjet);
-  const float dr = deltaR(primlep.v4(), nextjet->v4());
+  float ptrel, dr;
+  if(event.is_valid(h_proximity)) {
+    const LeptonJetProximity & proximity = event.get(h_proximity);
+    ptrel = proximity.ptrel;
+    dr = proximity.dr;
+  }
+  else {
+    const FlavorParticle & primlep = event.get(h_primlep);
+    // throw runtime_error("fix TwoDSelection with new PUPPI CHS matching setup"); // DONE
+    const vector<Jet> & jets = event.get(h_jets);
+    const Jet *nextjet = nextJet(primlep, jets);
+    ptrel = pTrel(primlep, nextjet);
+    dr = deltaR(primlep.v4(), nextjet->v4());
+  }
   const bool passed_ptrel_cut = ptrel > ptrel_min;
   const bool passed_dr_cut = dr > dr_min;
   const bool passes_circular = dr*dr / (dr_min*dr_min) + ptrel*ptrel / (ptrel_min*ptrel_min) > 1.f;
@@ -598,7 +697,9 @@ MainOutputSetter::MainOutputSetter(Context & ctx):
   h_probejet_hotvr(ctx.get_handle<TopJet>("ProbeJet"+kProbeJetAlgos.at(ProbeJetAlgo::isHOTVR).name)),
   h_probejet_ak8(ctx.get_handle<TopJet>("ProbeJet"+kProbeJetAlgos.at(ProbeJetAlgo::isAK8).name)),
   h_primlep(ctx.get_handle<FlavorParticle>(kHandleName_PrimaryLepton)),
-  h_jets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets))
+  h_jets(ctx.get_handle<vector<Jet>>(kHandleName_pairedPUPPIjets)),
+  h_proximity(ctx.get_handle<LeptonJetProximity>(kHandleName_LeptonJetProximity)),
+  h_context(ctx.get_handle<LeptonContext>(kHandleName_LeptonContext))
 {
 
   vector<string> output_names;
@@ -687,12 +788,21 @@ bool MainOutputSetter::process(Event & event) {
 
   // Other outputs:
   const FlavorParticle & primlep = event.get(h_primlep);
+  const bool has_context = event.is_valid(h_context);
   values.at(i++) = primlep.pt();
-  values.at(i++) = mTW(primlep, *event.met);
+  values.at(i++) = has_context ? event.get(h_context).mtw : mTW(primlep, *event.met);
   values.at(i++) = event.met->pt();
-  values.at(i++) = pTW(primlep, *event.met);
-  values.at(i++) = pTrel(primlep, nextJet(primlep, event.get(h_jets)));
-  values.at(i++) = deltaR(primlep.v4(), nextJet(primlep, event.get(h_jets))->v4());
+  values.at(i++) = has_context ? event.get(h_context).ptw : pTW(primlep, *event.met);
+  if(event.is_valid(h_proximity)) {
+    const LeptonJetProximity & proximity = event.get(h_proximity);
+    values.at(i++) = proximity.ptrel;
+    values.at(i++) = proximity.dr;
+  }
+  else {
+    const Jet *nextjet = nextJet(primlep, event.get(h_jets));
+    values.at(i++) = pTrel(primlep, nextjet);
+    values.at(i++) = deltaR(primlep.v4(), nextjet->v4());
+  }
 
   for(unsigned int i = 0; i < values.size(); i++) {
     event.set(h_mainoutput.at(i), values.at(i));
@@ -739,6 +849,10 @@ PrefiringWeights::PrefiringWeights(Context & ctx, const bool apply): fYear(extra
   else {
     throw invalid_argument("PrefiringWeights: Invalid systematic variation given in XML config.");
   }
+  fLedgerSlot.name = "prefire";
+  fLedgerSlot.variations = { "nominal", "up", "down" };
+  fLedgerSlot.handle_names = { "weight_prefire", "weight_prefire_up", "weight_prefire_down" };
+  fLedgerSlot.applied = fApply ? fLedgerSlot.index_of(config) : -1;
 }
 
 void PrefiringWeights::set_dummy_weights(Event & event) {
@@ -803,6 +917,10 @@ TopPtReweighting::TopPtReweighting(Context & ctx, const bool apply): fApply(appl
   else {
     throw invalid_argument("TopPtReweighting: Invalid systematic variation given in XML config.");
   }
+  fLedgerSlot.name = "toppt";
+  fLedgerSlot.variations = { "nominal", "a_up", "a_down", "b_up", "b_down", "applied" };
+  for(const string & variation : fLedgerSlot.variations) fLedgerSlot.handle_names.push_back(variation == "nominal" ? "weight_toppt" : "weight_toppt_"+variation);
+  fLedgerSlot.applied = fLedgerSlot.index_of("applied"); // equals 1 if not applied
 }
 
 void TopPtReweighting::set_dummy_weights(Event & event) {
@@ -930,6 +1048,11 @@ VJetsReweighting::VJetsReweighting(Context & ctx, const string & weight_name):
   file = new TFile((filesDir+"lindert_qcd_nnlo_sf.root").c_str());
   for(const string& proc : {"eej", "evj", "vvj"}) load_histo(file, (string)(proc+"_qcd_nnlo"), (string)(proc));
   file->Close();
+
+  fLedgerSlot.name = weight_name.find("weight_") == 0 ? weight_name.substr(7) : weight_name;
+  fLedgerSlot.variations = { "applied", "EWK", "QCD_EWK", "QCD_NLO", "QCD_NNLO" };
+  for(const string & variation : fLedgerSlot.variations) fLedgerSlot.handle_names.push_back(weight_name+"_"+variation);
+  fLedgerSlot.applied = fLedgerSlot.index_of("applied");
 }
 
 void VJetsReweighting::load_histo(TFile* file, const string& name, const string& histName) {
@@ -1058,6 +1181,11 @@ WeightTrickery::WeightTrickery(Context & ctx, const string & handle_name_GENtW,
   is_tW_nfhd_PDF = is_tW_nfhd && dataset_version.find("PDF") != string::npos;
   // is_tW_nfhd_syst = is_tW_nfhd && dataset_version.find("syst") != string::npos;
   is_tW_nfhd_syst = is_tW_nfhd && is_extra_syst;
+
+  fLedgerSlot.name = "trickery";
+  fLedgerSlot.variations = { "nominal", "pdf" };
+  fLedgerSlot.handle_names = { "weight_trickery", "weight_trickery_pdf" };
+  fLedgerSlot.applied = fApply ? 0 : -1;
 }
 
 bool WeightTrickery::process(Event & event) {
@@ -1376,6 +1504,58 @@ const Jet * getCHSmatch(const Jet & puppijet, const Event & event, const Event::
   else return chsjet;
 }
 
+//____________________________________________________________________________________________________
+namespace {
+const vector<BTag::algo> kCachedBTagAlgos = { BTag::DEEPCSV, BTag::DEEPJET };
+const vector<BTag::wp> kCachedBTagWPs = { BTag::WP_LOOSE, BTag::WP_MEDIUM, BTag::WP_TIGHT };
+const vector<BTag> kCachedBTagIDs = [](){ // bit i of BTagDecision is the decision of kCachedBTagIDs.at(i)
+  vector<BTag> result;
+  for(const BTag::algo & algo : kCachedBTagAlgos) {
+    for(const BTag::wp & wp : kCachedBTagWPs) result.push_back(BTag(algo, wp));
+  }
+  return result;
+}();
+}
+
+unsigned int BTagDecision::bit(const BTag::algo & algo, const BTag::wp & wp) {
+  unsigned int i_algo(0), i_wp(0);
+  while(i_algo < kCachedBTagAlgos.size() && kCachedBTagAlgos.at(i_algo) != algo) i_algo++;
+  while(i_wp < kCachedBTagWPs.size() && kCachedBTagWPs.at(i_wp) != wp) i_wp++;
+  if(i_algo == kCachedBTagAlgos.size() || i_wp == kCachedBTagWPs.size()) throw invalid_argument("BTagDecision::bit(): b-tagging algorithm or working point not cached");
+  return i_algo * kCachedBTagWPs.size() + i_wp;
+}
+
+BTagDecision::BTagDecision(const Jet & jet, const Event & event): fHadronFlavor(jet.hadronFlavor()) {
+  for(unsigned int i = 0; i < kCachedBTagIDs.size(); i++) {
+    if(kCachedBTagIDs.at(i)(jet, event)) fBits |= 1 << i;
+  }
+}
+
+//____________________________________________________________________________________________________
+CachedBTag::CachedBTag(Context & ctx, const BTag::algo & algo, const BTag::wp & wp, const string & handle_name_jets):
+  fAlgo(algo),
+  fWP(wp),
+  fBTagID(algo, wp),
+  fHandle_jets(ctx.get_handle<vector<Jet>>(handle_name_jets)),
+  fHandle_decisions(ctx.get_handle<vector<BTagDecision>>(handle_name_jets+kHandleSuffix_BTagDecisions))
+{
+  BTagDecision::bit(fAlgo, fWP); // throws if not cached
+}
+
+bool CachedBTag::operator()(const Jet & jet, const Event & event) const {
+  if(event.is_valid(fHandle_decisions) && event.is_valid(fHandle_jets)) {
+    const vector<Jet> & jets = event.get(fHandle_jets);
+    const vector<BTagDecision> & decisions = event.get(fHandle_decisions);
+    if(jets.size() == decisions.size()) {
+      // the decisions are stored by jet index; find it by identity, the jet may belong to any other collection
+      for(unsigned int i = 0; i < jets.size(); i++) {
+        if(&jets.at(i) == &jet) return decisions.at(i).passes(fAlgo, fWP);
+      }
+    }
+  }
+  return fBTagID(jet, event);
+}
+
 //____________________________________________________________________________________________________
 MatchPuppiToCHSAndSetBTagHandles::MatchPuppiToCHSAndSetBTagHandles(Context & ctx, const BTag::algo & btag_algo, const BTag::wp & btag_wp):
   fHandle_PUPPIjets(ctx.get_handle<vector<Jet>>("jets")), // after this module, will contain all forward PUPPI jets and all CHS-matched central PUPPI jets
@@ -1384,10 +1564,10 @@ MatchPuppiToCHSAndSetBTagHandles::MatchPuppiToCHSAndSetBTagHandles(Context & ctx
   fHandle_pairedCHSjets(ctx.get_handle<vector<Jet>>(kHandleName_pairedCHSjets)), // can be used as handle for b-tagging discriminator reweighting class; double-counted CHS jets not strictly ruled out but we'll ignore this
   fHandle_forwardPUPPIjets(ctx.get_handle<vector<Jet>>(kHandleName_forwardPUPPIjets)), // all forward PUPPI jets
   fHandle_uncleanedPUPPIjets(ctx.get_handle<vector<Jet>>(kHandleName_uncleanedPUPPIjets)), // all PUPPI jets no matter if matched to CHS jet or not, and no matter if central or forward
+  fBTagAlgo(btag_algo),
   fBTagWP(btag_wp),
-  fBTagID_loose(BTag(btag_algo, BTag::WP_LOOSE)),
-  fBTagID_medium(BTag(btag_algo, BTag::WP_MEDIUM)),
-  fBTagID_tight(BTag(btag_algo, BTag::WP_TIGHT)),
+  fHandle_pairedCHSjets_BTagDecisions(ctx.get_handle<vector<BTagDecision>>(kHandleName_pairedCHSjets+kHandleSuffix_BTagDecisions)),
+  fHandle_pairedCHSjets_hemi_BTagDecisions(ctx.get_handle<vector<BTagDecision>>(kHandleName_pairedCHSjets_hemi+kHandleSuffix_BTagDecisions)),
   fHandle_bJets(ctx.get_handle<vector<Jet>>(kHandleName_bJets)),
   fHandle_bJets_loose(ctx.get_handle<vector<Jet>>(kHandleName_bJets_loose)),
   fHandle_bJets_medium(ctx.get_handle<vector<Jet>>(kHandleName_bJets_medium)),
@@ -1427,6 +1607,8 @@ bool MatchPuppiToCHSAndSetBTagHandles::process(Event & event) {
   vector<Jet> paired_puppijets_hemi;
   vector<Jet> paired_chsjets;
   vector<Jet> paired_chsjets_hemi;
+  vector<BTagDecision> paired_btag_decisions;
+  vector<BTagDecision> paired_btag_decisions_hemi;
   vector<Jet> forward_puppijets;
   for(const Jet & puppijet : uncleaned_puppijets) {
     if(fabs(puppijet.v4().eta()) >= kAbsEtaBTagThreshold) {
@@ -1438,12 +1620,15 @@ bool MatchPuppiToCHSAndSetBTagHandles::process(Event & event) {
       if(chsjetPtr != nullptr) {
         Jet chsjet = *chsjetPtr;
         if(fabs(chsjet.v4().eta()) >= kAbsEtaBTagThreshold) chsjet.set_eta(chsjet.v4().eta() > 0 ? kAbsEtaBTagThreshold-0.0001 : -kAbsEtaBTagThreshold+0.0001); // do this so that b-tagging SF can still be used if CHS eta lies outside SF eta range (but maybe SF = 1 is better?)
+        const BTagDecision btag_decision(*chsjetPtr, event);
         paired_puppijets.push_back(puppijet);
         paired_chsjets.push_back(chsjet);
+        paired_btag_decisions.push_back(btag_decision);
         cleaned_puppijets.push_back(puppijet);
         if(valid_primlep && deltaR(primlep.v4(), puppijet.v4()) < kDeltaRLeptonicHemisphere) {
           paired_puppijets_hemi.push_back(puppijet);
           paired_chsjets_hemi.push_back(chsjet);
+          paired_btag_decisions_hemi.push_back(btag_decision);
         }
       }
     }
@@ -1453,6 +1638,8 @@ bool MatchPuppiToCHSAndSetBTagHandles::process(Event & event) {
   event.set(fHandle_pairedPUPPIjets_hemi, paired_puppijets_hemi);
   event.set(fHandle_pairedCHSjets, paired_chsjets);
   event.set(fHandle_pairedCHSjets_hemi, paired_chsjets_hemi);
+  event.set(fHandle_pairedCHSjets_BTagDecisions, paired_btag_decisions);
+  event.set(fHandle_pairedCHSjets_hemi_BTagDecisions, paired_btag_decisions_hemi);
   event.set(fHandle_forwardPUPPIjets, forward_puppijets);
 
   event.set(fHandle_n_jets, cleaned_puppijets.size());
@@ -1461,24 +1648,25 @@ bool MatchPuppiToCHSAndSetBTagHandles::process(Event & event) {
 
   //__________________________________________________
   // Retrieve the b-tagging information from the matched CHS jets in order to find b-tagged PUPPI jets in central region
-  // At this point, getCHSmatch will *always* find a CHS jet since the central PUPPI jet collection has already been cleaned accordingly (no PUPPI without CHS match, see above)
+  // The decisions have been cached above for each PUPPI-CHS pair (same index in paired_puppijets and paired_btag_decisions)
   vector<Jet> bjets_loose;
   vector<Jet> bjets_medium;
   vector<Jet> bjets_tight;
   vector<Jet> bjets_hemi_loose;
   vector<Jet> bjets_hemi_medium;
   vector<Jet> bjets_hemi_tight;
-  for(const Jet & puppijet : paired_puppijets) {
-    const Jet *chsjetPtr = getCHSmatch(puppijet, event, fHandle_CHSjets);
-    if(fBTagID_loose(*chsjetPtr, event)) {
+  for(unsigned int i = 0; i < paired_puppijets.size(); i++) {
+    const Jet & puppijet = paired_puppijets.at(i);
+    const BTagDecision & btag_decision = paired_btag_decisions.at(i);
+    if(btag_decision.passes(fBTagAlgo, BTag::WP_LOOSE)) {
       bjets_loose.push_back(puppijet);
       if(valid_primlep && deltaR(primlep.v4(), puppijet.v4()) < kDeltaRLeptonicHemisphere) bjets_hemi_loose.push_back(puppijet);
     }
-    if(fBTagID_medium(*chsjetPtr, event)) {
+    if(btag_decision.passes(fBTagAlgo, BTag::WP_MEDIUM)) {
       bjets_medium.push_back(puppijet);
       if(valid_primlep && deltaR(primlep.v4(), puppijet.v4()) < kDeltaRLeptonicHemisphere) bjets_hemi_medium.push_back(puppijet);
     }
-    if(fBTagID_tight(*chsjetPtr, event)) {
+    if(btag_decision.passes(fBTagAlgo, BTag::WP_TIGHT)) {
       bjets_tight.push_back(puppijet);
       if(valid_primlep && deltaR(primlep.v4(), puppijet.v4()) < kDeltaRLeptonicHemisphere) bjets_hemi_tight.push_back(puppijet);
     }
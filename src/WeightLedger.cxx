@@ -0,0 +1,92 @@
+#include "UHH2/LegacyTopTagging/include/WeightLedger.h"
+
+#include "UHH2/common/include/Utils.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+using namespace uhh2;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+WeightLedger::WeightLedger(Context & ctx, const vector<WeightLedgerSlot> & slots, const string & branch_name):
+  fSchema(slots),
+  fHandle_ledger(ctx.declare_event_output<vector<float>>(branch_name))
+{
+  const bool write_legacy_branches = string2bool(ctx.get("write_legacy_weight_branches", "true"));
+  for(const WeightLedgerSlot & slot : fSchema.slots()) {
+    if(slot.handle_names.size() != slot.variations.size()) throw invalid_argument("WeightLedger: slot '"+slot.name+"' needs exactly one handle per variation");
+    for(const string & handle_name : slot.handle_names) {
+      fHandles.push_back(ctx.get_handle<float>(handle_name));
+      if(!write_legacy_branches) ctx.undeclare_event_output(handle_name);
+    }
+  }
+  const string schema = fSchema.to_string();
+  ctx.set_metadata(branch_name+"_schema", schema, true);
+  cout << "WeightLedger: writing " << fSchema.size() << " weights per event to branch '" << branch_name << "' with schema:" << endl;
+  cout << "  " << schema << endl;
+}
+
+bool WeightLedger::process(Event & event) {
+  vector<float> ledger(fHandles.size(), 1.f);
+  for(unsigned int i = 0; i < fHandles.size(); i++) {
+    if(event.is_valid(fHandles.at(i))) ledger.at(i) = event.get(fHandles.at(i));
+  }
+  event.set(fHandle_ledger, move(ledger));
+  return true;
+}
+
+//____________________________________________________________________________________________________
+WeightLedgerSlot pileup_ledger_slot(Context & ctx) {
+  WeightLedgerSlot slot;
+  slot.name = "pu";
+  slot.variations = { "nominal", "up", "down" };
+  slot.handle_names = { "weight_pu", "weight_pu_up", "weight_pu_down" };
+  const string syst_direction = ctx.get("SystDirection_Pileup", "nominal");
+  slot.applied = slot.index_of(syst_direction);
+  return slot;
+}
+
+WeightLedgerSlot murmuf_ledger_slot(Context & ctx) {
+  WeightLedgerSlot slot;
+  slot.name = "murmuf";
+  slot.variations = { "upup", "upnone", "noneup", "downdown", "downnone", "nonedown" };
+  for(const string & variation : slot.variations) slot.handle_names.push_back("weight_murmuf_"+variation);
+  const string applied = ctx.get("ScaleVariationMuR", "none")+ctx.get("ScaleVariationMuF", "none");
+  slot.applied = slot.index_of(applied);
+  return slot;
+}
+
+WeightLedgerSlot ps_ledger_slot(Context & ctx) {
+  WeightLedgerSlot slot;
+  slot.name = "ps";
+  for(const string & kind : { "isr", "fsr" }) {
+    slot.variations.push_back(kind+(string)"_2_up");
+    slot.variations.push_back(kind+(string)"_2_down");
+    for(const string & splitting : { "g2gg", "g2qq", "q2qg", "x2xg" }) {
+      for(const string & term : { "mur", "cns" }) {
+        slot.variations.push_back(kind+("_"+splitting)+"_"+term+"_up");
+        slot.variations.push_back(kind+("_"+splitting)+"_"+term+"_down");
+      }
+    }
+  }
+  for(const string & variation : slot.variations) slot.handle_names.push_back("weight_"+variation);
+  // "SystDirection_PS" values look like "FSRup_2"; the corresponding variation is "fsr_2_up"
+  string syst_direction = ctx.get("SystDirection_PS", "nominal");
+  transform(syst_direction.begin(), syst_direction.end(), syst_direction.begin(), ::tolower);
+  const size_t underscore = syst_direction.find('_');
+  string applied;
+  for(const string & direction : { "up", "down" }) {
+    const size_t pos = syst_direction.find(direction);
+    if(underscore != string::npos && pos != string::npos && pos + direction.size() == underscore) {
+      applied = syst_direction.substr(0, pos)+syst_direction.substr(underscore)+"_"+direction;
+    }
+  }
+  slot.applied = slot.index_of(applied);
+  return slot;
+}
+
+}}
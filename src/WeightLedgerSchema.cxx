@@ -0,0 +1,117 @@
+#include "UHH2/LegacyTopTagging/include/WeightLedgerSchema.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+
+namespace uhh2 { namespace ltt {
+
+//____________________________________________________________________________________________________
+int WeightLedgerSlot::index_of(const string & variation) const {
+
+  for(unsigned int i = 0; i < variations.size(); i++) {
+    if(variations.at(i) == variation) return i;
+  }
+  return -1;
+}
+
+//____________________________________________________________________________________________________
+WeightLedgerSchema::WeightLedgerSchema(const vector<WeightLedgerSlot> & slots): fSlots(slots) {
+
+  for(const WeightLedgerSlot & s : fSlots) {
+    const auto check_name = [](const string & name) {
+      if(name.empty() || name.find_first_of(":;,") != string::npos) throw invalid_argument("WeightLedgerSchema: invalid slot or variation name '"+name+"'");
+    };
+    check_name(s.name);
+    for(const string & variation : s.variations) check_name(variation);
+    if(s.variations.empty()) throw invalid_argument("WeightLedgerSchema: slot '"+s.name+"' has no variations");
+    if(s.applied < -1 || s.applied >= (int)s.variations.size()) throw invalid_argument("WeightLedgerSchema: slot '"+s.name+"' has invalid applied variation index");
+    for(unsigned int i = 0; i < fOffsets.size(); i++) {
+      if(fSlots.at(i).name == s.name) throw invalid_argument("WeightLedgerSchema: duplicate slot '"+s.name+"'");
+    }
+    fOffsets.push_back(fSize);
+    fSize += s.variations.size();
+  }
+}
+
+WeightLedgerSchema WeightLedgerSchema::parse(const string & schema) {
+
+  vector<WeightLedgerSlot> slots;
+  istringstream slot_stream(schema);
+  string slot_string;
+  while(getline(slot_stream, slot_string, ';')) {
+    if(slot_string.empty()) continue;
+    const size_t first = slot_string.find(':');
+    const size_t second = first == string::npos ? string::npos : slot_string.find(':', first + 1);
+    if(second == string::npos) throw invalid_argument("WeightLedgerSchema::parse(): cannot parse '"+slot_string+"'");
+    WeightLedgerSlot s;
+    s.name = slot_string.substr(0, first);
+    s.applied = stoi(slot_string.substr(first + 1, second - first - 1));
+    istringstream variation_stream(slot_string.substr(second + 1));
+    string variation;
+    while(getline(variation_stream, variation, ',')) s.variations.push_back(variation);
+    slots.push_back(s);
+  }
+  return WeightLedgerSchema(slots);
+}
+
+string WeightLedgerSchema::to_string() const {
+
+  string result;
+  for(const WeightLedgerSlot & s : fSlots) {
+    if(!result.empty()) result += ";";
+    result += s.name+":"+std::to_string(s.applied)+":";
+    for(unsigned int i = 0; i < s.variations.size(); i++) result += (i ? "," : "")+s.variations.at(i);
+  }
+  return result;
+}
+
+const WeightLedgerSlot & WeightLedgerSchema::slot(const string & name) const {
+
+  for(const WeightLedgerSlot & s : fSlots) {
+    if(s.name == name) return s;
+  }
+  throw invalid_argument("WeightLedgerSchema: no slot '"+name+"'");
+}
+
+unsigned int WeightLedgerSchema::offset(const string & name) const {
+
+  return fOffsets.at(&slot(name) - fSlots.data());
+}
+
+unsigned int WeightLedgerSchema::index(const string & name, const string & variation) const {
+
+  const int i = slot(name).index_of(variation);
+  if(i < 0) throw invalid_argument("WeightLedgerSchema: slot '"+name+"' has no variation '"+variation+"'");
+  return offset(name) + i;
+}
+
+//____________________________________________________________________________________________________
+WeightLedgerSchema::Reweighting WeightLedgerSchema::reweighting(const map<string, string> & choices) const {
+
+  Reweighting result;
+  for(const auto & choice : choices) {
+    const WeightLedgerSlot & s = slot(choice.first);
+    const int numerator = choice.second == "none" ? -1 : (int)index(choice.first, choice.second);
+    const int denominator = s.applied < 0 ? -1 : (int)offset(choice.first) + s.applied;
+    if(numerator != denominator) result.fFactors.push_back({numerator, denominator});
+  }
+  return result;
+}
+
+double WeightLedgerSchema::Reweighting::operator()(const float *ledger) const {
+
+  double result = 1.;
+  for(const auto & factor : fFactors) {
+    if(factor.first >= 0) result *= ledger[factor.first];
+    if(factor.second >= 0) {
+      if(ledger[factor.second] == 0.f) return 0.; // event weight is zero anyway
+      result /= ledger[factor.second];
+    }
+  }
+  return result;
+}
+
+}}